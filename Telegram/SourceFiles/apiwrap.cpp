@@ -85,6 +85,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/download_manager_mtproto.h"
 #include "storage/file_upload.h"
 #include "storage/storage_account.h"
+#include "storage/storage_messages_store.h"
 
 namespace {
 
@@ -96,6 +97,7 @@ constexpr auto kTopPromotionMinDelay = TimeId(10);
 constexpr auto kSmallDelayMs = 5;
 constexpr auto kReadFeaturedSetsTimeout = crl::time(1000);
 constexpr auto kFileLoaderQueueStopTimeout = crl::time(5000);
+constexpr auto kFileLoaderMaxThreads = 4;
 constexpr auto kStickersByEmojiInvalidateTimeout = crl::time(6 * 1000);
 constexpr auto kNotifySettingSaveTimeout = crl::time(1000);
 constexpr auto kDialogsFirstLoad = 20;
@@ -152,7 +154,9 @@ ApiWrap::ApiWrap(not_null<Main::Session*> session)
 , _draftsSaveTimer([=] { saveDraftsToCloud(); })
 , _featuredSetsReadTimer([=] { readFeaturedSets(); })
 , _dialogsLoadState(std::make_unique<DialogsLoadState>())
-, _fileLoader(std::make_unique<TaskQueue>(kFileLoaderQueueStopTimeout))
+, _fileLoader(std::make_unique<TaskQueue>(
+	kFileLoaderQueueStopTimeout,
+	kFileLoaderMaxThreads))
 , _topPromotionTimer([=] { refreshTopPromotion(); })
 , _updateNotifyTimer([=] { sendNotifySettingsUpdates(); })
 , _statsSessionKillTimer([=] { checkStatsSessions(); })
@@ -908,6 +912,9 @@ void ApiWrap::requestMoreDialogs(Data::Folder *folder) {
 				data.vdialogs().v,
 				count);
 		});
+		if (firstLoad && !folder) {
+			storeFirstDialogs(result);
+		}
 
 		if (!folder
 			&& (!_dialogsLoadState || !_dialogsLoadState->listReceived)) {
@@ -919,6 +926,12 @@ void ApiWrap::requestMoreDialogs(Data::Folder *folder) {
 		dialogsLoadState(folder)->requestId = 0;
 	}).send();
 
+	if (firstLoad && !folder) {
+		_session->data().messagesStore().loadDialogs(crl::guard(_session, [=](
+				const MTPmessages_Dialogs &result) {
+			applyStoredDialogs(result);
+		}));
+	}
 	if (!state->pinnedReceived) {
 		requestPinnedDialogs(folder);
 	}
@@ -927,6 +940,58 @@ void ApiWrap::requestMoreDialogs(Data::Folder *folder) {
 	}
 }
 
+void ApiWrap::applyStoredDialogs(const MTPmessages_Dialogs &result) {
+	const auto state = dialogsLoadState(nullptr);
+	if (!state || state->offsetDate || !state->requestId) {
+		// The first page was already received from the server.
+		return;
+	}
+	result.match([](const MTPDmessages_dialogsNotModified &) {
+	}, [&](const auto &data) {
+		const auto owner = &_session->data();
+		owner->messagesStore().processStoredPeers(
+			data.vusers(),
+			data.vchats());
+		for (const auto &dialog : data.vdialogs().v) {
+			dialog.match([&](const MTPDdialog &data) {
+				_storedDialogsPeers.emplace(peerFromMTP(data.vpeer()));
+			}, [](const MTPDdialogFolder &) {
+			});
+		}
+		owner->applyStoredDialogs(data.vmessages().v, data.vdialogs().v);
+	});
+	_session->data().chatsListChanged(nullptr);
+}
+
+void ApiWrap::storeFirstDialogs(const MTPmessages_Dialogs &result) {
+	auto histories = std::vector<not_null<History*>>();
+	result.match([](const MTPDmessages_dialogsNotModified &) {
+	}, [&](const auto &data) {
+		for (const auto &dialog : data.vdialogs().v) {
+			dialog.match([&](const MTPDdialog &data) {
+				const auto peerId = peerFromMTP(data.vpeer());
+				_storedDialogsPeers.remove(peerId);
+				if (const auto history = _session->data().historyLoaded(
+						peerId)) {
+					histories.push_back(history);
+				}
+			}, [](const MTPDdialogFolder &) {
+			});
+		}
+	});
+	auto &store = _session->data().messagesStore();
+	store.saveDialogs(result);
+	store.hydrate(histories);
+
+	// Chats from the stored list that are missing in the fresh one
+	// could have been moved down, left or deleted while we were away.
+	for (const auto &peerId : base::take(_storedDialogsPeers)) {
+		if (const auto history = _session->data().historyLoaded(peerId)) {
+			_session->data().histories().requestDialogEntry(history);
+		}
+	}
+}
+
 void ApiWrap::refreshDialogsLoadBlocked() {
 	_dialogsLoadMayBlockByDate = _dialogsLoadState
 		&& !_dialogsLoadState->listReceived
@@ -3170,6 +3235,13 @@ void ApiWrap::requestSharedMedia(
 				messageId,
 				slice,
 				result);
+			_session->data().messagesStore().saveSharedMedia(
+				peer->id,
+				topicRootId,
+				type,
+				result,
+				parsed.messageIds,
+				parsed.noSkipRange);
 			sharedMediaDone(peer, topicRootId, type, std::move(parsed));
 			finish();
 		}).fail([=] {
@@ -446,6 +446,8 @@ private:
 		const QVector<MTPDialog> &dialogs,
 		const QVector<MTPMessage> &messages);
 	void requestMoreDialogs(Data::Folder *folder);
+	void applyStoredDialogs(const MTPmessages_Dialogs &result);
+	void storeFirstDialogs(const MTPmessages_Dialogs &result);
 	DialogsLoadState *dialogsLoadState(Data::Folder *folder);
 	void dialogsLoadFinish(Data::Folder *folder);
 
@@ -670,6 +672,7 @@ private:
 	base::flat_set<HistoryRequest> _historyRequests;
 
 	std::unique_ptr<DialogsLoadState> _dialogsLoadState;
+	base::flat_set<PeerId> _storedDialogsPeers;
 	TimeId _dialogsLoadTill = 0;
 	rpl::variable<bool> _dialogsLoadMayBlockByDate = false;
 	rpl::variable<bool> _dialogsLoadBlockedByDate = false;
@@ -38,10 +38,51 @@ struct LangPackEmoji {
 	QString text;
 };
 
+using KeywordsMap = std::map<QString, std::vector<LangPackEmoji>>;
+
+// Immutable prefix tree of the sorted pack keywords in flat arrays.
+// Children of a node are contiguous and sorted by character, so each
+// query character costs one binary search. Keywords below a node are
+// a contiguous range of the sorted keywords, so the found node gives
+// all the keywords starting with the query without a subtree walk.
+class KeywordsTrie final {
+public:
+	KeywordsTrie() = default;
+	explicit KeywordsTrie(const KeywordsMap &emoji);
+
+	[[nodiscard]] bool empty() const;
+	[[nodiscard]] int maxKeyLength() const;
+	[[nodiscard]] KeywordsMap unpack() const;
+
+	[[nodiscard]] std::vector<Result> query(
+		const QString &normalized,
+		bool exact) const;
+
+private:
+	struct Node {
+		uint32 childrenBegin = 0;
+		uint32 childrenCount = 0;
+		uint32 keysBegin = 0;
+		uint32 keysEnd = 0;
+		QChar ch;
+	};
+
+	void fillChildren(uint32 index, int depth);
+	[[nodiscard]] const Node *find(const QString &normalized) const;
+	[[nodiscard]] gsl::span<const LangPackEmoji> emojiByKey(
+		uint32 index) const;
+
+	std::vector<Node> _nodes;
+	std::vector<QString> _keys;
+	std::vector<uint32> _emojiOffsets;
+	std::vector<LangPackEmoji> _emoji;
+	int _maxKeyLength = 0;
+
+};
+
 struct LangPackData {
 	int version = 0;
-	int maxKeyLength = 0;
-	std::map<QString, std::vector<LangPackEmoji>> emoji;
+	KeywordsTrie keywords;
 };
 
 [[nodiscard]] bool MustAddPostfix(const QString &text) {
@@ -99,7 +140,7 @@ void CreateCacheFilePath() {
 	if (!file.open(QIODevice::ReadOnly)) {
 		return {};
 	}
-	auto result = LangPackData();
+	auto emoji = KeywordsMap();
 	auto stream = QDataStream(&file);
 	stream.setVersion(QDataStream::Qt_5_1);
 	auto version = qint32();
@@ -119,7 +160,7 @@ void CreateCacheFilePath() {
 		if (size < 0 || stream.status() != QDataStream::Ok) {
 			return {};
 		}
-		auto &list = result.emoji[key];
+		auto &list = emoji[key];
 		for (auto j = 0; j != size; ++j) {
 			auto text = QString();
 			stream >> text;
@@ -135,14 +176,15 @@ void CreateCacheFilePath() {
 			}
 			list.push_back(entry);
 		}
-		result.maxKeyLength = std::max(result.maxKeyLength, int(key.size()));
 	}
-	result.version = version;
-	return result;
+	return { .version = version, .keywords = KeywordsTrie(emoji) };
 }
 
-void WriteLocalCache(const QString &id, const LangPackData &data) {
-	if (!data.version && data.emoji.empty()) {
+void WriteLocalCache(
+		const QString &id,
+		int version,
+		const KeywordsMap &emoji) {
+	if (!version && emoji.empty()) {
 		return;
 	}
 	CreateCacheFilePath();
@@ -153,9 +195,9 @@ void WriteLocalCache(const QString &id, const LangPackData &data) {
 	auto stream = QDataStream(&file);
 	stream.setVersion(QDataStream::Qt_5_1);
 	stream
-		<< qint32(data.version)
-		<< qint32(data.emoji.size());
-	for (const auto &[key, list] : data.emoji) {
+		<< qint32(version)
+		<< qint32(emoji.size());
+	for (const auto &[key, list] : emoji) {
 		stream
 			<< key
 			<< qint32(list.size());
@@ -176,7 +218,7 @@ void WriteLocalCache(const QString &id, const LangPackData &data) {
 void AppendFoundEmoji(
 		std::vector<Result> &result,
 		const QString &label,
-		const std::vector<LangPackEmoji> &list) {
+		gsl::span<const LangPackEmoji> list) {
 	// It is important that the 'result' won't relocate while inserting.
 	result.reserve(result.size() + list.size());
 	const auto alreadyBegin = begin(result);
@@ -242,17 +284,15 @@ void AppendLegacySuggestions(
 }
 
 void ApplyDifference(
-		LangPackData &data,
-		const QVector<MTPEmojiKeyword> &keywords,
-		int version) {
-	data.version = version;
+		KeywordsMap &data,
+		const QVector<MTPEmojiKeyword> &keywords) {
 	for (const auto &keyword : keywords) {
 		keyword.match([&](const MTPDemojiKeyword &keyword) {
 			const auto word = NormalizeKey(qs(keyword.vkeyword()));
 			if (word.isEmpty()) {
 				return;
 			}
-			auto &list = data.emoji[word];
+			auto &list = data[word];
 			auto &&emoji = ranges::views::all(
 				keyword.vemoticons().v
 			) | ranges::views::transform([](const MTPstring &string) {
@@ -276,8 +316,8 @@ void ApplyDifference(
 			if (word.isEmpty()) {
 				return;
 			}
-			const auto i = data.emoji.find(word);
-			if (i == end(data.emoji)) {
+			const auto i = data.find(word);
+			if (i == end(data)) {
 				return;
 			}
 			auto &list = i->second;
@@ -287,20 +327,120 @@ void ApplyDifference(
 					end(list));
 			}
 			if (list.empty()) {
-				data.emoji.erase(i);
+				data.erase(i);
 			}
 		});
 	}
-	if (data.emoji.empty()) {
-		data.maxKeyLength = 0;
-	} else {
-		auto &&lengths = ranges::views::all(
-			data.emoji
-		) | ranges::views::transform([](auto &&pair) {
-			return pair.first.size();
+}
+
+KeywordsTrie::KeywordsTrie(const KeywordsMap &emoji) {
+	if (emoji.empty()) {
+		return;
+	}
+	_keys.reserve(emoji.size());
+	_emojiOffsets.reserve(emoji.size() + 1);
+	for (const auto &[key, list] : emoji) {
+		_keys.push_back(key);
+		_emojiOffsets.push_back(uint32(_emoji.size()));
+		_emoji.insert(end(_emoji), begin(list), end(list));
+		_maxKeyLength = std::max(_maxKeyLength, int(key.size()));
+	}
+	_emojiOffsets.push_back(uint32(_emoji.size()));
+	_nodes.push_back({ .keysEnd = uint32(_keys.size()) });
+	fillChildren(0, 0);
+}
+
+void KeywordsTrie::fillChildren(uint32 index, int depth) {
+	auto from = _nodes[index].keysBegin;
+	const auto till = _nodes[index].keysEnd;
+	if (_keys[from].size() == depth) {
+		// The keyword ending in this node goes first in sorted order.
+		++from;
+	}
+	const auto childrenBegin = uint32(_nodes.size());
+	while (from != till) {
+		const auto ch = _keys[from][depth];
+		auto next = from + 1;
+		while (next != till && _keys[next][depth] == ch) {
+			++next;
+		}
+		_nodes.push_back({ .keysBegin = from, .keysEnd = next, .ch = ch });
+		from = next;
+	}
+	const auto childrenEnd = uint32(_nodes.size());
+	_nodes[index].childrenBegin = childrenBegin;
+	_nodes[index].childrenCount = childrenEnd - childrenBegin;
+	for (auto child = childrenBegin; child != childrenEnd; ++child) {
+		fillChildren(child, depth + 1);
+	}
+}
+
+bool KeywordsTrie::empty() const {
+	return _keys.empty();
+}
+
+int KeywordsTrie::maxKeyLength() const {
+	return _maxKeyLength;
+}
+
+KeywordsMap KeywordsTrie::unpack() const {
+	auto result = KeywordsMap();
+	for (auto i = uint32(0), count = uint32(_keys.size()); i != count; ++i) {
+		const auto list = emojiByKey(i);
+		result.emplace_hint(
+			end(result),
+			_keys[i],
+			std::vector<LangPackEmoji>(list.begin(), list.end()));
+	}
+	return result;
+}
+
+auto KeywordsTrie::find(const QString &normalized) const -> const Node* {
+	if (_nodes.empty()) {
+		return nullptr;
+	}
+	auto result = &_nodes.front();
+	for (const auto ch : normalized) {
+		const auto from = begin(_nodes) + result->childrenBegin;
+		const auto till = from + result->childrenCount;
+		const auto i = std::lower_bound(from, till, ch, [](
+				const Node &node,
+				QChar ch) {
+			return node.ch < ch;
 		});
-		data.maxKeyLength = *ranges::max_element(lengths);
+		if (i == till || i->ch != ch) {
+			return nullptr;
+		}
+		result = &*i;
+	}
+	return result;
+}
+
+gsl::span<const LangPackEmoji> KeywordsTrie::emojiByKey(
+		uint32 index) const {
+	const auto from = _emojiOffsets[index];
+	const auto till = _emojiOffsets[index + 1];
+	return gsl::make_span(_emoji).subspan(from, till - from);
+}
+
+std::vector<Result> KeywordsTrie::query(
+		const QString &normalized,
+		bool exact) const {
+	const auto node = find(normalized);
+	if (!node) {
+		return {};
 	}
+	const auto from = node->keysBegin;
+	const auto till = !exact
+		? node->keysEnd
+		: (_keys[from].size() == normalized.size())
+		? (from + 1)
+		: from;
+	auto result = std::vector<Result>();
+	for (auto i = from; i != till; ++i) {
+		AppendFoundEmoji(result, _keys[i], emojiByKey(i));
+	}
+	return result;
 }
 
 } // namespace
@@ -434,7 +574,7 @@ void EmojiKeywords::LangPack::applyDifference(
 			return;
 		}
 		const auto id = _id;
-		auto copy = _data;
+		auto copy = _data.keywords;
 		auto callback = crl::guard(_guard.make_guard(), [=](
 				LangPackData &&result) {
 			applyData(std::move(result));
@@ -442,10 +582,14 @@ void EmojiKeywords::LangPack::applyDifference(
 		crl::async([=,
 			copy = std::move(copy),
 			callback = std::move(callback)]() mutable {
-			ApplyDifference(copy, keywords, version);
-			WriteLocalCache(id, copy);
+			auto emoji = copy.unpack();
+			ApplyDifference(emoji, keywords);
+			WriteLocalCache(id, version, emoji);
 			crl::on_main([
-				result = std::move(copy),
+				result = LangPackData{
+					.version = version,
+					.keywords = KeywordsTrie(emoji),
+				},
 				callback = std::move(callback)
 			]() mutable {
 				callback(std::move(result));
@@ -473,30 +617,16 @@ void EmojiKeywords::LangPack::apiChanged() {
 std::vector<Result> EmojiKeywords::LangPack::query(
 		const QString &normalized,
 		bool exact) const {
-	if (normalized.size() > _data.maxKeyLength
-		|| _data.emoji.empty()
+	if (normalized.size() > _data.keywords.maxKeyLength()
+		|| _data.keywords.empty()
 		|| (exact && SkipExactKeyword(_id, normalized))) {
 		return {};
 	}
-
-	const auto from = _data.emoji.lower_bound(normalized);
-	auto &&chosen = ranges::make_subrange(
-		from,
-		end(_data.emoji)
-	) | ranges::views::take_while([&](const auto &pair) {
-		const auto &key = pair.first;
-		return exact ? (key == normalized) : key.startsWith(normalized);
-	});
-
-	auto result = std::vector<Result>();
-	for (const auto &[key, list] : chosen) {
-		AppendFoundEmoji(result, key, list);
-	}
-	return result;
+	return _data.keywords.query(normalized, exact);
 }
 
 int EmojiKeywords::LangPack::maxQueryLength() const {
-	return _data.maxKeyLength;
+	return _data.keywords.maxKeyLength();
 }
 
 EmojiKeywords::EmojiKeywords() {
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "chat_helpers/stickers_emoji_image_loader.h"
 
+#include "core/core_startup_trace.h"
 #include "styles/style_chat.h"
 
 #include <QtCore/QtMath>
@@ -24,6 +25,7 @@ void EmojiImageLoader::init(
 
 	_images = std::move(images);
 	if (largeEnabled) {
+		const auto phase = Core::StartupTrace::Phase("emoji images");
 		_images->ensureLoaded();
 	}
 }
@@ -61,6 +61,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/file_utilities.h"
 #include "core/click_handler_types.h" // ClickHandlerContext.
 #include "core/crash_reports.h"
+#include "core/core_startup_trace.h"
 #include "main/main_account.h"
 #include "main/main_domain.h"
 #include "main/main_session.h"
@@ -274,10 +275,15 @@ void Application::run() {
 	// Depends on notifications settings.
 	_notifications = std::make_unique<Window::Notifications::System>();
 
-	startLocalStorage();
-
-	style::SetCustomFont(settings().customFontFamily());
-	style::internal::StartFonts();
+	{
+		const auto phase = StartupTrace::Phase("local storage");
+		startLocalStorage();
+	}
+	{
+		const auto phase = StartupTrace::Phase("fonts");
+		style::SetCustomFont(settings().customFontFamily());
+		style::internal::StartFonts();
+	}
 
 	ValidateScale();
 
@@ -298,18 +304,36 @@ void Application::run() {
 		return;
 	}
 
+	// Create mime database in the background, so it won't be slow later.
+	crl::async([] {
+		const auto phase = StartupTrace::Phase("mime database");
+		QMimeDatabase().mimeTypeForName(u"text/plain"_q);
+	});
+
 	_translator = std::make_unique<Lang::Translator>();
 	QCoreApplication::instance()->installTranslator(_translator.get());
 
-	style::StartManager(cScale());
-	Ui::InitTextOptions();
-	Ui::StartCachedCorners();
-	Ui::Emoji::Init();
-	Ui::PreloadTextSpoilerMask();
-	startShortcuts();
+	{
+		const auto phase = StartupTrace::Phase("style");
+		style::StartManager(cScale());
+		Ui::InitTextOptions();
+		Ui::StartCachedCorners();
+	}
+	{
+		const auto phase = StartupTrace::Phase("emoji");
+		Ui::Emoji::Init();
+		Ui::PreloadTextSpoilerMask();
+	}
+	{
+		const auto phase = StartupTrace::Phase("shortcuts");
+		startShortcuts();
+	}
 	startEmojiImageLoader();
 	startSystemDarkModeViewer();
-	Media::Player::start(_audio.get());
+	{
+		const auto phase = StartupTrace::Phase("audio");
+		Media::Player::start(_audio.get());
+	}
 
 	if (MediaControlsManager::Supported()) {
 		_mediaControlsManager = std::make_unique<MediaControlsManager>();
@@ -335,13 +359,13 @@ void Application::run() {
 
 	DEBUG_LOG(("Application Info: starting app..."));
 
-	// Create mime database, so it won't be slow later.
-	QMimeDatabase().mimeTypeForName(u"text/plain"_q);
-
 	// Check now to avoid re-entrance later.
 	[[maybe_unused]] const auto ivSupported = Iv::ShowButton();
 
-	_windows.emplace(nullptr, std::make_unique<Window::Controller>());
+	{
+		const auto phase = StartupTrace::Phase("window");
+		_windows.emplace(nullptr, std::make_unique<Window::Controller>());
+	}
 	setLastActiveWindow(_windows.front().second.get());
 	_windowInSettings = _lastActivePrimaryWindow = _lastActiveWindow;
 
@@ -388,15 +412,28 @@ void Application::run() {
 
 	DEBUG_LOG(("Application Info: window created..."));
 
-	startDomain();
-	startTray();
-
-	_lastActivePrimaryWindow->firstShow();
-
-	startMediaView();
+	{
+		const auto phase = StartupTrace::Phase("domain");
+		startDomain();
+	}
+	{
+		const auto phase = StartupTrace::Phase("tray");
+		startTray();
+	}
+	{
+		const auto phase = StartupTrace::Phase("first show");
+		_lastActivePrimaryWindow->firstShow();
+	}
+	{
+		const auto phase = StartupTrace::Phase("media view");
+		startMediaView();
+	}
 
 	DEBUG_LOG(("Application Info: showing."));
-	_lastActivePrimaryWindow->finishFirstShow();
+	{
+		const auto phase = StartupTrace::Phase("finish first show");
+		_lastActivePrimaryWindow->finishFirstShow();
+	}
 
 	if (!_lastActivePrimaryWindow->locked() && cStartToSettings()) {
 		_lastActivePrimaryWindow->showSettings();
@@ -428,6 +465,8 @@ void Application::run() {
 	}
 
 	processCreatedWindow(_lastActivePrimaryWindow);
+
+	StartupTrace::Finish();
 }
 
 void Application::autoRegisterUrlScheme() {
@@ -0,0 +1,229 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/core_startup_trace.h"
+
+#include "base/options.h"
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
+#include <chrono>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else // Q_OS_WIN
+#include <time.h>
+#endif // Q_OS_WIN
+
+namespace Core::StartupTrace {
+namespace {
+
+struct Event {
+	const char *name = nullptr;
+	int thread = 0;
+	int64 started = 0;
+	int64 duration = 0;
+	int64 cpu = 0;
+	int64 read = 0;
+	int64 written = 0;
+};
+
+struct IoCounters {
+	int64 read = 0;
+	int64 written = 0;
+};
+
+base::options::toggle OptionStartupTrace({
+	.id = kOptionStartupTrace,
+	.name = "Write startup trace",
+	.description = "Save startup phases timings to startup_trace.json"
+		" in the working folder, viewable in chrome://tracing.",
+});
+
+std::atomic<bool> Tracing = false;
+std::chrono::steady_clock::time_point StartedAt;
+std::atomic<int> ThreadCounter = 0;
+QMutex EventsMutex;
+std::vector<Event> Events;
+
+[[nodiscard]] int64 Now() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - StartedAt).count();
+}
+
+[[nodiscard]] int ThreadIndex() {
+	static thread_local const auto result = ++ThreadCounter;
+	return result;
+}
+
+[[nodiscard]] int64 ThreadCpuTime() {
+#ifdef Q_OS_WIN
+	auto creation = FILETIME();
+	auto exit = FILETIME();
+	auto kernel = FILETIME();
+	auto user = FILETIME();
+	const auto thread = GetCurrentThread();
+	if (!GetThreadTimes(thread, &creation, &exit, &kernel, &user)) {
+		return 0;
+	}
+	const auto value = [](const FILETIME &time) {
+		return (int64(time.dwHighDateTime) << 32) | int64(time.dwLowDateTime);
+	};
+	return (value(kernel) + value(user)) / 10;
+#else // Q_OS_WIN
+	auto time = timespec();
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+		return 0;
+	}
+	return int64(time.tv_sec) * 1000000 + int64(time.tv_nsec) / 1000;
+#endif // Q_OS_WIN
+}
+
+// Process wide, so concurrent phases account each other's I/O too.
+[[nodiscard]] IoCounters ProcessIo() {
+#if defined Q_OS_WIN
+	auto counters = IO_COUNTERS();
+	if (!GetProcessIoCounters(GetCurrentProcess(), &counters)) {
+		return {};
+	}
+	return {
+		.read = int64(counters.ReadTransferCount),
+		.written = int64(counters.WriteTransferCount),
+	};
+#elif defined Q_OS_LINUX // Q_OS_WIN
+	auto file = QFile(u"/proc/self/io"_q);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return {};
+	}
+	auto result = IoCounters();
+	for (const auto &line : file.readAll().split('\n')) {
+		if (line.startsWith("rchar: ")) {
+			result.read = line.mid(7).toLongLong();
+		} else if (line.startsWith("wchar: ")) {
+			result.written = line.mid(7).toLongLong();
+		}
+	}
+	return result;
+#else // Q_OS_WIN || Q_OS_LINUX
+	return {};
+#endif // Q_OS_WIN || Q_OS_LINUX
+}
+
+[[nodiscard]] QJsonObject Serialize(const Event &event) {
+	auto args = QJsonObject();
+	args.insert(u"cpu_us"_q, double(event.cpu));
+	args.insert(u"read_bytes"_q, double(event.read));
+	args.insert(u"written_bytes"_q, double(event.written));
+
+	auto result = QJsonObject();
+	result.insert(u"name"_q, QString::fromLatin1(event.name));
+	result.insert(u"cat"_q, u"startup"_q);
+	result.insert(u"ph"_q, u"X"_q);
+	result.insert(u"pid"_q, 1);
+	result.insert(u"tid"_q, event.thread);
+	result.insert(u"ts"_q, double(event.started));
+	result.insert(u"dur"_q, double(event.duration));
+	result.insert(u"args"_q, args);
+	return result;
+}
+
+} // namespace
+
+const char kOptionStartupTrace[] = "startup-trace";
+
+void Start() {
+	if (!OptionStartupTrace.value()) {
+		return;
+	}
+	StartedAt = std::chrono::steady_clock::now();
+	Tracing = true;
+
+	// Let the thread that starts tracing be the main one in the trace.
+	[[maybe_unused]] const auto main = ThreadIndex();
+}
+
+void Finish() {
+	if (!Tracing.exchange(false)) {
+		return;
+	}
+	const auto finished = Now();
+	auto events = [&] {
+		QMutexLocker lock(&EventsMutex);
+		return base::take(Events);
+	}();
+
+	auto list = QJsonArray();
+	for (const auto &event : events) {
+		list.append(Serialize(event));
+	}
+	auto shown = QJsonObject();
+	shown.insert(u"name"_q, u"shown"_q);
+	shown.insert(u"cat"_q, u"startup"_q);
+	shown.insert(u"ph"_q, u"i"_q);
+	shown.insert(u"s"_q, u"g"_q);
+	shown.insert(u"pid"_q, 1);
+	shown.insert(u"tid"_q, ThreadIndex());
+	shown.insert(u"ts"_q, double(finished));
+	list.append(shown);
+
+	auto document = QJsonObject();
+	document.insert(u"traceEvents"_q, list);
+	document.insert(u"displayTimeUnit"_q, u"ms"_q);
+
+	const auto path = cWorkingDir() + u"startup_trace.json"_q;
+	auto file = QFile(path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		LOG(("Startup Trace Error: Could not write '%1'.").arg(path));
+		return;
+	}
+	file.write(QJsonDocument(document).toJson(QJsonDocument::Compact));
+	LOG(("Startup Trace: %1 phases, first show in %2 ms, saved to '%3'."
+		).arg(events.size()
+		).arg(finished / 1000
+		).arg(path));
+}
+
+bool Enabled() {
+	return Tracing.load(std::memory_order_relaxed);
+}
+
+Phase::Phase(const char *name) {
+	if (!Enabled()) {
+		return;
+	}
+	const auto io = ProcessIo();
+	_name = name;
+	_readStarted = io.read;
+	_writtenStarted = io.written;
+	_cpuStarted = ThreadCpuTime();
+	_started = Now();
+}
+
+Phase::~Phase() {
+	if (!_name || !Enabled()) {
+		return;
+	}
+	const auto finished = Now();
+	const auto cpu = ThreadCpuTime();
+	const auto io = ProcessIo();
+	auto event = Event{
+		.name = _name,
+		.thread = ThreadIndex(),
+		.started = _started,
+		.duration = finished - _started,
+		.cpu = cpu - _cpuStarted,
+		.read = io.read - _readStarted,
+		.written = io.written - _writtenStarted,
+	};
+
+	QMutexLocker lock(&EventsMutex);
+	Events.push_back(event);
+}
+
+} // namespace Core::StartupTrace
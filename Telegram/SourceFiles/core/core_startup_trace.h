@@ -0,0 +1,40 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Core::StartupTrace {
+
+extern const char kOptionStartupTrace[];
+
+// Must be called after options are inited.
+void Start();
+
+// Writes the collected phases as a Chrome trace JSON to the working dir.
+void Finish();
+
+[[nodiscard]] bool Enabled();
+
+// Records wall time, thread CPU time and process I/O of a scope.
+class Phase final {
+public:
+	explicit Phase(const char *name);
+	~Phase();
+
+	Phase(const Phase &) = delete;
+	Phase &operator=(const Phase &) = delete;
+
+private:
+	const char *_name = nullptr;
+	int64 _started = 0;
+	int64 _cpuStarted = 0;
+	int64 _readStarted = 0;
+	int64 _writtenStarted = 0;
+
+};
+
+} // namespace Core::StartupTrace
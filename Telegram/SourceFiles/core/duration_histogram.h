@@ -0,0 +1,71 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <crl/crl_time.h>
+#include <QtCore/QStringList>
+
+#include <array>
+#include <atomic>
+#include <bit>
+
+namespace Core {
+
+// Durations in power of two buckets: [0, 1), [1, 2), [2, 4), ... ms,
+// the last bucket has all the longer ones. Can be added to from any thread.
+template <int Buckets>
+class DurationHistogram final {
+public:
+	static constexpr auto kBuckets = Buckets;
+	using Snapshot = std::array<int64, kBuckets>;
+
+	void add(crl::time duration) {
+		const auto index = std::min(
+			int(std::bit_width(uint64(std::max(duration, crl::time(0))))),
+			kBuckets - 1);
+		_buckets[index].fetch_add(1, std::memory_order_relaxed);
+	}
+	[[nodiscard]] Snapshot snapshot() const {
+		auto result = Snapshot();
+		for (auto i = 0; i != kBuckets; ++i) {
+			result[i] = _buckets[i].load(std::memory_order_relaxed);
+		}
+		return result;
+	}
+
+	[[nodiscard]] static crl::time BucketTill(int index) {
+		Expects(index >= 0 && index < kBuckets);
+
+		return crl::time(1) << index;
+	}
+
+	// Non-empty buckets as "<1ms:N <2ms:N ... >=Xms:N", "-" if none.
+	[[nodiscard]] static QString Serialize(const Snapshot &snapshot) {
+		auto result = QStringList();
+		for (auto i = 0; i != kBuckets; ++i) {
+			if (!snapshot[i]) {
+				continue;
+			} else if (i + 1 == kBuckets) {
+				result.push_back(u">=%1ms:%2"_q
+					.arg(BucketTill(i - 1))
+					.arg(snapshot[i]));
+			} else {
+				result.push_back(u"<%1ms:%2"_q
+					.arg(BucketTill(i))
+					.arg(snapshot[i]));
+			}
+		}
+		return result.isEmpty() ? u"-"_q : result.join(' ');
+	}
+
+private:
+	std::array<std::atomic<int64>, kBuckets> _buckets = {};
+
+};
+
+} // namespace Core
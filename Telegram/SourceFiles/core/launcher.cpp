@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/platform/base_platform_file_utilities.h"
 #include "ui/main_queue_processor.h"
 #include "core/crash_reports.h"
+#include "core/core_startup_trace.h"
 #include "core/update_checker.h"
 #include "core/sandbox.h"
 #include "base/concurrent_timer.h"
@@ -362,6 +363,7 @@ int Launcher::exec() {
 	// Must be started before Platform is started.
 	Logs::start();
 	base::options::init(cWorkingDir() + "tdata/experimental_options.json");
+	StartupTrace::Start();
 
 	// Must be called after options are inited.
 	initHighDpi();
@@ -520,6 +522,7 @@ void Launcher::processArguments() {
 		{ "-workdir"        , KeyFormat::OneValue },
 		{ "--"              , KeyFormat::OneValue },
 		{ "-scale"          , KeyFormat::OneValue },
+		{ "-stallprofiler"  , KeyFormat::OneValue },
 	};
 	auto parseResult = QMap<QByteArray, QStringList>();
 	auto parsingKey = QByteArray();
@@ -574,6 +577,11 @@ void Launcher::processArguments() {
 			? kScaleAuto
 			: value;
 	}
+
+	const auto stallKey = parseResult.value("-stallprofiler", {});
+	if (stallKey.size() > 0) {
+		gStallThreshold = std::max(stallKey[0].toInt(), 0);
+	}
 }
 
 int Launcher::executeApplication() {
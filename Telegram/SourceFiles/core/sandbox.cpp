@@ -21,6 +21,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/local_url_handlers.h"
 #include "core/update_checker.h"
 #include "core/deadlock_detector.h"
+#include "core/stall_profiler.h"
 #include "base/timer.h"
 #include "base/concurrent_timer.h"
 #include "base/invoke_queued.h"
@@ -196,6 +197,12 @@ void Sandbox::launchApplication() {
 			_deadlockDetector = std::make_unique<PingThread>(this);
 		}
 #endif // !_DEBUG
+		if (const auto threshold = cStallThreshold()) {
+			using DeadlockDetector::StallProfilerThread;
+			_stallProfiler = std::make_unique<StallProfilerThread>(
+				this,
+				threshold);
+		}
 
 		_application = std::make_unique<Application>();
 
@@ -595,6 +602,7 @@ bool Sandbox::notify(QObject *receiver, QEvent *e) {
 	}
 
 	const auto wrap = createEventNestingLevel();
+	const auto mark = DeadlockDetector::DispatchMark(receiver, e);
 	if (e->type() == QEvent::UpdateRequest) {
 		const auto weak = QPointer<QObject>(receiver);
 		_widgetUpdateRequests.fire({});
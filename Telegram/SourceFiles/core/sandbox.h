@@ -132,6 +132,7 @@ private:
 	rpl::event_stream<> _widgetUpdateRequests;
 
 	std::unique_ptr<QThread> _deadlockDetector;
+	std::unique_ptr<QThread> _stallProfiler;
 
 };
 
@@ -0,0 +1,275 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/stall_profiler.h"
+
+#include "core/deadlock_detector.h"
+#include "base/invoke_queued.h"
+
+#include <QtCore/QMetaEnum>
+
+#if defined Q_OS_LINUX && defined TDESKTOP_USE_LIBUNWIND
+#define UNW_LOCAL_ONLY
+#include <libunwind.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#endif // Q_OS_LINUX && TDESKTOP_USE_LIBUNWIND
+
+namespace Core::DeadlockDetector {
+namespace {
+
+constexpr auto kPingInterval = crl::time(10);
+constexpr auto kReportInterval = 60 * crl::time(1000);
+constexpr auto kStackFrames = 64;
+constexpr auto kGroupByFrames = 8;
+constexpr auto kReportGroups = 32;
+
+std::atomic<bool> Marking = false;
+std::atomic<const char*> DispatchReceiver = nullptr;
+std::atomic<int> DispatchType = 0;
+
+#if defined Q_OS_LINUX && defined TDESKTOP_USE_LIBUNWIND
+
+constexpr auto kCaptureTimeout = crl::time(50);
+
+// Signal handler frame and the signal trampoline.
+constexpr auto kSkipFrames = 2;
+
+pthread_t MainThread;
+int CaptureSignal = 0;
+void *CapturedStack[kStackFrames] = { nullptr };
+std::atomic<int> CapturedFrames = 0;
+std::atomic<bool> Capturing = false;
+
+// Only async-signal-safe calls here, glibc backtrace() is not one of them,
+// it may take the loader lock or allocate while the main thread holds it.
+void CaptureHandler(int signal) {
+	const auto error = errno;
+	CapturedFrames = unw_backtrace(CapturedStack, kStackFrames);
+	Capturing = false;
+	errno = error;
+}
+
+void PrepareStackCapture() {
+	MainThread = pthread_self();
+	CaptureSignal = SIGRTMIN + 3;
+
+	// Let libunwind initialize itself outside of the handler.
+	unw_backtrace(CapturedStack, kStackFrames);
+
+	struct sigaction action = {};
+	action.sa_handler = CaptureHandler;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(CaptureSignal, &action, nullptr);
+}
+
+[[nodiscard]] QStringList CaptureMainStack() {
+	if (Capturing.exchange(true)) {
+		// Previous capture is still waiting for the handler.
+		return {};
+	}
+	CapturedFrames = 0;
+	if (pthread_kill(MainThread, CaptureSignal) != 0) {
+		Capturing = false;
+		return {};
+	}
+	const auto till = crl::now() + kCaptureTimeout;
+	while (Capturing && crl::now() < till) {
+		QThread::usleep(500);
+	}
+	const auto count = Capturing ? 0 : CapturedFrames.load();
+	if (count <= kSkipFrames) {
+		return {};
+	}
+	const auto symbols = backtrace_symbols(
+		CapturedStack + kSkipFrames,
+		count - kSkipFrames);
+	if (!symbols) {
+		return {};
+	}
+	auto result = QStringList();
+	for (auto i = 0; i != count - kSkipFrames; ++i) {
+		result.push_back(QString::fromLocal8Bit(symbols[i]));
+	}
+	free(symbols);
+	return result;
+}
+
+#else // Q_OS_LINUX && TDESKTOP_USE_LIBUNWIND
+
+void PrepareStackCapture() {
+}
+
+[[nodiscard]] QStringList CaptureMainStack() {
+	return {};
+}
+
+#endif // Q_OS_LINUX && TDESKTOP_USE_LIBUNWIND
+
+[[nodiscard]] QString DescribeDispatch() {
+	const auto receiver = DispatchReceiver.load();
+	if (!receiver) {
+		return u"event loop"_q;
+	}
+	const auto type = QEvent::Type(DispatchType.load());
+	const auto name = (type == base::InvokeQueuedEvent::Type())
+		? "InvokeQueued"
+		: (type == PingPongEvent::Type())
+		? "PingPong"
+		: QMetaEnum::fromType<QEvent::Type>().valueToKey(type);
+	return u"%1 to %2"_q.arg(
+		name ? QString::fromLatin1(name) : u"Event(%1)"_q.arg(int(type)),
+		QString::fromLatin1(receiver));
+}
+
+} // namespace
+
+DispatchMark::DispatchMark(QObject *receiver, not_null<QEvent*> e) {
+	if (!receiver || !Marking.load(std::memory_order_relaxed)) {
+		return;
+	}
+	_marked = true;
+	_receiver = DispatchReceiver.exchange(receiver->metaObject()->className());
+	_type = DispatchType.exchange(int(e->type()));
+}
+
+DispatchMark::~DispatchMark() {
+	if (_marked) {
+		DispatchReceiver = _receiver;
+		DispatchType = _type;
+	}
+}
+
+StallProfiler::StallProfiler(not_null<QObject*> receiver, crl::time threshold)
+: _receiver(receiver)
+, _threshold(threshold)
+, _pingTimer([=] { ping(); }) {
+	Marking = true;
+	_pingTimer.callEach(kPingInterval);
+	ping();
+}
+
+StallProfiler::~StallProfiler() {
+	Marking = false;
+	writeReport();
+}
+
+bool StallProfiler::event(QEvent *e) {
+	if (e->type() == PingPongEvent::Type()
+		&& static_cast<PingPongEvent*>(e)->sender() == _receiver) {
+		pong();
+	}
+	return QObject::event(e);
+}
+
+void StallProfiler::ping() {
+	const auto now = crl::now();
+	if (!_pingSent) {
+		_pingSent = now;
+		QCoreApplication::postEvent(_receiver, new PingPongEvent(this));
+	} else if (_stallKey.isEmpty() && now - _pingSent >= _threshold) {
+		capture();
+	}
+	if (_reportChanged && now - _reportWritten >= kReportInterval) {
+		writeReport();
+	}
+}
+
+void StallProfiler::capture() {
+	// Main thread is still stuck, so it is inside the stalling code now.
+	const auto dispatch = DescribeDispatch();
+	const auto stack = CaptureMainStack();
+	_stallKey = dispatch + '\n' + stack.mid(0, kGroupByFrames).join('\n');
+	auto &group = _groups[_stallKey];
+	if (!group.count) {
+		group.dispatch = dispatch;
+		group.stack = stack;
+	}
+}
+
+void StallProfiler::pong() {
+	const auto latency = crl::now() - _pingSent;
+	_pingSent = 0;
+	_latencies.add(latency);
+	if (_stallKey.isEmpty()) {
+		return;
+	}
+	_stalls.add(latency);
+	auto &group = _groups[base::take(_stallKey)];
+	++group.count;
+	group.total += latency;
+	group.max = std::max(group.max, latency);
+	_reportChanged = true;
+
+	LOG(("Stall: %1 ms in %2.").arg(latency).arg(group.dispatch));
+}
+
+void StallProfiler::writeReport() {
+	_reportWritten = crl::now();
+	if (!base::take(_reportChanged)) {
+		return;
+	}
+	auto groups = std::vector<const Group*>();
+	groups.reserve(_groups.size());
+	for (const auto &[key, group] : _groups) {
+		if (group.count) {
+			groups.push_back(&group);
+		}
+	}
+	ranges::sort(groups, ranges::greater(), &Group::total);
+	if (int(groups.size()) > kReportGroups) {
+		groups.resize(kReportGroups);
+	}
+
+	auto result = u"Stall threshold: %1 ms\n"_q.arg(_threshold)
+		+ u"Event loop latency: "_q
+		+ Histogram::Serialize(_latencies.snapshot())
+		+ u"\nStalls: "_q
+		+ Histogram::Serialize(_stalls.snapshot())
+		+ '\n';
+	for (const auto group : groups) {
+		result += u"\n%1 stalls, %2 ms total, %3 ms max, in %4\n"_q
+			.arg(group->count)
+			.arg(group->total)
+			.arg(group->max)
+			.arg(group->dispatch);
+		for (const auto &frame : group->stack) {
+			result += u"  "_q + frame + '\n';
+		}
+	}
+
+	const auto path = cWorkingDir() + u"hitch_report.txt"_q;
+	auto file = QFile(path);
+	if (file.open(QIODevice::WriteOnly)) {
+		file.write(result.toUtf8());
+	} else {
+		LOG(("Stall Error: Could not write '%1'.").arg(path));
+	}
+}
+
+StallProfilerThread::StallProfilerThread(
+	not_null<QObject*> parent,
+	crl::time threshold)
+: QThread(parent)
+, _threshold(threshold) {
+	PrepareStackCapture();
+	start();
+}
+
+StallProfilerThread::~StallProfilerThread() {
+	quit();
+	wait();
+}
+
+void StallProfilerThread::run() {
+	StallProfiler profiler(parent(), _threshold);
+	QThread::run();
+}
+
+} // namespace Core::DeadlockDetector
@@ -0,0 +1,84 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "core/duration_histogram.h"
+#include "base/timer.h"
+
+namespace Core::DeadlockDetector {
+
+// Remembers the event dispatched by the main thread for the stall report.
+class DispatchMark final {
+public:
+	DispatchMark(QObject *receiver, not_null<QEvent*> e);
+	~DispatchMark();
+
+	DispatchMark(const DispatchMark &) = delete;
+	DispatchMark &operator=(const DispatchMark &) = delete;
+
+private:
+	const char *_receiver = nullptr;
+	int _type = 0;
+	bool _marked = false;
+
+};
+
+// Pings the main loop often and reports the stalls over the threshold.
+class StallProfiler final : public QObject {
+public:
+	using Histogram = DurationHistogram<14>;
+
+	StallProfiler(not_null<QObject*> receiver, crl::time threshold);
+	~StallProfiler();
+
+protected:
+	bool event(QEvent *e) override;
+
+private:
+	struct Group {
+		QString dispatch;
+		QStringList stack;
+		int count = 0;
+		crl::time total = 0;
+		crl::time max = 0;
+	};
+
+	void ping();
+	void capture();
+	void pong();
+	void writeReport();
+
+	const not_null<QObject*> _receiver;
+	const crl::time _threshold = 0;
+	base::Timer _pingTimer;
+
+	crl::time _pingSent = 0;
+	crl::time _reportWritten = 0;
+	QString _stallKey;
+	bool _reportChanged = false;
+
+	Histogram _latencies;
+	Histogram _stalls;
+	base::flat_map<QString, Group> _groups;
+
+};
+
+class StallProfilerThread final : public QThread {
+public:
+	StallProfilerThread(not_null<QObject*> parent, crl::time threshold);
+	~StallProfilerThread();
+
+protected:
+	void run() override;
+
+private:
+	const crl::time _threshold = 0;
+
+};
+
+} // namespace Core::DeadlockDetector
@@ -11,6 +11,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Data {
 
+template <typename DataType, typename UpdateType>
+Changes::Manager<DataType, UpdateType>::~Manager() {
+	// Finishing the object subscriptions calls unsubscribe().
+	base::take(_objectStreams);
+}
+
 template <typename DataType, typename UpdateType>
 void Changes::Manager<DataType, UpdateType>::updated(
 		not_null<DataType*> data,
@@ -23,7 +29,7 @@ void Changes::Manager<DataType, UpdateType>::updated(
 			flags |= i->second;
 			_updates.erase(i);
 		}
-		_stream.fire({ data, flags });
+		send(data, flags);
 	} else {
 		_updates[data] |= flags;
 	}
@@ -54,11 +60,72 @@ template <typename DataType, typename UpdateType>
 rpl::producer<UpdateType> Changes::Manager<DataType, UpdateType>::updates(
 		not_null<DataType*> data,
 		Flags flags) const {
-	return _stream.events(
-	) | rpl::filter([=](const UpdateType &update) {
-		const auto &[updateData, updateFlags] = update;
-		return (updateData == data) && (updateFlags & flags);
-	});
+	return [=](auto consumer) {
+		auto &entry = _objectStreams[data];
+		if (!entry) {
+			entry = std::make_unique<ObjectStream>();
+		}
+		++entry->subscribers;
+		++_objectSubscribers;
+
+		auto result = rpl::lifetime();
+
+		// Lifetime callbacks are destroyed in reverse order,
+		// so we unsubscribe after the subscription is finished.
+		result.add([=] { unsubscribe(data); });
+		entry->stream.events(
+		) | rpl::filter([=](const UpdateType &update) {
+			return (update.flags & flags);
+		}) | rpl::start_with_next_done([=](const UpdateType &update) {
+			consumer.put_next_copy(update);
+		}, [=] {
+			consumer.put_done();
+		}, result);
+		return result;
+	};
+}
+
+template <typename DataType, typename UpdateType>
+void Changes::Manager<DataType, UpdateType>::unsubscribe(
+		not_null<DataType*> data) const {
+	const auto i = _objectStreams.find(data);
+	if (i == end(_objectStreams)) {
+		return;
+	}
+	--_objectSubscribers;
+	if (--i->second->subscribers > 0) {
+		return;
+	} else if (_sending) {
+		_unusedObjectStreams.push_back(data);
+	} else {
+		_objectStreams.erase(i);
+	}
+}
+
+template <typename DataType, typename UpdateType>
+void Changes::Manager<DataType, UpdateType>::removeUnusedObjectStreams() {
+	for (const auto data : base::take(_unusedObjectStreams)) {
+		const auto i = _objectStreams.find(data);
+		if (i != end(_objectStreams) && !i->second->subscribers) {
+			_objectStreams.erase(i);
+		}
+	}
+}
+
+template <typename DataType, typename UpdateType>
+void Changes::Manager<DataType, UpdateType>::send(
+		not_null<DataType*> data,
+		Flags flags) {
+	++_sending;
+	++_sent;
+	_stream.fire({ data, flags });
+	if (const auto i = _objectStreams.find(data); i != end(_objectStreams)) {
+		++_sentToObjects;
+		i->second->stream.fire({ data, flags });
+	}
+	if (!--_sending && !_unusedObjectStreams.empty()) {
+		removeUnusedObjectStreams();
+	}
 }
 
 template <typename DataType, typename UpdateType>
@@ -84,10 +151,18 @@ void Changes::Manager<DataType, UpdateType>::drop(not_null<DataType*> data) {
 template <typename DataType, typename UpdateType>
 void Changes::Manager<DataType, UpdateType>::sendNotifications() {
 	for (const auto &[data, flags] : base::take(_updates)) {
-		_stream.fire({ data, flags });
+		send(data, flags);
 	}
 }
 
+template <typename DataType, typename UpdateType>
+void Changes::Manager<DataType, UpdateType>::addStats(Stats &to) const {
+	to.sent += _sent;
+	to.sentToObjects += _sentToObjects;
+	to.objectStreams += int(_objectStreams.size());
+	to.objectSubscribers += _objectSubscribers;
+}
+
 Changes::Changes(not_null<Main::Session*> session) : _session(session) {
 }
 
@@ -313,6 +388,17 @@ void Changes::scheduleNotifications() {
 	}
 }
 
+Changes::Stats Changes::stats() const {
+	auto result = Stats();
+	_peerChanges.addStats(result);
+	_historyChanges.addStats(result);
+	_topicChanges.addStats(result);
+	_messageChanges.addStats(result);
+	_entryChanges.addStats(result);
+	_storyChanges.addStats(result);
+	return result;
+}
+
 void Changes::sendNotifications() {
 	if (!_notify) {
 		return;
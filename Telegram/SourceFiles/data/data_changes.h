@@ -343,6 +343,14 @@ public:
 
 	void sendNotifications();
 
+	struct Stats {
+		int64 sent = 0; // Updates fired by all managers.
+		int64 sentToObjects = 0; // Of them fired to object subscribers.
+		int objectStreams = 0;
+		int objectSubscribers = 0;
+	};
+	[[nodiscard]] Stats stats() const;
+
 private:
 	template <typename DataType, typename UpdateType>
 	class Manager final {
@@ -350,6 +358,11 @@ private:
 		using Flag = typename UpdateType::Flag;
 		using Flags = typename UpdateType::Flags;
 
+		Manager() = default;
+		Manager(const Manager &other) = delete;
+		Manager &operator=(const Manager &other) = delete;
+		~Manager();
+
 		void updated(
 			not_null<DataType*> data,
 			Flags flags,
@@ -367,18 +380,38 @@ private:
 		void drop(not_null<DataType*> data);
 
 		void sendNotifications();
+		void addStats(Stats &to) const;
 
 	private:
 		static constexpr auto kCount = details::CountBit<Flag>() + 1;
 
+		struct ObjectStream {
+			rpl::event_stream<UpdateType> stream;
+			int subscribers = 0;
+		};
+
 		void sendRealtimeNotifications(
 			not_null<DataType*> data,
 			Flags flags);
+		void send(not_null<DataType*> data, Flags flags);
+		void unsubscribe(not_null<DataType*> data) const;
+		void removeUnusedObjectStreams();
 
 		std::array<rpl::event_stream<UpdateType>, kCount> _realtimeStreams;
 		base::flat_map<not_null<DataType*>, Flags> _updates;
 		rpl::event_stream<UpdateType> _stream;
 
+		// Subscribers of a single object don't see updates of others.
+		// The streams without subscribers are removed when not sending.
+		mutable base::flat_map<
+			not_null<DataType*>,
+			std::unique_ptr<ObjectStream>> _objectStreams;
+		mutable std::vector<not_null<DataType*>> _unusedObjectStreams;
+		mutable int _objectSubscribers = 0;
+		int _sending = 0;
+		int64 _sent = 0;
+		int64 _sentToObjects = 0;
+
 	};
 
 	void scheduleNotifications();
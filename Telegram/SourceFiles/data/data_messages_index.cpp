@@ -0,0 +1,128 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_messages_index.h"
+
+namespace Data {
+namespace {
+
+constexpr auto kMinCapacity = 1024;
+
+// Max load factor is kMaxLoadNumerator / kMaxLoadDenominator.
+constexpr auto kMaxLoadNumerator = 3;
+constexpr auto kMaxLoadDenominator = 4;
+
+// The table is halved when the load falls below 1 / kMinLoadDenominator,
+// so after mass erases (like unloading a big history) the memory is given
+// back, while the halved table is still far from the growth threshold.
+constexpr auto kMinLoadDenominator = 8;
+
+[[nodiscard]] uint64 Mix(uint64 value) {
+	value ^= value >> 33;
+	value *= 0xFF51AFD7ED558CCDULL;
+	value ^= value >> 33;
+	value *= 0xC4CEB9FE1A85EC53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+} // namespace
+
+uint64 MessagesIndex::Hash(PeerId peerId, MsgId msgId) {
+	return Mix(peerId.value ^ Mix(uint64(msgId.bare)));
+}
+
+int MessagesIndex::lookup(PeerId peerId, MsgId msgId) const {
+	if (_slots.empty()) {
+		return -1;
+	}
+	const auto mask = uint64(_slots.size() - 1);
+	for (auto i = Hash(peerId, msgId) & mask;; i = (i + 1) & mask) {
+		const auto &slot = _slots[i];
+		if (!slot.item) {
+			return -1;
+		} else if (slot.msgId == msgId && slot.peerId == peerId) {
+			return int(i);
+		}
+	}
+}
+
+HistoryItem *MessagesIndex::find(PeerId peerId, MsgId msgId) const {
+	const auto index = lookup(peerId, msgId);
+	return (index >= 0) ? _slots[index].item : nullptr;
+}
+
+bool MessagesIndex::insert(
+		PeerId peerId,
+		MsgId msgId,
+		not_null<HistoryItem*> item) {
+	if ((_size + 1) * kMaxLoadDenominator
+		> int(_slots.size()) * kMaxLoadNumerator) {
+		rehash(std::max(int(_slots.size()) * 2, kMinCapacity));
+	}
+	const auto mask = uint64(_slots.size() - 1);
+	for (auto i = Hash(peerId, msgId) & mask;; i = (i + 1) & mask) {
+		auto &slot = _slots[i];
+		if (!slot.item) {
+			slot = Slot{ peerId, msgId, item };
+			++_size;
+			return true;
+		} else if (slot.msgId == msgId && slot.peerId == peerId) {
+			return false;
+		}
+	}
+}
+
+HistoryItem *MessagesIndex::take(PeerId peerId, MsgId msgId) {
+	const auto index = lookup(peerId, msgId);
+	if (index < 0) {
+		return nullptr;
+	}
+	const auto result = _slots[index].item;
+	const auto mask = uint64(_slots.size() - 1);
+	auto hole = uint64(index);
+	for (auto i = (hole + 1) & mask; _slots[i].item; i = (i + 1) & mask) {
+		// Move the slot back to the hole, unless its home position
+		// lies cyclically in (hole, i], where the hole doesn't affect it.
+		const auto &slot = _slots[i];
+		const auto home = Hash(slot.peerId, slot.msgId) & mask;
+		const auto stays = (hole < i)
+			? (home > hole && home <= i)
+			: (home > hole || home <= i);
+		if (!stays) {
+			_slots[hole] = slot;
+			hole = i;
+		}
+	}
+	_slots[hole] = Slot();
+	--_size;
+	const auto capacity = int(_slots.size());
+	if (capacity > kMinCapacity && _size * kMinLoadDenominator < capacity) {
+		rehash(capacity / 2);
+	}
+	return result;
+}
+
+void MessagesIndex::clear() {
+	base::take(_slots);
+	_size = 0;
+}
+
+void MessagesIndex::rehash(int capacity) {
+	Expects(!(capacity & (capacity - 1)));
+	Expects(capacity * kMaxLoadNumerator >= _size * kMaxLoadDenominator);
+
+	auto was = std::exchange(_slots, std::vector<Slot>(capacity));
+	_size = 0;
+	for (const auto &slot : was) {
+		if (slot.item) {
+			insert(slot.peerId, slot.msgId, slot.item);
+		}
+	}
+}
+
+} // namespace Data
@@ -0,0 +1,44 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class HistoryItem;
+
+namespace Data {
+
+// All loaded messages of a session by (PeerId, MsgId) in a single flat
+// open addressing table: linear probing over a power of two array with
+// backward shift deletion, so there are no tombstones and no allocations
+// per message. Both parts of the key are stored as is, because MsgId
+// values don't fit in the bits that PeerId leaves free.
+class MessagesIndex final {
+public:
+	[[nodiscard]] HistoryItem *find(PeerId peerId, MsgId msgId) const;
+
+	// Returns false if there already is an item for this key.
+	bool insert(PeerId peerId, MsgId msgId, not_null<HistoryItem*> item);
+	HistoryItem *take(PeerId peerId, MsgId msgId);
+	void clear();
+
+private:
+	struct Slot {
+		PeerId peerId;
+		MsgId msgId;
+		HistoryItem *item = nullptr;
+	};
+
+	[[nodiscard]] static uint64 Hash(PeerId peerId, MsgId msgId);
+	[[nodiscard]] int lookup(PeerId peerId, MsgId msgId) const;
+	void rehash(int capacity);
+
+	std::vector<Slot> _slots;
+	int _size = 0;
+
+};
+
+} // namespace Data
@@ -31,6 +31,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "inline_bots/inline_bot_layout_item.h"
 #include "storage/storage_account.h"
 #include "storage/storage_encrypted_file.h"
+#include "storage/storage_messages_store.h"
 #include "media/player/media_player_instance.h" // instance()->play()
 #include "media/audio/media_audio.h"
 #include "boxes/abstract_box.h"
@@ -217,6 +218,7 @@ Session::Session(not_null<Main::Session*> session)
 , _bigFileCache(Core::App().databases().get(
 	_session->local().cacheBigFilePath(),
 	_session->local().cacheBigFileSettings()))
+, _messagesStore(std::make_unique<Storage::MessagesStore>(this))
 , _groupFreeTranscribeLevel(session->appConfig().value(
 ) | rpl::map([limits = Data::LevelLimits(session)] {
 	return limits.groupTranscribeLevelMin();
@@ -391,7 +393,7 @@ void Session::clear() {
 	_session->scheduledMessages().clear();
 	_session->sponsoredMessages().clear();
 	_dependentMessages.clear();
-	base::take(_messages);
+	_messages.clear();
 	base::take(_nonChannelMessages);
 	_messageByRandomId.clear();
 	_sentMessagesData.clear();
@@ -1646,14 +1648,11 @@ rpl::producer<not_null<HistoryItem*>> Session::newItemAdded() const {
 }
 
 HistoryItem *Session::changeMessageId(PeerId peerId, MsgId wasId, MsgId nowId) {
-	const auto list = messagesListForInsert(peerId);
-	const auto i = list->find(wasId);
-	if (i == list->end()) {
+	const auto item = _messages.take(peerId, wasId);
+	if (!item) {
 		return nullptr;
 	}
-	const auto item = i->second;
-	list->erase(i);
-	const auto &[j, ok] = list->emplace(nowId, item);
+	const auto ok = _messages.insert(peerId, nowId, item);
 
 	if (!peerIsChannel(peerId)) {
 		if (IsServerMsgId(wasId)) {
@@ -2152,6 +2151,22 @@ void Session::applyDialogs(
 	}
 }
 
+void Session::applyStoredDialogs(
+		const QVector<MTPMessage> &messages,
+		const QVector<MTPDialog> &dialogs) {
+	processMessages(messages, NewMessageType::Last);
+	for (const auto &dialog : dialogs) {
+		dialog.match([&](const MTPDdialog &data) {
+			if (const auto peerId = peerFromMTP(data.vpeer())) {
+				const auto history = this->history(peerId);
+				history->applyStoredDialog(data);
+				setPinnedFromEntryList(history, data.is_pinned());
+			}
+		}, [](const MTPDdialogFolder &) {
+		});
+	}
+}
+
 void Session::applyDialog(
 		Data::Folder *requestFolder,
 		const MTPDdialog &data) {
@@ -2415,26 +2430,14 @@ void Session::processExistingMessages(
 	});
 }
 
-const Session::Messages *Session::messagesList(PeerId peerId) const {
-	const auto i = _messages.find(peerId);
-	return (i != end(_messages)) ? &i->second : nullptr;
-}
-
-auto Session::messagesListForInsert(PeerId peerId)
--> not_null<Messages*> {
-	return &_messages[peerId];
-}
-
 void Session::registerMessage(not_null<HistoryItem*> item) {
 	const auto peerId = item->history()->peer->id;
-	const auto list = messagesListForInsert(peerId);
 	const auto itemId = item->id;
-	const auto i = list->find(itemId);
-	if (i != list->end()) {
+	if (const auto existing = _messages.find(peerId, itemId)) {
 		LOG(("App Error: Trying to re-registerMessage()."));
-		i->second->destroy();
+		existing->destroy();
 	}
-	list->emplace(itemId, item);
+	_messages.insert(peerId, itemId, item);
 
 	if (!peerIsChannel(peerId) && IsServerMsgId(itemId)) {
 		_nonChannelMessages.emplace(itemId, item);
@@ -2495,18 +2498,17 @@ void Session::checkTTLs() {
 void Session::processMessagesDeleted(
 		PeerId peerId,
 		const QVector<MTPint> &data) {
-	const auto list = messagesList(peerId);
-	const auto affected = historyLoaded(peerId);
-	if (!list && !affected) {
-		return;
+	for (const auto &messageId : data) {
+		_messagesStore->remove(FullMsgId(peerId, messageId.v));
 	}
 
+	const auto affected = historyLoaded(peerId);
+
 	auto historiesToCheck = base::flat_set<not_null<History*>>();
 	for (const auto &messageId : data) {
-		const auto i = list ? list->find(messageId.v) : Messages::iterator();
-		if (list && i != list->end()) {
-			const auto history = i->second->history();
-			i->second->destroy();
+		if (const auto item = _messages.find(peerId, messageId.v)) {
+			const auto history = item->history();
+			item->destroy();
 			if (!history->chatListMessageKnown()) {
 				historiesToCheck.emplace(history);
 			}
@@ -2524,6 +2526,7 @@ void Session::processNonChannelMessagesDeleted(const QVector<MTPint> &data) {
 	for (const auto &messageId : data) {
 		if (const auto item = nonChannelMessage(messageId.v)) {
 			const auto history = item->history();
+			_messagesStore->remove(item->fullId());
 			item->destroy();
 			if (!history->chatListMessageKnown()) {
 				historiesToCheck.emplace(history);
@@ -2573,7 +2576,7 @@ void Session::unregisterMessage(not_null<HistoryItem*> item) {
 			++i;
 		}
 	}
-	messagesListForInsert(peerId)->erase(itemId);
+	_messages.take(peerId, itemId);
 
 	if (!peerIsChannel(peerId) && IsServerMsgId(itemId)) {
 		_nonChannelMessages.erase(itemId);
@@ -2605,13 +2608,7 @@ HistoryItem *Session::message(PeerId peerId, MsgId itemId) const {
 		return nullptr;
 	}
 
-	const auto data = messagesList(peerId);
-	if (!data) {
-		return nullptr;
-	}
-
-	const auto i = data->find(itemId);
-	return (i != data->end()) ? i->second.get() : nullptr;
+	return _messages.find(peerId, itemId);
 }
 
 HistoryItem *Session::message(
@@ -4803,6 +4800,7 @@ void Session::clearLocalStorage() {
 	_cache->clear();
 	_bigFileCache->close();
 	_bigFileCache->clear();
+	_messagesStore->clear();
 }
 
 } // namespace Data
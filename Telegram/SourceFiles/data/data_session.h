@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/storage_databases.h"
 #include "dialogs/dialogs_main_list.h"
 #include "data/data_groups.h"
+#include "data/data_messages_index.h"
 #include "data/data_cloud_file.h"
 #include "history/history_location_manager.h"
 #include "base/timer.h"
@@ -39,6 +40,10 @@ namespace Passport {
 struct SavedCredentials;
 } // namespace Passport
 
+namespace Storage {
+class MessagesStore;
+} // namespace Storage
+
 namespace Iv {
 class Data;
 } // namespace Iv
@@ -175,6 +180,9 @@ public:
 
 	[[nodiscard]] Storage::Cache::Database &cache();
 	[[nodiscard]] Storage::Cache::Database &cacheBigFile();
+	[[nodiscard]] Storage::MessagesStore &messagesStore() const {
+		return *_messagesStore;
+	}
 
 	[[nodiscard]] not_null<PeerData*> peer(PeerId id);
 	[[nodiscard]] not_null<PeerData*> peer(UserId id) = delete;
@@ -369,6 +377,9 @@ public:
 		const QVector<MTPMessage> &messages,
 		const QVector<MTPDialog> &dialogs,
 		std::optional<int> count = std::nullopt);
+	void applyStoredDialogs(
+		const QVector<MTPMessage> &messages,
+		const QVector<MTPDialog> &dialogs);
 
 	[[nodiscard]] bool pinnedCanPin(not_null<Dialogs::Entry*> entry) const;
 	[[nodiscard]] bool pinnedCanPin(
@@ -776,8 +787,6 @@ public:
 	void clearLocalStorage();
 
 private:
-	using Messages = std::unordered_map<MsgId, not_null<HistoryItem*>>;
-
 	void suggestStartExport();
 
 	void setupMigrationViewer();
@@ -799,8 +808,6 @@ private:
 		Folder *requestFolder,
 		const MTPDdialogFolder &data);
 
-	const Messages *messagesList(PeerId peerId) const;
-	not_null<Messages*> messagesListForInsert(PeerId peerId);
 	not_null<HistoryItem*> registerMessage(
 		std::unique_ptr<HistoryItem> item);
 	HistoryItem *changeMessageId(PeerId peerId, MsgId wasId, MsgId nowId);
@@ -909,6 +916,7 @@ private:
 
 	Storage::DatabasePointer _cache;
 	Storage::DatabasePointer _bigFileCache;
+	const std::unique_ptr<Storage::MessagesStore> _messagesStore;
 
 	TimeId _exportAvailableAt = 0;
 	QPointer<Ui::BoxContent> _exportSuggestion;
@@ -950,7 +958,7 @@ private:
 	Dialogs::IndexedList _contactsNoChatsList;
 
 	MsgId _localMessageIdCounter = StartClientMsgId;
-	std::unordered_map<PeerId, Messages> _messages;
+	MessagesIndex _messages;
 	std::map<
 		not_null<HistoryItem*>,
 		base::flat_set<not_null<HistoryItem*>>> _dependentMessages;
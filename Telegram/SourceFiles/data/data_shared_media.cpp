@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "main/main_session.h"
 #include "apiwrap.h"
 #include "storage/storage_facade.h"
+#include "storage/storage_messages_store.h"
 #include "history/history.h"
 #include "history/history_item.h"
 #include "data/components/scheduled_messages.h"
@@ -107,11 +108,17 @@ rpl::producer<SparseIdsSlice> SharedMediaViewer(
 			key.messageId,
 			limitBefore,
 			limitAfter);
+		const auto hydrating = lifetime.make_state<bool>(true);
 		auto requestMediaAround = [
 			peer = session->data().peer(key.peerId),
 			topicRootId = key.topicRootId,
-			type = key.type
+			type = key.type,
+			hydrating
 		](const SparseIdsSliceBuilder::AroundData &data) {
+			if (*hydrating) {
+				// Requested again after the stored list is applied.
+				return;
+			}
 			peer->session().api().requestSharedMedia(
 				peer,
 				topicRootId,
@@ -176,6 +183,16 @@ rpl::producer<SparseIdsSlice> SharedMediaViewer(
 			[=] { builder->checkInsufficient(); },
 			lifetime);
 
+		const auto guard = lifetime.make_state<base::has_weak_ptr>();
+		session->data().messagesStore().hydrateSharedMedia(
+			key.peerId,
+			key.topicRootId,
+			key.type,
+			crl::guard(guard, [=] {
+				*hydrating = false;
+				builder->checkInsufficient();
+			}));
+
 		return lifetime;
 	};
 }
@@ -42,6 +42,8 @@ namespace Data {
 namespace {
 
 constexpr auto kMaxPerRequest = 100;
+constexpr auto kMaxUnusedInstances = 64;
+constexpr auto kEvictUnusedInstancesDelay = crl::time(1000);
 #if 0 // inject-to-on_main
 constexpr auto kUnsubscribeUpdatesDelay = 3 * crl::time(1000);
 #endif
@@ -440,8 +442,83 @@ Ui::CustomEmoji::Preview CustomEmojiLoader::preview() {
 	return {};
 }
 
+// Counts the objects of a shared instance, so that it can be destroyed
+// when no one uses it, and remembers when it was painted the last time.
+class CustomEmojiManager::SharedObject final
+	: public Ui::Text::CustomEmoji {
+public:
+	SharedObject(
+		std::unique_ptr<Ui::Text::CustomEmoji> wrapped,
+		std::shared_ptr<InstanceUsage> usage,
+		base::weak_ptr<CustomEmojiManager> manager);
+	~SharedObject();
+
+	int width() override;
+	QString entityData() override;
+	void paint(QPainter &p, const Context &context) override;
+	void unload() override;
+	bool ready() override;
+	bool readyInDefaultState() override;
+
+private:
+	std::unique_ptr<Ui::Text::CustomEmoji> _wrapped;
+	const std::shared_ptr<InstanceUsage> _usage;
+	const base::weak_ptr<CustomEmojiManager> _manager;
+
+};
+
+CustomEmojiManager::SharedObject::SharedObject(
+	std::unique_ptr<Ui::Text::CustomEmoji> wrapped,
+	std::shared_ptr<InstanceUsage> usage,
+	base::weak_ptr<CustomEmojiManager> manager)
+: _wrapped(std::move(wrapped))
+, _usage(std::move(usage))
+, _manager(std::move(manager)) {
+	++_usage->objects;
+}
+
+CustomEmojiManager::SharedObject::~SharedObject() {
+	// The instance may be destroyed right after it is not used.
+	_wrapped = nullptr;
+
+	if (!--_usage->objects) {
+		_usage->lastUsed = crl::now();
+		if (const auto strong = _manager.get()) {
+			strong->instanceUnused();
+		}
+	}
+}
+
+int CustomEmojiManager::SharedObject::width() {
+	return _wrapped->width();
+}
+
+QString CustomEmojiManager::SharedObject::entityData() {
+	return _wrapped->entityData();
+}
+
+void CustomEmojiManager::SharedObject::paint(
+		QPainter &p,
+		const Context &context) {
+	_usage->lastUsed = context.now ? context.now : crl::now();
+	_wrapped->paint(p, context);
+}
+
+void CustomEmojiManager::SharedObject::unload() {
+	_wrapped->unload();
+}
+
+bool CustomEmojiManager::SharedObject::ready() {
+	return _wrapped->ready();
+}
+
+bool CustomEmojiManager::SharedObject::readyInDefaultState() {
+	return _wrapped->readyInDefaultState();
+}
+
 CustomEmojiManager::CustomEmojiManager(not_null<Session*> owner)
 : _owner(owner)
+, _evictUnusedTimer([=] { evictUnusedInstances(); })
 , _repaintTimer([=] { invokeRepaints(); }) {
 	const auto appConfig = &owner->session().appConfig();
 	appConfig->value(
@@ -466,9 +543,13 @@ std::unique_ptr<Ui::Text::CustomEmoji> CustomEmojiManager::create(
 		SizeTag tag,
 		int sizeOverride,
 		LoaderFactory factory) {
-	auto &instances = _instances[SizeIndex(tag)];
-	auto i = instances.find(documentId);
-	if (i == end(instances)) {
+	const auto key = InstanceKey{
+		.id = documentId,
+		.size = FrameSizeFromTag(tag, sizeOverride),
+	};
+	auto i = _instances.find(key);
+	if (i == end(_instances)) {
+		++_instanceMisses;
 		using Loading = Ui::CustomEmoji::Loading;
 		const auto repaint = [=](
 				not_null<Ui::CustomEmoji::Instance*> instance,
@@ -476,24 +557,84 @@ std::unique_ptr<Ui::Text::CustomEmoji> CustomEmojiManager::create(
 			repaintLater(instance, request);
 		};
 		auto [loader, setId, colored] = factory();
-		i = instances.emplace(
-			documentId,
-			std::make_unique<Ui::CustomEmoji::Instance>(Loading{
+		i = _instances.emplace(key, InstanceEntry{
+			.instance = std::make_unique<Ui::CustomEmoji::Instance>(Loading{
 				std::move(loader),
 				prepareNonExactPreview(documentId, tag, sizeOverride)
-			}, std::move(repaint))).first;
+			}, std::move(repaint)),
+			.usage = std::make_shared<InstanceUsage>(),
+		}).first;
 		if (colored) {
-			i->second->setColored();
+			i->second.instance->setColored();
 		}
-	} else if (!i->second->hasImagePreview()) {
-		auto preview = prepareNonExactPreview(documentId, tag, sizeOverride);
-		if (preview.isImage()) {
-			i->second->updatePreview(std::move(preview));
+	} else {
+		++_instanceHits;
+		if (!i->second.instance->hasImagePreview()) {
+			auto preview = prepareNonExactPreview(
+				documentId,
+				tag,
+				sizeOverride);
+			if (preview.isImage()) {
+				i->second.instance->updatePreview(std::move(preview));
+			}
 		}
 	}
-	return std::make_unique<Ui::CustomEmoji::Object>(
-		i->second.get(),
-		std::move(update));
+	return std::make_unique<SharedObject>(
+		std::make_unique<Ui::CustomEmoji::Object>(
+			i->second.instance.get(),
+			std::move(update)),
+		i->second.usage,
+		base::make_weak(this));
+}
+
+void CustomEmojiManager::instanceUnused() {
+	if (!_evictUnusedTimer.isActive()) {
+		_evictUnusedTimer.callOnce(kEvictUnusedInstancesDelay);
+	}
+}
+
+void CustomEmojiManager::evictUnusedInstances() {
+	struct Unused {
+		crl::time lastUsed = 0;
+		InstanceKey key;
+	};
+	auto unused = std::vector<Unused>();
+	for (const auto &[key, entry] : _instances) {
+		if (!entry.usage->objects) {
+			unused.push_back({ entry.usage->lastUsed, key });
+		}
+	}
+	if (int(unused.size()) <= kMaxUnusedInstances) {
+		return;
+	}
+
+	// Keep the ones that were visible most recently.
+	const auto evict = int(unused.size()) - kMaxUnusedInstances;
+	ranges::nth_element(
+		unused,
+		begin(unused) + evict,
+		ranges::less(),
+		&Unused::lastUsed);
+	for (auto i = 0; i != evict; ++i) {
+		_instances.remove(unused[i].key);
+	}
+	_instancesEvicted += evict;
+}
+
+auto CustomEmojiManager::cacheStats() const -> CacheStats {
+	auto result = CacheStats{
+		.instances = int(_instances.size()),
+		.hits = _instanceHits,
+		.misses = _instanceMisses,
+		.evicted = _instancesEvicted,
+	};
+	for (const auto &[key, entry] : _instances) {
+		result.frameBytes += int64(key.size) * key.size * 4;
+		if (!entry.usage->objects) {
+			++result.unused;
+		}
+	}
+	return result;
 }
 
 Ui::Text::CustomEmojiFactory CustomEmojiManager::factory(
@@ -508,16 +649,14 @@ Ui::CustomEmoji::Preview CustomEmojiManager::prepareNonExactPreview(
 		DocumentId documentId,
 		SizeTag tag,
 		int sizeOverride) const {
-	for (auto i = _instances.size(); i != 0;) {
-		if (SizeIndex(tag) == --i) {
-			continue;
-		}
-		const auto &other = _instances[i];
-		const auto j = other.find(documentId);
-		if (j == end(other)) {
+	const auto size = FrameSizeFromTag(tag, sizeOverride);
+	const auto from = _instances.lower_bound(InstanceKey{ documentId });
+	for (auto i = from; i != end(_instances); ++i) {
+		if (i->first.id != documentId) {
+			break;
+		} else if (i->first.size == size) {
 			continue;
-		} else if (const auto nonExact = j->second->imagePreview()) {
-			const auto size = FrameSizeFromTag(tag, sizeOverride);
+		} else if (const auto nonExact = i->second.instance->imagePreview()) {
 			return {
 				nonExact.image().scaled(
 					size,
@@ -770,11 +909,12 @@ void CustomEmojiManager::request() {
 void CustomEmojiManager::fillColoredFlags(not_null<DocumentData*> document) {
 	if (document->emojiUsesTextColor()) {
 		const auto id = document->id;
-		for (auto &instances : _instances) {
-			const auto i = instances.find(id);
-			if (i != end(instances)) {
-				i->second->setColored();
+		const auto from = _instances.lower_bound(InstanceKey{ id });
+		for (auto i = from; i != end(_instances); ++i) {
+			if (i->first.id != id) {
+				break;
 			}
+			i->second.instance->setColored();
 		}
 	}
 }
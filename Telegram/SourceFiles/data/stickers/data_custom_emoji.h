@@ -101,9 +101,38 @@ public:
 
 	[[nodiscard]] TextWithEntities creditsEmoji(QMargins padding = {});
 
+	struct CacheStats {
+		int instances = 0;
+		int unused = 0;
+		int64 frameBytes = 0; // Counting one frame of each instance.
+		int64 hits = 0;
+		int64 misses = 0;
+		int64 evicted = 0;
+	};
+	[[nodiscard]] CacheStats cacheStats() const;
+
 private:
 	static constexpr auto kSizeCount = int(SizeTag::kCount);
 
+	class SharedObject;
+
+	// Instances are shared by all size tags giving the same frame size.
+	struct InstanceKey {
+		DocumentId id = 0;
+		int size = 0;
+
+		friend inline auto operator<=>(InstanceKey, InstanceKey) = default;
+		friend inline bool operator==(InstanceKey, InstanceKey) = default;
+	};
+	struct InstanceUsage {
+		int objects = 0;
+		crl::time lastUsed = 0;
+	};
+	struct InstanceEntry {
+		std::unique_ptr<Ui::CustomEmoji::Instance> instance;
+		std::shared_ptr<InstanceUsage> usage;
+	};
+
 	struct InternalEmojiData {
 		QImage image;
 		bool textColor = true;
@@ -135,6 +164,8 @@ private:
 	void scheduleRepaintTimer();
 	bool checkEmptyRepaints();
 	void invokeRepaints();
+	void instanceUnused();
+	void evictUnusedInstances();
 	void fillColoredFlags(not_null<DocumentData*> document);
 	void processLoaders(not_null<DocumentData*> document);
 	void processListeners(not_null<DocumentData*> document);
@@ -161,11 +192,11 @@ private:
 
 	const not_null<Session*> _owner;
 
-	std::array<
-		base::flat_map<
-			DocumentId,
-			std::unique_ptr<Ui::CustomEmoji::Instance>>,
-		kSizeCount> _instances;
+	base::flat_map<InstanceKey, InstanceEntry> _instances;
+	base::Timer _evictUnusedTimer;
+	int64 _instanceHits = 0;
+	int64 _instanceMisses = 0;
+	int64 _instancesEvicted = 0;
 	std::array<
 		base::flat_map<
 			DocumentId,
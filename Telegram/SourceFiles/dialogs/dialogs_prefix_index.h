@@ -0,0 +1,195 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Dialogs {
+
+// Each of the query words is a prefix of some of the name words.
+[[nodiscard]] inline bool NameWordsMatch(
+		const base::flat_set<QString> &nameWords,
+		const QStringList &words) {
+	const auto found = [&](const QString &word) {
+		for (const auto &name : nameWords) {
+			if (name.startsWith(word)) {
+				return true;
+			}
+		}
+		return false;
+	};
+	for (const auto &word : words) {
+		if (!found(word)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Keys by the first two letters of their name words, much smaller than
+// the first letter lists, so search checks less of the entries.
+//
+// Added keys are kept unsorted until the next find(), so that filling
+// the index with all the chats sorts each of the sets only once.
+template <typename Key>
+class PrefixIndex final {
+public:
+	static constexpr auto kLength = 2;
+
+	void add(Key key, const base::flat_set<QString> &nameWords) {
+		auto prefixes = std::vector<QString>();
+		for (const auto &word : nameWords) {
+			if (word.size() >= kLength) {
+				const auto prefix = word.left(kLength);
+				if (!ranges::contains(prefixes, prefix)) {
+					prefixes.push_back(prefix);
+				}
+			}
+		}
+		for (const auto &prefix : prefixes) {
+			_index[prefix].added.push_back(key);
+		}
+		if (!prefixes.empty()) {
+			_prefixesByKey[key] = std::move(prefixes);
+		}
+	}
+	void remove(Key key) {
+		const auto i = _prefixesByKey.find(key);
+		if (i == end(_prefixesByKey)) {
+			return;
+		}
+		for (const auto &prefix : i->second) {
+			const auto j = _index.find(prefix);
+			if (j == end(_index)) {
+				continue;
+			}
+			auto &keys = j->second;
+			const auto added = ranges::find(keys.added, key);
+			if (added != end(keys.added)) {
+				keys.added.erase(added);
+			} else {
+				const auto sorted = ranges::lower_bound(keys.sorted, key);
+				if (sorted != end(keys.sorted) && *sorted == key) {
+					keys.sorted.erase(sorted);
+				}
+			}
+			if (keys.sorted.empty() && keys.added.empty()) {
+				_index.erase(j);
+			}
+		}
+		_prefixesByKey.erase(i);
+	}
+	void clear() {
+		_index.clear();
+		_prefixesByKey.clear();
+	}
+
+	// The word should have at least kLength letters.
+	// Returns the keys sorted, nullptr if there are none.
+	[[nodiscard]] const std::vector<Key> *find(const QString &word) const {
+		const auto i = _index.find(word.left(kLength));
+		if (i == end(_index)) {
+			return nullptr;
+		}
+		auto &keys = i->second;
+		if (!keys.added.empty()) {
+			const auto already = keys.sorted.size();
+			keys.sorted.insert(
+				end(keys.sorted),
+				begin(keys.added),
+				end(keys.added));
+			keys.added.clear();
+			const auto middle = begin(keys.sorted) + already;
+			std::sort(middle, end(keys.sorted));
+			std::inplace_merge(begin(keys.sorted), middle, end(keys.sorted));
+		}
+		return &keys.sorted;
+	}
+
+private:
+	struct Keys {
+		std::vector<Key> sorted;
+		std::vector<Key> added;
+	};
+
+	mutable base::flat_map<QString, Keys> _index;
+	std::map<Key, std::vector<QString>> _prefixesByKey;
+
+};
+
+// Rows of the first letter lists with all the words being prefixes of
+// their name words, in the list order. Only the entries of the smallest
+// of the letter lists and of the prefix sets of the words are checked.
+template <typename Key, typename List, typename NameWords>
+[[nodiscard]] auto FilterByNameWords(
+		const QStringList &words,
+		const base::flat_map<QChar, List> &letters,
+		const PrefixIndex<Key> &prefixes,
+		NameWords &&nameWords) {
+	using Row = std::remove_pointer_t<
+		decltype(std::declval<const List&>().getRow(std::declval<Key>()))>;
+
+	const auto letterList = [&](QChar letter) -> const List* {
+		const auto i = letters.find(letter);
+		return (i != end(letters)) ? &i->second : nullptr;
+	};
+	auto result = std::vector<not_null<Row*>>();
+	auto minimal = (const List*)nullptr;
+	auto prefixed = (const std::vector<Key>*)nullptr;
+	auto prefixedLetter = QChar();
+	for (const auto &word : words) {
+		if (word.isEmpty()) {
+			continue;
+		}
+		const auto found = letterList(word[0]);
+		if (!found || found->empty()) {
+			return result;
+		} else if (!minimal || minimal->size() > found->size()) {
+			minimal = found;
+		}
+		if (word.size() >= PrefixIndex<Key>::kLength) {
+			const auto keys = prefixes.find(word);
+			if (!keys) {
+				return result;
+			} else if (!prefixed || prefixed->size() > keys->size()) {
+				prefixed = keys;
+				prefixedLetter = word[0];
+			}
+		}
+	}
+	if (!minimal) {
+		return result;
+	}
+
+	const auto allFound = [&](Key key) {
+		return NameWordsMatch(nameWords(key), words);
+	};
+	if (prefixed && int(prefixed->size()) < minimal->size()) {
+		// Take the rows from the letter list to keep its order.
+		const auto list = letterList(prefixedLetter);
+		result.reserve(prefixed->size());
+		for (const auto &key : *prefixed) {
+			if (allFound(key)) {
+				if (const auto row = list->getRow(key)) {
+					result.push_back(row);
+				}
+			}
+		}
+		ranges::sort(result, ranges::less(), [](not_null<Row*> row) {
+			return row->index();
+		});
+		return result;
+	}
+	result.reserve(minimal->size());
+	for (const auto &row : *minimal) {
+		if (allFound(row->key())) {
+			result.push_back(row);
+		}
+	}
+	return result;
+}
+
+} // namespace Dialogs
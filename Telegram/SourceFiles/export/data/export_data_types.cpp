@@ -357,6 +357,16 @@ bool RefreshFileReference(FileLocation &to, const FileLocation &from) {
 	return false;
 }
 
+QByteArray FileReference(const FileLocation &location) {
+	if (location.data.type() == mtpc_inputPhotoFileLocation) {
+		return location.data.c_inputPhotoFileLocation().vfile_reference().v;
+	} else if (location.data.type() == mtpc_inputDocumentFileLocation) {
+		return location.data.c_inputDocumentFileLocation(
+		).vfile_reference().v;
+	}
+	return QByteArray();
+}
+
 Image ParseMaxImage(
 		const MTPDphoto &photo,
 		const QString &suggestedPath) {
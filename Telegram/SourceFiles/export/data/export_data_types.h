@@ -62,6 +62,7 @@ struct FileLocation {
 };
 
 bool RefreshFileReference(FileLocation &to, const FileLocation &from);
+[[nodiscard]] QByteArray FileReference(const FileLocation &location);
 
 struct File {
 	enum class SkipReason {
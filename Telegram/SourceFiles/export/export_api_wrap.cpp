@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "export/export_api_wrap.h"
 
+#include "export/export_file_reference.h"
 #include "export/export_settings.h"
 #include "export/data/export_data_types.h"
 #include "export/output/export_output_result.h"
@@ -23,8 +24,7 @@ namespace {
 
 constexpr auto kUserpicsSliceLimit = 100;
 constexpr auto kFileChunkSize = 128 * 1024;
-constexpr auto kFileRequestsCount = 2;
-//constexpr auto kFileNextRequestDelay = crl::time(20);
+constexpr auto kFileRequestsCount = 4;
 constexpr auto kChatsSliceLimit = 100;
 constexpr auto kMessagesSliceLimit = 100;
 constexpr auto kTopPeerSliceLimit = 100;
@@ -178,9 +178,19 @@ struct ApiWrap::FileProcess {
 	struct Request {
 		int64 offset = 0;
 		QByteArray bytes;
+		QByteArray fileReference;
+		mtpRequestId requestId = 0;
 	};
 	std::deque<Request> requests;
-	mtpRequestId requestId = 0;
+
+	// Parts that failed with FILE_REFERENCE_* wait for the reference
+	// refresh request and are sent again after it is done.
+	FilePartsReference reference;
+	mtpRequestId refreshRequestId = 0;
+
+	crl::time started = 0;
+
+	[[nodiscard]] Request &request(int64 offset);
 };
 
 struct ApiWrap::FileProgress {
@@ -227,6 +237,13 @@ struct ApiWrap::ChatProcess {
 	std::optional<Data::MessagesSlice> slice;
 	bool lastSlice = false;
 	int fileIndex = 0;
+
+	// Next slice is requested while files of the current one are loaded.
+	std::optional<MTPmessages_Messages> preloadedSlice;
+	int32 preloadOffsetId = 0;
+	bool preloading = false;
+	bool waitingPreloaded = false;
+	crl::time sliceRequested = 0;
 };
 
 
@@ -342,6 +359,12 @@ ApiWrap::FileProcess::FileProcess(const QString &path, Output::Stats *stats)
 : file(path, stats) {
 }
 
+auto ApiWrap::FileProcess::request(int64 offset) -> Request & {
+	const auto i = ranges::find(requests, offset, &Request::offset);
+	Assert(i != end(requests));
+	return *i;
+}
+
 template <typename Request>
 auto ApiWrap::mainRequest(Request &&request) {
 	Expects(_takeoutId.has_value());
@@ -372,7 +395,6 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int64 offset) {
 	Expects(location.dcId != 0
 		|| location.data.type() == mtpc_inputTakeoutFileLocation);
 	Expects(_takeoutId.has_value());
-	Expects(_fileProcess->requestId == 0);
 
 	return std::move(_mtp.request(MTPInvokeWithTakeout<MTPupload_GetFile>(
 		MTP_long(*_takeoutId),
@@ -382,7 +404,7 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int64 offset) {
 			MTP_long(offset),
 			MTP_int(kFileChunkSize))
 	)).fail([=](const MTP::Error &result) {
-		_fileProcess->requestId = 0;
+		_fileProcess->request(offset).requestId = 0;
 		if (result.type() == u"TAKEOUT_FILE_EMPTY"_q
 			&& _otherDataProcess != nullptr) {
 			filePartDone(
@@ -1275,10 +1297,7 @@ void ApiWrap::skipFile(uint64 randomId) {
 		return;
 	}
 	LOG(("Export Info: File skipped."));
-	Assert(!_fileProcess->requests.empty());
-	Assert(_fileProcess->requestId != 0);
-	_mtp.request(base::take(_fileProcess->requestId)).cancel();
-	base::take(_fileProcess)->done(QString());
+	cancelFileProcess();
 }
 
 void ApiWrap::cancelExportFast() {
@@ -1602,27 +1621,72 @@ void ApiWrap::requestMessagesSlice() {
 		loadMessagesFiles({});
 		return;
 	}
+	_chatProcess->sliceRequested = crl::now();
+	const auto preloaded = _chatProcess->preloading
+		|| _chatProcess->preloadedSlice.has_value();
+	if (preloaded
+		&& _chatProcess->preloadOffsetId == _chatProcess->largestIdPlusOne) {
+		if (_chatProcess->preloadedSlice) {
+			messagesSliceLoaded(*base::take(_chatProcess->preloadedSlice));
+		} else {
+			_chatProcess->waitingPreloaded = true;
+		}
+		return;
+	}
+	Assert(!_chatProcess->preloading);
+	_chatProcess->preloadedSlice = std::nullopt;
 	requestChatMessages(
 		_chatProcess->info.splits[_chatProcess->localSplitIndex],
 		_chatProcess->largestIdPlusOne,
 		-kMessagesSliceLimit,
 		kMessagesSliceLimit,
 		[=](const MTPmessages_Messages &result) {
+		messagesSliceLoaded(result);
+	});
+}
+
+void ApiWrap::preloadMessagesSlice(int32 offsetId) {
+	Expects(_chatProcess != nullptr);
+	Expects(!_chatProcess->preloading);
+
+	_chatProcess->preloading = true;
+	_chatProcess->preloadOffsetId = offsetId;
+	_chatProcess->preloadedSlice = std::nullopt;
+	requestChatMessages(
+		_chatProcess->info.splits[_chatProcess->localSplitIndex],
+		offsetId,
+		-kMessagesSliceLimit,
+		kMessagesSliceLimit,
+		[=](MTPmessages_Messages &&result) {
 		Expects(_chatProcess != nullptr);
 
-		result.match([&](const MTPDmessages_messagesNotModified &data) {
-			error("Unexpected messagesNotModified received.");
-		}, [&](const auto &data) {
-			if constexpr (MTPDmessages_messages::Is<decltype(data)>()) {
-				_chatProcess->lastSlice = true;
-			}
-			loadMessagesFiles(Data::ParseMessagesSlice(
-				_chatProcess->context,
-				data.vmessages(),
-				data.vusers(),
-				data.vchats(),
-				_chatProcess->info.relativePath));
-		});
+		_chatProcess->preloading = false;
+		if (base::take(_chatProcess->waitingPreloaded)) {
+			messagesSliceLoaded(result);
+		} else {
+			_chatProcess->preloadedSlice = std::move(result);
+		}
+	});
+}
+
+void ApiWrap::messagesSliceLoaded(const MTPmessages_Messages &result) {
+	Expects(_chatProcess != nullptr);
+
+	if (_stats) {
+		_stats->incrementSlices(crl::now() - _chatProcess->sliceRequested);
+	}
+	result.match([&](const MTPDmessages_messagesNotModified &data) {
+		error("Unexpected messagesNotModified received.");
+	}, [&](const auto &data) {
+		if constexpr (MTPDmessages_messages::Is<decltype(data)>()) {
+			_chatProcess->lastSlice = true;
+		}
+		loadMessagesFiles(Data::ParseMessagesSlice(
+			_chatProcess->context,
+			data.vmessages(),
+			data.vusers(),
+			data.vchats(),
+			_chatProcess->info.relativePath));
 	});
 }
 
@@ -1708,6 +1772,8 @@ void ApiWrap::loadMessagesFiles(Data::MessagesSlice &&slice) {
 
 	if (slice.list.empty()) {
 		_chatProcess->lastSlice = true;
+	} else if (!_chatProcess->lastSlice) {
+		preloadMessagesSlice(slice.list.back().id + 1);
 	}
 	_chatProcess->slice = std::move(slice);
 	_chatProcess->fileIndex = 0;
@@ -2083,6 +2149,7 @@ void ApiWrap::loadFile(
 	_fileProcess = prepareFileProcess(file, origin);
 	_fileProcess->progress = std::move(progress);
 	_fileProcess->done = std::move(done);
+	_fileProcess->started = crl::now();
 
 	if (_fileProcess->progress) {
 		const auto progress = FileProgress{
@@ -2096,7 +2163,7 @@ void ApiWrap::loadFile(
 
 	loadFilePart();
 
-	Ensures(_fileProcess->requestId != 0);
+	Ensures(!_fileProcess->requests.empty());
 }
 
 auto ApiWrap::prepareFileProcess(
@@ -2113,6 +2180,8 @@ auto ApiWrap::prepareFileProcess(
 		_stats);
 	result->relativePath = relativePath;
 	result->location = file.location;
+	result->reference = FilePartsReference(
+		Data::FileReference(file.location));
 	result->size = file.size;
 	result->origin = origin;
 	result->randomId = base::RandomValue<uint64>();
@@ -2120,37 +2189,39 @@ auto ApiWrap::prepareFileProcess(
 }
 
 void ApiWrap::loadFilePart() {
-	if (!_fileProcess
-		|| _fileProcess->requestId
-		|| _fileProcess->requests.size() >= kFileRequestsCount
-		|| (_fileProcess->size > 0
-			&& _fileProcess->offset >= _fileProcess->size)) {
+	if (!_fileProcess || _fileProcess->reference.refreshing()) {
 		return;
 	}
 
-	const auto offset = _fileProcess->offset;
-	_fileProcess->requests.push_back({ offset });
-	_fileProcess->requestId = fileRequest(
+	// While the size is unknown we wait for an empty part to finish,
+	// so only one request at a time is sent in that case.
+	const auto &process = *_fileProcess;
+	const auto more = [&] {
+		return (process.requests.size() < kFileRequestsCount)
+			&& (process.size > 0
+				? (process.offset < process.size)
+				: process.requests.empty());
+	};
+	while (more()) {
+		const auto offset = _fileProcess->offset;
+		_fileProcess->requests.push_back({ offset });
+		_fileProcess->offset += kFileChunkSize;
+		sendFilePart(offset);
+	}
+}
+
+void ApiWrap::sendFilePart(int64 offset) {
+	Expects(_fileProcess != nullptr);
+
+	auto &request = _fileProcess->request(offset);
+	request.fileReference = _fileProcess->reference.current();
+	request.requestId = fileRequest(
 		_fileProcess->location,
-		_fileProcess->offset
+		offset
 	).done([=](const MTPupload_File &result) {
-		_fileProcess->requestId = 0;
+		_fileProcess->request(offset).requestId = 0;
 		filePartDone(offset, result);
 	}).send();
-	_fileProcess->offset += kFileChunkSize;
-
-	if (_fileProcess->size > 0
-		&& _fileProcess->requests.size() < kFileRequestsCount) {
-		// Only one request at a time supported right now.
-		//const auto runner = _runner;
-		//crl::on_main([=] {
-		//	QTimer::singleShot(kFileNextRequestDelay, [=] {
-		//		runner([=] {
-		//			loadFilePart();
-		//		});
-		//	});
-		//});
-	}
 }
 
 void ApiWrap::filePartDone(int64 offset, const MTPupload_File &result) {
@@ -2173,15 +2244,8 @@ void ApiWrap::filePartDone(int64 offset, const MTPupload_File &result) {
 			return;
 		}
 	} else {
-		using Request = FileProcess::Request;
 		auto &requests = _fileProcess->requests;
-		const auto i = ranges::find(
-			requests,
-			offset,
-			[](const Request &request) { return request.offset; });
-		Assert(i != end(requests));
-
-		i->bytes = data.vbytes().v;
+		_fileProcess->request(offset).bytes = data.vbytes().v;
 
 		auto &file = _fileProcess->file;
 		while (!requests.empty() && !requests.front().bytes.isEmpty()) {
@@ -2210,25 +2274,42 @@ void ApiWrap::filePartDone(int64 offset, const MTPupload_File &result) {
 	auto process = base::take(_fileProcess);
 	const auto relativePath = process->relativePath;
 	_fileCache->save(process->location, relativePath);
+	if (_stats) {
+		_stats->incrementDownloaded(
+			process->file.size(),
+			crl::now() - process->started);
+	}
 	process->done(process->relativePath);
 }
 
 void ApiWrap::filePartRefreshReference(int64 offset) {
 	Expects(_fileProcess != nullptr);
-	Expects(_fileProcess->requestId == 0);
 
+	using Failed = FilePartsReference::Failed;
+	const auto &sentWith = _fileProcess->request(offset).fileReference;
+	switch (_fileProcess->reference.failed(offset, sentWith)) {
+	case Failed::Resend:
+		// Another part has already refreshed the reference.
+		sendFilePart(offset);
+		return;
+	case Failed::Wait:
+		return;
+	case Failed::Refresh:
+		break;
+	}
 	const auto &origin = _fileProcess->origin;
 	if (origin.storyId) {
-		_fileProcess->requestId = mainRequest(MTPstories_GetStoriesByID(
-			MTP_inputPeerSelf(),
-			MTP_vector<MTPint>(1, MTP_int(origin.storyId))
-		)).fail([=](const MTP::Error &error) {
-			_fileProcess->requestId = 0;
+		_fileProcess->refreshRequestId = mainRequest(
+			MTPstories_GetStoriesByID(
+				MTP_inputPeerSelf(),
+				MTP_vector<MTPint>(1, MTP_int(origin.storyId)))
+		).fail([=](const MTP::Error &error) {
+			_fileProcess->refreshRequestId = 0;
 			filePartUnavailable();
 			return true;
 		}).done([=](const MTPstories_Stories &result) {
-			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			_fileProcess->refreshRequestId = 0;
+			filePartExtractReference(result);
 		}).send();
 		return;
 	} else if (!origin.messageId) {
@@ -2245,21 +2326,21 @@ void ApiWrap::filePartRefreshReference(int64 offset) {
 				origin.peer.c_inputPeerChannelFromMessage().vpeer(),
 				origin.peer.c_inputPeerChannelFromMessage().vmsg_id(),
 				origin.peer.c_inputPeerChannelFromMessage().vchannel_id());
-		_fileProcess->requestId = mainRequest(MTPchannels_GetMessages(
+		_fileProcess->refreshRequestId = mainRequest(MTPchannels_GetMessages(
 			channel,
 			MTP_vector<MTPInputMessage>(
 				1,
 				MTP_inputMessageID(MTP_int(origin.messageId)))
 		)).fail([=](const MTP::Error &error) {
-			_fileProcess->requestId = 0;
+			_fileProcess->refreshRequestId = 0;
 			filePartUnavailable();
 			return true;
 		}).done([=](const MTPmessages_Messages &result) {
-			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			_fileProcess->refreshRequestId = 0;
+			filePartExtractReference(result);
 		}).send();
 	} else {
-		_fileProcess->requestId = splitRequest(
+		_fileProcess->refreshRequestId = splitRequest(
 			origin.split,
 			MTPmessages_GetMessages(
 				MTP_vector<MTPInputMessage>(
@@ -2267,21 +2348,19 @@ void ApiWrap::filePartRefreshReference(int64 offset) {
 					MTP_inputMessageID(MTP_int(origin.messageId)))
 			)
 		).fail([=](const MTP::Error &error) {
-			_fileProcess->requestId = 0;
+			_fileProcess->refreshRequestId = 0;
 			filePartUnavailable();
 			return true;
 		}).done([=](const MTPmessages_Messages &result) {
-			_fileProcess->requestId = 0;
-			filePartExtractReference(offset, result);
+			_fileProcess->refreshRequestId = 0;
+			filePartExtractReference(result);
 		}).send();
 	}
 }
 
-void ApiWrap::filePartExtractReference(
-		int64 offset,
-		const MTPmessages_Messages &result) {
+void ApiWrap::filePartExtractReference(const MTPmessages_Messages &result) {
 	Expects(_fileProcess != nullptr);
-	Expects(_fileProcess->requestId == 0);
+	Expects(_fileProcess->refreshRequestId == 0);
 
 	result.match([&](const MTPDmessages_messagesNotModified &data) {
 		error("Unexpected messagesNotModified received.");
@@ -2305,13 +2384,7 @@ void ApiWrap::filePartExtractReference(
 					_fileProcess->location,
 					message.thumb().file.location);
 				if (refresh1 || refresh2) {
-					_fileProcess->requestId = fileRequest(
-						_fileProcess->location,
-						offset
-					).done([=](const MTPupload_File &result) {
-						_fileProcess->requestId = 0;
-						filePartDone(offset, result);
-					}).send();
+					filePartReferenceRefreshed();
 					return;
 				}
 			}
@@ -2320,11 +2393,9 @@ void ApiWrap::filePartExtractReference(
 	});
 }
 
-void ApiWrap::filePartExtractReference(
-		int64 offset,
-		const MTPstories_Stories &result) {
+void ApiWrap::filePartExtractReference(const MTPstories_Stories &result) {
 	Expects(_fileProcess != nullptr);
-	Expects(_fileProcess->requestId == 0);
+	Expects(_fileProcess->refreshRequestId == 0);
 
 	const auto stories = Data::ParseStoriesSlice(
 		result.data().vstories(),
@@ -2338,13 +2409,7 @@ void ApiWrap::filePartExtractReference(
 				_fileProcess->location,
 				story.thumb().file.location);
 			if (refresh1 || refresh2) {
-				_fileProcess->requestId = fileRequest(
-					_fileProcess->location,
-					offset
-				).done([=](const MTPupload_File &result) {
-					_fileProcess->requestId = 0;
-					filePartDone(offset, result);
-				}).send();
+				filePartReferenceRefreshed();
 				return;
 			}
 		}
@@ -2352,13 +2417,43 @@ void ApiWrap::filePartExtractReference(
 	filePartUnavailable();
 }
 
+void ApiWrap::filePartReferenceRefreshed() {
+	Expects(_fileProcess != nullptr);
+
+	const auto resend = _fileProcess->reference.refreshed(
+		Data::FileReference(_fileProcess->location));
+	if (!resend) {
+		filePartUnavailable();
+		return;
+	}
+	for (const auto offset : *resend) {
+		sendFilePart(offset);
+	}
+	loadFilePart();
+}
+
 void ApiWrap::filePartUnavailable() {
 	Expects(_fileProcess != nullptr);
 	Expects(!_fileProcess->requests.empty());
 
 	LOG(("Export Error: File unavailable."));
 
-	base::take(_fileProcess)->done(QString());
+	cancelFileProcess();
+}
+
+void ApiWrap::cancelFileProcess() {
+	Expects(_fileProcess != nullptr);
+
+	auto process = base::take(_fileProcess);
+	for (const auto &request : process->requests) {
+		if (request.requestId) {
+			_mtp.request(request.requestId).cancel();
+		}
+	}
+	if (process->refreshRequestId) {
+		_mtp.request(process->refreshRequestId).cancel();
+	}
+	process->done(QString());
 }
 
 void ApiWrap::error(const MTP::Error &error) {
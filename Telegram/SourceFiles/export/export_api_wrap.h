@@ -173,6 +173,8 @@ private:
 	void checkFirstMessageDate(int localSplitIndex, int count);
 	void messagesCountLoaded(int localSplitIndex, int count);
 	void requestMessagesSlice();
+	void preloadMessagesSlice(int32 offsetId);
+	void messagesSliceLoaded(const MTPmessages_Messages &result);
 	void requestChatMessages(
 		int splitIndex,
 		int offsetId,
@@ -215,15 +217,14 @@ private:
 		Fn<bool(FileProgress)> progress,
 		FnMut<void(QString)> done);
 	void loadFilePart();
+	void sendFilePart(int64 offset);
 	void filePartDone(int64 offset, const MTPupload_File &result);
 	void filePartUnavailable();
 	void filePartRefreshReference(int64 offset);
-	void filePartExtractReference(
-		int64 offset,
-		const MTPmessages_Messages &result);
-	void filePartExtractReference(
-		int64 offset,
-		const MTPstories_Stories &result);
+	void filePartExtractReference(const MTPmessages_Messages &result);
+	void filePartExtractReference(const MTPstories_Stories &result);
+	void filePartReferenceRefreshed();
+	void cancelFileProcess();
 
 	template <typename Request>
 	class RequestBuilder;
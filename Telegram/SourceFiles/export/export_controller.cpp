@@ -654,6 +654,14 @@ int ControllerObject::substepsInStep(Step step) const {
 }
 
 void ControllerObject::setFinishedState() {
+	LOG(("Export Info: Finished, %1 slices (waited %2 ms), "
+		"downloaded %3 bytes (%4 B/s), written %5 bytes (%6 B/s)."
+		).arg(_stats.slicesCount()
+		).arg(_stats.slicesWaitTime()
+		).arg(_stats.downloadedBytesCount()
+		).arg(_stats.downloadSpeed()
+		).arg(_stats.bytesCount()
+		).arg(_stats.writeSpeed()));
 	setState(FinishedState{
 		_writer->mainFilePath(),
 		_stats.filesCount(),
@@ -0,0 +1,50 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "export/export_file_reference.h"
+
+namespace Export {
+
+FilePartsReference::FilePartsReference(QByteArray current)
+: _current(std::move(current)) {
+}
+
+const QByteArray &FilePartsReference::current() const {
+	return _current;
+}
+
+bool FilePartsReference::refreshing() const {
+	return _refreshing;
+}
+
+auto FilePartsReference::failed(int64 offset, const QByteArray &sentWith)
+-> Failed {
+	if (sentWith != _current) {
+		return Failed::Resend;
+	}
+	_waiting.push_back(offset);
+	if (_refreshing) {
+		return Failed::Wait;
+	}
+	_refreshing = true;
+	return Failed::Refresh;
+}
+
+std::optional<std::vector<int64>> FilePartsReference::refreshed(
+		QByteArray reference) {
+	Expects(_refreshing);
+
+	_refreshing = false;
+	if (reference == _current) {
+		_waiting.clear();
+		return std::nullopt;
+	}
+	_current = std::move(reference);
+	return base::take(_waiting);
+}
+
+} // namespace Export
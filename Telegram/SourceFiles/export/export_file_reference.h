@@ -0,0 +1,45 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Export {
+
+// Parts of a file are requested in parallel, each with the reference the
+// file had when the part was sent. A part that fails with FILE_REFERENCE_*
+// after another one has already refreshed the reference is sent again,
+// only a failure with the current reference needs a refresh.
+class FilePartsReference final {
+public:
+	enum class Failed {
+		Resend,
+		Wait,
+		Refresh,
+	};
+
+	FilePartsReference() = default;
+	explicit FilePartsReference(QByteArray current);
+
+	[[nodiscard]] const QByteArray &current() const;
+	[[nodiscard]] bool refreshing() const;
+
+	// The part at offset sent with the sentWith reference has failed.
+	[[nodiscard]] Failed failed(int64 offset, const QByteArray &sentWith);
+
+	// Returns the parts to send again, or std::nullopt if the refresh
+	// brought the same reference, so the file is unavailable.
+	[[nodiscard]] std::optional<std::vector<int64>> refreshed(
+		QByteArray reference);
+
+private:
+	QByteArray _current;
+	std::vector<int64> _waiting;
+	bool _refreshing = false;
+
+};
+
+} // namespace Export
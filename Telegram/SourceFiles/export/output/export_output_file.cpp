@@ -50,10 +50,12 @@ Result File::writeBlockAttempt(const QByteArray &block) {
 	if (!size) {
 		return Result::Success();
 	}
+	const auto started = crl::now();
 	if (_file->write(block) == size && _file->flush()) {
 		_offset += size;
 		if (_stats) {
 			_stats->incrementBytes(size);
+			_stats->incrementWriteTime(crl::now() - started);
 		}
 		return Result::Success();
 	}
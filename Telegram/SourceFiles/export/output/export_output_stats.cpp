@@ -9,10 +9,22 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Export {
 namespace Output {
+namespace {
+
+[[nodiscard]] int64 Speed(int64 bytes, crl::time duration) {
+	return (duration > 0) ? (bytes * 1000 / duration) : 0;
+}
+
+} // namespace
 
 Stats::Stats(const Stats &other)
 : _files(other._files.load())
-, _bytes(other._bytes.load()) {
+, _bytes(other._bytes.load())
+, _slices(other._slices.load())
+, _slicesWaitTime(other._slicesWaitTime.load())
+, _downloadedBytes(other._downloadedBytes.load())
+, _downloadTime(other._downloadTime.load())
+, _writeTime(other._writeTime.load()) {
 }
 
 void Stats::incrementFiles() {
@@ -23,6 +35,20 @@ void Stats::incrementBytes(int count) {
 	_bytes += count;
 }
 
+void Stats::incrementSlices(crl::time waited) {
+	++_slices;
+	_slicesWaitTime += waited;
+}
+
+void Stats::incrementDownloaded(int64 count, crl::time duration) {
+	_downloadedBytes += count;
+	_downloadTime += duration;
+}
+
+void Stats::incrementWriteTime(crl::time duration) {
+	_writeTime += duration;
+}
+
 int Stats::filesCount() const {
 	return _files;
 }
@@ -31,5 +57,33 @@ int64 Stats::bytesCount() const {
 	return _bytes;
 }
 
+int Stats::slicesCount() const {
+	return _slices;
+}
+
+crl::time Stats::slicesWaitTime() const {
+	return _slicesWaitTime;
+}
+
+int64 Stats::downloadedBytesCount() const {
+	return _downloadedBytes;
+}
+
+crl::time Stats::downloadTime() const {
+	return _downloadTime;
+}
+
+crl::time Stats::writeTime() const {
+	return _writeTime;
+}
+
+int64 Stats::downloadSpeed() const {
+	return Speed(_downloadedBytes, _downloadTime);
+}
+
+int64 Stats::writeSpeed() const {
+	return Speed(_bytes, _writeTime);
+}
+
 } // namespace Output
 } // namespace Export
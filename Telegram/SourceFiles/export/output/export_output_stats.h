@@ -20,12 +20,33 @@ public:
 	void incrementFiles();
 	void incrementBytes(int count);
 
+	// Per-stage counters: time spent waiting for message slices, bytes
+	// received from upload.getFile and time spent writing to disk.
+	void incrementSlices(crl::time waited);
+	void incrementDownloaded(int64 count, crl::time duration);
+	void incrementWriteTime(crl::time duration);
+
 	int filesCount() const;
 	int64 bytesCount() const;
 
+	int slicesCount() const;
+	crl::time slicesWaitTime() const;
+	int64 downloadedBytesCount() const;
+	crl::time downloadTime() const;
+	crl::time writeTime() const;
+
+	// Bytes per second, zero if the stage wasn't measured.
+	int64 downloadSpeed() const;
+	int64 writeSpeed() const;
+
 private:
 	std::atomic<int> _files;
 	std::atomic<int64> _bytes;
+	std::atomic<int> _slices;
+	std::atomic<crl::time> _slicesWaitTime;
+	std::atomic<int64> _downloadedBytes;
+	std::atomic<crl::time> _downloadTime;
+	std::atomic<crl::time> _writeTime;
 
 };
 
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/history_view_item_preview.h"
 #include "history/view/history_view_translate_tracker.h"
 #include "dialogs/dialogs_indexed_list.h"
+#include "history/history_arena.h"
 #include "history/history_inner_widget.h"
 #include "history/history_item.h"
 #include "history/history_item_components.h"
@@ -1194,6 +1195,7 @@ void History::mainViewRemoved(
 		not_null<HistoryView::Element*> view) {
 	Expects(_joinedMessage != view->data());
 
+	_deferredResizeWalk = std::nullopt;
 	if (_firstUnreadView == view) {
 		getNextFirstUnreadMessage();
 	}
@@ -1325,6 +1327,7 @@ HistoryBlock *History::prepareBlockForAddingItem() {
 }
 
 void History::viewReplaced(not_null<const Element*> was, Element *now) {
+	_deferredResizeWalk = std::nullopt;
 	if (scrollTopItem == was) scrollTopItem = now;
 	if (_firstUnreadView == was) _firstUnreadView = now;
 	if (_unreadBarView == was) _unreadBarView = now;
@@ -1335,6 +1338,7 @@ void History::addItemToBlock(not_null<HistoryItem*> item) {
 
 	auto block = prepareBlockForAddingItem();
 
+	_deferredResizeWalk = std::nullopt;
 	block->messages.push_back(item->createView(_delegateMixin->delegate()));
 	const auto view = block->messages.back().get();
 	view->attachToBlock(block, block->messages.size() - 1);
@@ -2139,6 +2143,7 @@ not_null<HistoryItem*> History::addNewInTheMiddle(
 
 	const auto &block = blocks[blockIndex];
 
+	_deferredResizeWalk = std::nullopt;
 	const auto it = block->messages.insert(
 		block->messages.begin() + itemIndex,
 		item->createView(_delegateMixin->delegate()));
@@ -2807,6 +2812,21 @@ void History::applyDialog(
 	owner().histories().dialogEntryApplied(this);
 }
 
+void History::applyStoredDialog(const MTPDdialog &data) {
+	// Only the place in the chats list and the preview, the read state,
+	// unread counters and pts of a stored dialog could be outdated.
+	const auto folderId = data.vfolder_id();
+	if (folderId && folderId->v) {
+		setFolder(owner().folder(folderId->v));
+	} else {
+		clearFolder();
+	}
+	const auto itemId = FullMsgId(peer->id, data.vtop_message().v);
+	if (const auto item = owner().message(itemId)) {
+		setLastServerMessage(item);
+	}
+}
+
 void History::dialogEntryApplied() {
 	if (!lastServerMessageKnown()) {
 		setLastServerMessage(nullptr);
@@ -3005,7 +3025,16 @@ HistoryItem *History::lastEditableMessage() const {
 	return nullptr;
 }
 
+bool History::hasDeferredResizedItems() const {
+	return _flags & Flag::HasDeferredResizedItems;
+}
+
 void History::resizeToWidth(int newWidth) {
+	constexpr auto kAll = std::numeric_limits<int>::max();
+	resizeToWidth(newWidth, -kAll, kAll);
+}
+
+void History::resizeToWidth(int newWidth, int exactFrom, int exactTill) {
 	using Request = HistoryBlock::ResizeRequest;
 	const auto request = (_flags & Flag::PendingAllItemsResize)
 		? Request::ReinitAll
@@ -3016,14 +3045,138 @@ void History::resizeToWidth(int newWidth) {
 		return;
 	}
 	_flags &= ~(Flag::HasPendingResizedItems | Flag::PendingAllItemsResize);
+	if (request != Request::ResizePending) {
+		_deferredResizeWalk = std::nullopt;
+	}
 
 	_width = newWidth;
 	int y = 0;
+	auto deferred = false;
+	const auto resizeDeferred = [](const auto &view) {
+		return view->resizeDeferred();
+	};
 	for (const auto &block : blocks) {
+		const auto wasTop = block->y();
 		block->setY(y);
-		y += block->resizeGetHeight(newWidth, request);
+		y += block->resizeGetHeight(
+			newWidth,
+			request,
+			wasTop,
+			exactFrom,
+			exactTill);
+		if (!deferred) {
+			deferred = ranges::any_of(block->messages, resizeDeferred);
+		}
 	}
 	_height = y;
+	if (deferred) {
+		_flags |= Flag::HasDeferredResizedItems;
+	} else {
+		_flags &= ~Flag::HasDeferredResizedItems;
+	}
+}
+
+bool History::resizeDeferredItems(int from, int till, crl::time deadline) {
+	if (!hasDeferredResizedItems()) {
+		return false;
+	}
+	auto &walk = _deferredResizeWalk;
+	if (!walk || walk->from != from || walk->till != till) {
+		walk = DeferredResizeWalk{ .from = from, .till = till };
+		for (const auto &block : blocks) {
+			if (block->y() + block->height() <= from) {
+				continue;
+			}
+			for (const auto &view : block->messages) {
+				if (block->y() + view->y() >= from) {
+					walk->below = view.get();
+					break;
+				}
+			}
+			if (walk->below) {
+				break;
+			}
+		}
+		walk->above = walk->below
+			? walk->below->previousInBlocks()
+			: blocks.empty()
+			? nullptr
+			: blocks.back()->messages.back().get();
+	}
+
+	// Positions are updated only when items in [from, till) or the last
+	// of the deferred ones were laid out, so the tops stay sorted.
+	const auto distance = [&](not_null<Element*> view) {
+		const auto top = view->block()->y() + view->y();
+		const auto bottom = top + view->height();
+		return (bottom <= from)
+			? (from - bottom)
+			: (top >= till)
+			? (top - till)
+			: 0;
+	};
+	auto resized = 0;
+	auto resizedInRange = false;
+	while (walk->above || walk->below) {
+		const auto takeAbove = !walk->below
+			|| (walk->above
+				&& distance(walk->above) <= distance(walk->below));
+		const auto view = takeAbove ? walk->above : walk->below;
+		if (view->resizeDeferred() && resized && crl::now() >= deadline) {
+			// At least one item is laid out each time, so that it ends.
+			break;
+		} else if (takeAbove) {
+			walk->above = view->previousInBlocks();
+		} else {
+			walk->below = view->nextInBlocks();
+		}
+		if (!view->resizeDeferred()) {
+			continue;
+		} else if (!distance(view)) {
+			resizedInRange = true;
+		}
+		view->resizeGetHeight(_width);
+		++resized;
+	}
+	const auto finished = !walk->above && !walk->below;
+	if (finished) {
+		walk = std::nullopt;
+		_flags &= ~Flag::HasDeferredResizedItems;
+	}
+	if (resizedInRange || finished) {
+		// Positions of the following items are updated in resizeToWidth().
+		setHasPendingResizedItems();
+	}
+	return resizedInRange;
+}
+
+bool History::resizeDeferredItemsIn(int from, int till) {
+	if (!hasDeferredResizedItems()) {
+		return false;
+	}
+	auto delta = 0;
+	auto resized = false;
+	for (const auto &block : blocks) {
+		if (block->y() + delta >= till) {
+			break;
+		}
+		for (const auto &view : block->messages) {
+			const auto top = block->y() + view->y() + delta;
+			if (top >= till) {
+				break;
+			} else if (!view->resizeDeferred()
+				|| top + view->height() <= from) {
+				continue;
+			}
+			const auto was = view->height();
+			delta += view->resizeGetHeight(_width) - was;
+			resized = true;
+		}
+	}
+	if (resized) {
+		setHasPendingResizedItems();
+	}
+	return resized;
 }
 
 void History::forceFullResize() {
@@ -3403,6 +3556,7 @@ void History::clear(ClearType type) {
 	removeJoinedMessage();
 
 	forgetScrollState();
+	_deferredResizeWalk = std::nullopt;
 	blocks.clear();
 	owner().notifyHistoryUnloaded(this);
 	lastKeyboardInited = false;
@@ -3455,6 +3609,23 @@ void History::clear(ClearType type) {
 		channel->mgInfo->markupSenders.clear();
 	}
 
+	if (_arena) {
+		const auto stats = _arena->stats();
+		if (!stats.objects) {
+			_arena = nullptr;
+		}
+		const auto total = HistoryArena::Total();
+		DEBUG_LOG(("History Arena: cleared %1, left %2 objects (%3 bytes) "
+			"in %4 pages, total %5 objects (%6 bytes) in %7 pages."
+			).arg(peer->id.value
+			).arg(stats.objects
+			).arg(stats.bytes
+			).arg(stats.pages
+			).arg(total.objects
+			).arg(total.bytes
+			).arg(total.pages));
+	}
+
 	owner().notifyHistoryChangeDelayed(this);
 	owner().sendHistoryChangeNotifications();
 }
@@ -3478,6 +3649,13 @@ void History::clearUpTill(MsgId availableMinId) {
 	requestChatListMessage();
 }
 
+HistoryArena &History::arena() {
+	if (!_arena) {
+		_arena = std::make_unique<HistoryArena>();
+	}
+	return *_arena;
+}
+
 void History::applyGroupAdminChanges(const base::flat_set<UserId> &changes) {
 	for (const auto &block : blocks) {
 		for (const auto &message : block->messages) {
@@ -3572,7 +3750,17 @@ HistoryBlock::HistoryBlock(not_null<History*> history)
 : _history(history) {
 }
 
-int HistoryBlock::resizeGetHeight(int newWidth, ResizeRequest request) {
+int HistoryBlock::resizeGetHeight(
+		int newWidth,
+		ResizeRequest request,
+		int wasTop,
+		int exactFrom,
+		int exactTill) {
+	// Checked before setY(), so in the coordinates of the previous layout.
+	const auto exact = [&](not_null<Element*> message) {
+		const auto top = wasTop + message->y();
+		return (top < exactTill) && (top + message->height() > exactFrom);
+	};
 	auto y = 0;
 	if (request == ResizeRequest::ReinitAll) {
 		for (const auto &message : messages) {
@@ -3582,15 +3770,21 @@ int HistoryBlock::resizeGetHeight(int newWidth, ResizeRequest request) {
 		}
 	} else if (request == ResizeRequest::ResizeAll) {
 		for (const auto &message : messages) {
+			const auto height = (message->pendingResize()
+				|| exact(message.get()))
+				? message->resizeGetHeight(newWidth)
+				: message->deferResizeGetHeight(newWidth);
 			message->setY(y);
-			y += message->resizeGetHeight(newWidth);
+			y += height;
 		}
 	} else {
 		for (const auto &message : messages) {
-			message->setY(y);
-			y += message->pendingResize()
+			const auto height = (message->pendingResize()
+				|| (message->resizeDeferred() && exact(message.get())))
 				? message->resizeGetHeight(newWidth)
 				: message->height();
+			message->setY(y);
+			y += height;
 		}
 	}
 	_height = y;
@@ -19,6 +19,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 class History;
 class HistoryBlock;
 class HistoryTranslation;
+class HistoryArena;
 class HistoryItem;
 struct HistoryItemCommonFields;
 struct HistoryMessageMarkupData;
@@ -129,14 +130,16 @@ public:
 
 	void applyGroupAdminChanges(const base::flat_set<UserId> &changes);
 
+	[[nodiscard]] HistoryArena &arena();
+
 	template <typename ...Args>
 	not_null<HistoryItem*> makeMessage(MsgId id, Args &&...args) {
 		return static_cast<HistoryItem*>(
 			insertItem(
-				std::make_unique<HistoryItem>(
+				std::unique_ptr<HistoryItem>(new (this) HistoryItem(
 					this,
 					id,
-					std::forward<Args>(args)...)).get());
+					std::forward<Args>(args)...))).get());
 	}
 	template <typename ...Args>
 	not_null<HistoryItem*> makeMessage(
@@ -144,10 +147,10 @@ public:
 			Args &&...args) {
 		return static_cast<HistoryItem*>(
 			insertItem(
-				std::make_unique<HistoryItem>(
+				std::unique_ptr<HistoryItem>(new (this) HistoryItem(
 					this,
 					std::move(fields),
-					std::forward<Args>(args)...)).get());
+					std::forward<Args>(args)...))).get());
 	}
 
 	void destroyMessage(not_null<HistoryItem*> item);
@@ -257,6 +260,7 @@ public:
 	void unknownMessageDeleted(MsgId messageId);
 	void applyDialogTopMessage(MsgId topMessageId);
 	void applyDialog(Data::Folder *requestFolder, const MTPDdialog &data);
+	void applyStoredDialog(const MTPDdialog &data);
 	void applyPinnedUpdate(const MTPDupdateDialogPinned &data);
 	void applyDialogFields(
 		Data::Folder *folder,
@@ -280,6 +284,11 @@ public:
 	HistoryItem *lastEditableMessage() const;
 
 	void resizeToWidth(int newWidth);
+
+	// Only the items intersecting [exactFrom, exactTill) of the current
+	// layout are laid out for the new width, others get estimated heights
+	// until resizeDeferredItems() is called for them.
+	void resizeToWidth(int newWidth, int exactFrom, int exactTill);
 	void forceFullResize();
 	int height() const;
 
@@ -289,6 +298,18 @@ public:
 	bool hasPendingResizedItems() const;
 	void setHasPendingResizedItems();
 
+	[[nodiscard]] bool hasDeferredResizedItems() const;
+
+	// Lays out the deferred items nearest to [from, till) first until
+	// the deadline, returns true if some of them were in [from, till).
+	// Positions are updated only after that or after the last item.
+	bool resizeDeferredItems(int from, int till, crl::time deadline);
+
+	// Lays out all the deferred items in [from, till) right away, counting
+	// the range by the positions they will have after that. Returns true
+	// if there were any, positions are updated in resizeToWidth().
+	bool resizeDeferredItemsIn(int from, int till);
+
 	[[nodiscard]] auto sendActionPainter()
 	-> not_null<HistoryView::SendActionPainter*> override {
 		return &_sendActionPainter;
@@ -423,6 +444,13 @@ public:
 
 	const not_null<PeerData*> peer;
 
+private:
+	// Created on the first allocation and dropped when the history is
+	// cleared with nothing left in it. Declared before the blocks and
+	// the items, so their views and items are destroyed first.
+	std::unique_ptr<HistoryArena> _arena;
+
+public:
 	// Still public data.
 	std::deque<std::unique_ptr<HistoryBlock>> blocks;
 
@@ -455,6 +483,7 @@ private:
 		FakeUnreadWhileOpened = (1 << 4),
 		HasPinnedMessages = (1 << 5),
 		ResolveChatListMessage = (1 << 6),
+		HasDeferredResizedItems = (1 << 7),
 	};
 	using Flags = base::flags<Flag>;
 	friend inline constexpr auto is_flag_type(Flag) {
@@ -616,6 +645,16 @@ private:
 		HistoryBlock *block = nullptr;
 	};
 	std::unique_ptr<BuildingBlock> _buildingFrontBlock;
+
+	// The outward walk of resizeDeferredItems() from [from, till), kept
+	// between the calls and dropped when the blocks or the width change.
+	struct DeferredResizeWalk {
+		int from = 0;
+		int till = 0;
+		Element *above = nullptr;
+		Element *below = nullptr;
+	};
+	std::optional<DeferredResizeWalk> _deferredResizeWalk;
 	std::unique_ptr<HistoryTranslation> _translation;
 
 	Data::HistoryDrafts _drafts;
@@ -651,7 +690,12 @@ public:
 	void remove(not_null<Element*> view);
 	void refreshView(not_null<Element*> view);
 
-	int resizeGetHeight(int newWidth, ResizeRequest request);
+	int resizeGetHeight(
+		int newWidth,
+		ResizeRequest request,
+		int wasTop,
+		int exactFrom,
+		int exactTill);
 	int y() const {
 		return _y;
 	}
@@ -0,0 +1,233 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "history/history_arena.h"
+
+namespace {
+
+// Each history keeps one partially filled page per size class it uses,
+// so the pages are small enough for thousands of loaded chats.
+constexpr auto kPageSize = std::size_t(16 * 1024);
+constexpr auto kSlotAlignment = std::size_t(16);
+constexpr auto kMaxSlotSize = std::size_t(4 * 1024);
+
+HistoryArena::Stats GlobalStats;
+
+[[nodiscard]] std::size_t Aligned(std::size_t size) {
+	return (size + kSlotAlignment - 1) & ~(kSlotAlignment - 1);
+}
+
+} // namespace
+
+struct HistoryArena::Page {
+	[[nodiscard]] static not_null<Page*> Create(not_null<Pool*> pool);
+	static void Destroy(not_null<Page*> page);
+	[[nodiscard]] static not_null<Page*> From(void *pointer);
+
+	static void Link(Page *&list, not_null<Page*> page);
+	static void Unlink(Page *&list, not_null<Page*> page);
+
+	[[nodiscard]] bool full() const;
+	[[nodiscard]] void *take();
+	void put(void *slot);
+
+	Pool *pool = nullptr; // nullptr after the arena was destroyed.
+	Page *prev = nullptr;
+	Page *next = nullptr;
+	void *free = nullptr;
+	char *fresh = nullptr;
+	char *end = nullptr;
+	int slotSize = 0;
+	int used = 0;
+};
+
+struct HistoryArena::Pool {
+	explicit Pool(int slotSize);
+	~Pool();
+
+	[[nodiscard]] void *allocate();
+	void free(not_null<Page*> page, void *slot);
+
+	const int slotSize = 0;
+	Page *available = nullptr;
+	Page *full = nullptr;
+	int64 pages = 0;
+	int64 objects = 0;
+};
+
+auto HistoryArena::Page::Create(not_null<Pool*> pool) -> not_null<Page*> {
+	const auto memory = ::operator new(
+		kPageSize,
+		std::align_val_t(kPageSize));
+	const auto begin = static_cast<char*>(memory);
+	const auto result = new (memory) Page();
+	result->pool = pool;
+	result->fresh = begin + Aligned(sizeof(Page));
+	result->end = begin + kPageSize;
+	result->slotSize = pool->slotSize;
+	++GlobalStats.pages;
+	return result;
+}
+
+void HistoryArena::Page::Destroy(not_null<Page*> page) {
+	Expects(!page->used);
+
+	page->~Page();
+	::operator delete(page.get(), std::align_val_t(kPageSize));
+	--GlobalStats.pages;
+}
+
+auto HistoryArena::Page::From(void *pointer) -> not_null<Page*> {
+	const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+	return reinterpret_cast<Page*>(
+		address & ~std::uintptr_t(kPageSize - 1));
+}
+
+void HistoryArena::Page::Link(Page *&list, not_null<Page*> page) {
+	page->prev = nullptr;
+	page->next = list;
+	if (list) {
+		list->prev = page;
+	}
+	list = page;
+}
+
+void HistoryArena::Page::Unlink(Page *&list, not_null<Page*> page) {
+	if (page->prev) {
+		page->prev->next = page->next;
+	} else {
+		list = page->next;
+	}
+	if (page->next) {
+		page->next->prev = page->prev;
+	}
+	page->prev = page->next = nullptr;
+}
+
+bool HistoryArena::Page::full() const {
+	return !free && (fresh + slotSize > end);
+}
+
+void *HistoryArena::Page::take() {
+	Expects(!full());
+
+	++used;
+	if (const auto result = free) {
+		free = *static_cast<void**>(result);
+		return result;
+	}
+	return std::exchange(fresh, fresh + slotSize);
+}
+
+void HistoryArena::Page::put(void *slot) {
+	Expects(used > 0);
+
+	*static_cast<void**>(slot) = free;
+	free = slot;
+	--used;
+}
+
+HistoryArena::Pool::Pool(int slotSize) : slotSize(slotSize) {
+}
+
+HistoryArena::Pool::~Pool() {
+	for (auto list : { available, full }) {
+		while (const auto page = list) {
+			list = page->next;
+			if (page->used) {
+				page->pool = nullptr;
+				page->prev = page->next = nullptr;
+			} else {
+				Page::Destroy(page);
+			}
+		}
+	}
+}
+
+void *HistoryArena::Pool::allocate() {
+	if (!available) {
+		Page::Link(available, Page::Create(this));
+		++pages;
+	}
+	const auto page = not_null(available);
+	const auto result = page->take();
+	if (page->full()) {
+		Page::Unlink(available, page);
+		Page::Link(full, page);
+	}
+	++objects;
+	return result;
+}
+
+void HistoryArena::Pool::free(not_null<Page*> page, void *slot) {
+	const auto wasFull = page->full();
+	page->put(slot);
+	--objects;
+	if (!page->used) {
+		Page::Unlink(wasFull ? full : available, page);
+		Page::Destroy(page);
+		--pages;
+	} else if (wasFull) {
+		Page::Unlink(full, page);
+		Page::Link(available, page);
+	}
+}
+
+HistoryArena::HistoryArena() = default;
+
+HistoryArena::~HistoryArena() = default;
+
+void *HistoryArena::allocate(std::size_t size) {
+	Expects(size <= kMaxSlotSize);
+
+	const auto slotSize = int(Aligned(std::max(size, sizeof(void*))));
+	const auto result = pool(slotSize)->allocate();
+	++GlobalStats.objects;
+	GlobalStats.bytes += slotSize;
+	return result;
+}
+
+void HistoryArena::Free(void *pointer) {
+	if (!pointer) {
+		return;
+	}
+	const auto page = Page::From(pointer);
+	--GlobalStats.objects;
+	GlobalStats.bytes -= page->slotSize;
+	if (const auto pool = page->pool) {
+		pool->free(page, pointer);
+	} else {
+		page->put(pointer);
+		if (!page->used) {
+			Page::Destroy(page);
+		}
+	}
+}
+
+not_null<HistoryArena::Pool*> HistoryArena::pool(int slotSize) {
+	const auto i = _pools.find(slotSize);
+	if (i != end(_pools)) {
+		return i->second.get();
+	}
+	return _pools.emplace(
+		slotSize,
+		std::make_unique<Pool>(slotSize)).first->second.get();
+}
+
+HistoryArena::Stats HistoryArena::stats() const {
+	auto result = Stats();
+	for (const auto &[slotSize, pool] : _pools) {
+		result.pages += pool->pages;
+		result.objects += pool->objects;
+		result.bytes += pool->objects * slotSize;
+	}
+	return result;
+}
+
+HistoryArena::Stats HistoryArena::Total() {
+	return GlobalStats;
+}
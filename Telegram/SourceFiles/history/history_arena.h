@@ -0,0 +1,48 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+// Slab allocator for the objects a History creates in large numbers:
+// HistoryItem-s and HistoryView::Element-s. Objects of the same size
+// class are packed into aligned pages, so loading a big slice does a
+// handful of allocations instead of one per object. A page goes back to
+// the system as soon as the last object in it is freed, and the pages
+// of a chat never hold objects of other chats, so clearing or unloading
+// one history gives its memory back right away.
+//
+// Main thread only. The arena may be destroyed while some objects
+// allocated in it are still alive (views owned by other sections),
+// their pages are released when the last of those objects is freed.
+class HistoryArena final {
+public:
+	struct Stats {
+		int64 pages = 0;
+		int64 objects = 0;
+		int64 bytes = 0;
+	};
+
+	HistoryArena();
+	HistoryArena(const HistoryArena &other) = delete;
+	HistoryArena &operator=(const HistoryArena &other) = delete;
+	~HistoryArena();
+
+	[[nodiscard]] void *allocate(std::size_t size);
+	static void Free(void *pointer);
+
+	[[nodiscard]] Stats stats() const;
+	[[nodiscard]] static Stats Total();
+
+private:
+	struct Page;
+	struct Pool;
+
+	[[nodiscard]] not_null<Pool*> pool(int slotSize);
+
+	base::flat_map<int, std::unique_ptr<Pool>> _pools;
+
+};
@@ -932,8 +932,10 @@ void HistoryInner::startEffectOnRead(not_null<HistoryItem*> item) {
 }
 
 void HistoryInner::paintEvent(QPaintEvent *e) {
-	if (_controller->contentOverlapped(this, e)
-		|| hasPendingResizedItems()) {
+	if (_controller->contentOverlapped(this, e)) {
+		return;
+	}
+	if (hasPendingResizedItems()) {
 		return;
 	} else if (_recountedAfterPendingResizedItems) {
 		_recountedAfterPendingResizedItems = false;
@@ -1080,8 +1082,12 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 				selfromy - mtop,
 				seltoy - mtop);
 			context.highlight = _widget->itemHighlight(view->data());
-			view->draw(p, context);
-			processPainted(view, top, height);
+			if (!view->resizeDeferred()) {
+				// Visible items are laid out after each geometry update
+				// and scroll, this one is left blank until then.
+				view->draw(p, context);
+				processPainted(view, top, height);
+			}
 
 			top += height;
 			context.translate(0, -height);
@@ -1117,6 +1123,7 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 			const auto item = view->data();
 			if ((context.clip.y() < height)
 				&& (hdrawtop < top + height)
+				&& !view->resizeDeferred()
 				&& !sendingAnimation.hasAnimatedMessage(item)) {
 				context.reactionInfo
 					= _reactionsManager->currentReactionPaintInfo();
@@ -3172,9 +3179,21 @@ void HistoryInner::recountHistoryGeometry() {
 
 	updateBotInfo(false);
 
-	_history->resizeToWidth(_contentWidth);
+	// Items outside of the visible area with a screen around it get only
+	// estimated heights here, they are laid out in resizeDeferredItems().
+	const auto exactFrom = _visibleAreaTop - visibleHeight;
+	const auto exactTill = _visibleAreaBottom + visibleHeight;
+	const auto wasHistoryTop = historyTop();
+	const auto wasMigratedTop = migratedTop();
+	_history->resizeToWidth(
+		_contentWidth,
+		exactFrom - wasHistoryTop,
+		exactTill - wasHistoryTop);
 	if (_migrated) {
-		_migrated->resizeToWidth(_contentWidth);
+		_migrated->resizeToWidth(
+			_contentWidth,
+			exactFrom - wasMigratedTop,
+			exactTill - wasMigratedTop);
 	}
 
 	// With migrated history we perhaps do not need to display
@@ -4090,6 +4109,39 @@ int HistoryInner::historyScrollTop() const {
 	return ScrollMax;
 }
 
+bool HistoryInner::resizeDeferredItems(crl::time deadline) {
+	const auto visibleHeight = _visibleAreaBottom - _visibleAreaTop;
+	const auto from = _visibleAreaTop - visibleHeight;
+	const auto till = _visibleAreaBottom + visibleHeight;
+	auto result = false;
+	if (const auto top = historyTop(); top >= 0) {
+		if (_history->resizeDeferredItems(from - top, till - top, deadline)) {
+			result = true;
+		}
+	}
+	if (const auto top = migratedTop(); top >= 0) {
+		if (_migrated->resizeDeferredItems(from - top, till - top, deadline)) {
+			result = true;
+		}
+	}
+	return result;
+}
+
+bool HistoryInner::resizeDeferredItemsIn(int from, int till) {
+	auto result = false;
+	if (const auto top = historyTop(); top >= 0) {
+		if (_history->resizeDeferredItemsIn(from - top, till - top)) {
+			result = true;
+		}
+	}
+	if (const auto top = migratedTop(); top >= 0) {
+		if (_migrated->resizeDeferredItemsIn(from - top, till - top)) {
+			result = true;
+		}
+	}
+	return result;
+}
+
 int HistoryInner::migratedTop() const {
 	return (_migrated && !_migrated->isEmpty()) ? _historyPaddingTop : -1;
 }
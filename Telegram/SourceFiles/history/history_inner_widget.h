@@ -121,6 +121,13 @@ public:
 	void checkActivation();
 	void recountHistoryGeometry();
 	void updateSize();
+
+	// Returns true if items near the visible area were laid out, so the
+	// geometry should be updated right away.
+	bool resizeDeferredItems(crl::time deadline);
+
+	// Returns true if some deferred items in [from, till) were laid out.
+	bool resizeDeferredItemsIn(int from, int till);
 	void setShownPinned(HistoryItem *item);
 
 	void repaintItem(const HistoryItem *item);
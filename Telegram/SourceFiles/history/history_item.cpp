@@ -19,6 +19,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history_item_helpers.h"
 #include "history/history_unread_things.h"
 #include "history/history.h"
+#include "history/history_arena.h"
 #include "iv/iv_data.h"
 #include "mtproto/mtproto_config.h"
 #include "ui/text/format_values.h"
@@ -755,6 +756,22 @@ HistoryItem::~HistoryItem() {
 	applyTTL(0);
 }
 
+void *HistoryItem::operator new(
+		std::size_t size,
+		not_null<History*> history) {
+	return history->arena().allocate(size);
+}
+
+void HistoryItem::operator delete(
+		void *pointer,
+		not_null<History*> history) {
+	HistoryArena::Free(pointer);
+}
+
+void HistoryItem::operator delete(void *pointer) {
+	HistoryArena::Free(pointer);
+}
+
 TimeId HistoryItem::date() const {
 	return _date;
 }
@@ -1267,12 +1284,11 @@ std::unique_ptr<HistoryView::Element> HistoryItem::createView(
 		not_null<HistoryView::ElementDelegate*> delegate,
 		HistoryView::Element *replacing) {
 	if (isService()) {
-		return std::make_unique<HistoryView::Service>(
-			delegate,
-			this,
-			replacing);
+		return std::unique_ptr<HistoryView::Element>(
+			new (_history) HistoryView::Service(delegate, this, replacing));
 	}
-	return std::make_unique<HistoryView::Message>(delegate, this, replacing);
+	return std::unique_ptr<HistoryView::Element>(
+		new (_history) HistoryView::Message(delegate, this, replacing));
 }
 
 void HistoryItem::invalidateChatListEntry() {
@@ -178,6 +178,13 @@ public:
 		not_null<GameData*> game);
 	~HistoryItem();
 
+	// Items are allocated in the arena of their History.
+	[[nodiscard]] static void *operator new(
+		std::size_t size,
+		not_null<History*> history);
+	static void operator delete(void *pointer, not_null<History*> history);
+	static void operator delete(void *pointer);
+
 	struct Destroyer {
 		void operator()(HistoryItem *value);
 	};
@@ -133,6 +133,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/storage_account.h"
 #include "storage/file_upload.h"
 #include "storage/storage_media_prepare.h"
+#include "storage/storage_messages_store.h"
 #include "media/audio/media_audio.h"
 #include "media/audio/media_audio_capture.h"
 #include "media/player/media_player_instance.h"
@@ -186,6 +187,7 @@ constexpr auto kMessagesPerPage = 50;
 constexpr auto kPreloadHeightsCount = 3; // when 3 screens to scroll left make a preload request
 constexpr auto kScrollToVoiceAfterScrolledMs = 1000;
 constexpr auto kSkipRepaintWhileScrollMs = 100;
+constexpr auto kResizeDeferredItemsDuration = crl::time(8);
 constexpr auto kShowMembersDropdownTimeoutMs = 300;
 constexpr auto kDisplayEditTimeWarningMs = 300 * 1000;
 constexpr auto kFullDayInMs = 86400 * 1000;
@@ -238,6 +240,7 @@ HistoryWidget::HistoryWidget(
 	controller->chatStyle()->value(lifetime(), st::historyScroll),
 	false)
 , _updateHistoryItems([=] { updateHistoryItemsByTimer(); })
+, _resizeDeferredItemsTimer([=] { resizeDeferredItems(); })
 , _cornerButtons(
 	_scroll.data(),
 	controller->chatStyle(),
@@ -2604,6 +2607,7 @@ void HistoryWidget::setHistory(History *history) {
 		_migrated = _history ? _history->migrateFrom() : nullptr;
 		registerDraftSource();
 		if (_history) {
+			_history->owner().messagesStore().historyOpened(_history);
 			setupPreview();
 		} else {
 			_previewDrawPreview = nullptr;
@@ -3606,6 +3610,7 @@ void HistoryWidget::firstLoadMessages() {
 	const auto historyHash = uint64(0);
 
 	const auto history = from;
+	const auto fromEnd = !offsetId && !offset;
 	const auto type = Data::Histories::RequestType::History;
 	auto &histories = history->owner().histories();
 	_firstLoadRequest = histories.sendRequest(history, type, [=](Fn<void()> finish) {
@@ -3619,6 +3624,9 @@ void HistoryWidget::firstLoadMessages() {
 			MTP_int(minId),
 			MTP_long(historyHash)
 		)).done([=](const MTPmessages_Messages &result) {
+			if (fromEnd) {
+				history->owner().messagesStore().saveSlice(history, result);
+			}
 			messagesReceived(history->peer, result, _firstLoadRequest);
 			finish();
 		}).fail([=](const MTP::Error &error) {
@@ -3867,6 +3875,7 @@ void HistoryWidget::visibleAreaUpdated() {
 		const auto scrollTop = _scroll->scrollTop();
 		const auto scrollBottom = scrollTop + _scroll->height();
 		_list->visibleAreaUpdated(scrollTop, scrollBottom);
+		resizeVisibleDeferredItems();
 		controller()->floatPlayerAreaUpdated();
 		session().data().itemVisibilitiesUpdated();
 	}
@@ -6270,6 +6279,54 @@ void HistoryWidget::updateHistoryGeometry(
 	}
 	const auto toY = std::clamp(newScrollTop, 0, _scroll->scrollTopMax());
 	synteticScrollToY(toY);
+	resizeVisibleDeferredItems();
+
+	if ((_history->hasDeferredResizedItems()
+		|| (_migrated && _migrated->hasDeferredResizedItems()))
+		&& !_resizeDeferredItemsTimer.isActive()) {
+		_resizeDeferredItemsTimer.callOnce(0);
+	}
+}
+
+void HistoryWidget::resizeDeferredItems() {
+	if (!_list || !_historyInited) {
+		return;
+	}
+	const auto deadline = crl::now() + kResizeDeferredItemsDuration;
+	const auto resizedVisible = _list->resizeDeferredItems(deadline);
+	if (resizedVisible
+		|| !(_history->hasDeferredResizedItems()
+			|| (_migrated && _migrated->hasDeferredResizedItems()))) {
+		// Keeps the scroll position by the top visible item.
+		updateHistoryGeometry();
+	} else {
+		_resizeDeferredItemsTimer.callOnce(0);
+	}
+}
+
+void HistoryWidget::resizeVisibleDeferredItems() {
+	if (!_list
+		|| !_historyInited
+		|| _scroll->isHidden()
+		|| _resizingVisibleDeferredItems) {
+		return;
+	}
+	_resizingVisibleDeferredItems = true;
+	const auto guard = gsl::finally([&] {
+		_resizingVisibleDeferredItems = false;
+	});
+
+	// Each pass lays out at least one item, so that it ends.
+	while (true) {
+		const auto scrollTop = _scroll->scrollTop();
+		const auto scrollBottom = scrollTop + _scroll->height();
+		if (!_list->resizeDeferredItemsIn(scrollTop, scrollBottom)) {
+			break;
+		}
+		// Items above the laid out ones keep their positions, so the
+		// scroll position doesn't change with the geometry.
+		updateHistoryGeometry();
+	}
 }
 
 void HistoryWidget::revealItemsCallback() {
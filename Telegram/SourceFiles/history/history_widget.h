@@ -573,6 +573,11 @@ private:
 
 	// Does any of the shown histories has this flag set.
 	bool hasPendingResizedItems() const;
+	void resizeDeferredItems();
+
+	// Lays out the deferred items in the scroll area right away,
+	// so that they're painted for the current width.
+	void resizeVisibleDeferredItems();
 
 	// Counts scrollTop for placing the scroll right at the unread
 	// messages bar, choosing from _history and _migrated unreadBar.
@@ -732,6 +737,8 @@ private:
 	int _lastScrollTop = 0; // gifs optimization
 	crl::time _lastScrolled = 0;
 	base::Timer _updateHistoryItems;
+	base::Timer _resizeDeferredItemsTimer;
+	bool _resizingVisibleDeferredItems = false;
 
 	crl::time _lastUserScrolled = 0;
 	bool _synteticScrollEvent = false;
@@ -20,6 +20,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/history_view_reply.h"
 #include "history/view/history_view_text_helper.h"
 #include "history/history.h"
+#include "history/history_arena.h"
 #include "history/history_item_components.h"
 #include "history/history_item_helpers.h"
 #include "base/unixtime.h"
@@ -659,6 +660,21 @@ bool Element::pendingResize() const {
 	return _flags & Flag::NeedsResize;
 }
 
+int Element::deferResizeGetHeight(int newWidth) {
+	Expects(!pendingResize());
+
+	if (width() == newWidth) {
+		_flags &= ~Flag::ResizeDeferred;
+	} else {
+		_flags |= Flag::ResizeDeferred;
+	}
+	return height();
+}
+
+bool Element::resizeDeferred() const {
+	return _flags & Flag::ResizeDeferred;
+}
+
 bool Element::isAttachedToPrevious() const {
 	return _flags & Flag::AttachedToPrevious;
 }
@@ -1252,7 +1268,7 @@ void Element::recountDisplayDateInBlocks() {
 }
 
 QSize Element::countOptimalSize() {
-	_flags &= ~Flag::NeedsResize;
+	_flags &= ~(Flag::NeedsResize | Flag::ResizeDeferred);
 	return performCountOptimalSize();
 }
 
@@ -1260,6 +1276,7 @@ QSize Element::countCurrentSize(int newWidth) {
 	if (_flags & Flag::NeedsResize) {
 		initDimensions();
 	}
+	_flags &= ~Flag::ResizeDeferred;
 	return performCountCurrentSize(newWidth);
 }
 
@@ -1857,6 +1874,18 @@ Element::~Element() {
 	history()->owner().unregisterItemView(this);
 }
 
+void *Element::operator new(std::size_t size, not_null<History*> history) {
+	return history->arena().allocate(size);
+}
+
+void Element::operator delete(void *pointer, not_null<History*> history) {
+	HistoryArena::Free(pointer);
+}
+
+void Element::operator delete(void *pointer) {
+	HistoryArena::Free(pointer);
+}
+
 void Element::Hovered(Element *view) {
 	HoveredElement = view;
 }
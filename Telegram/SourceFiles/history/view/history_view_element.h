@@ -321,6 +321,7 @@ public:
 		TopicRootReply           = 0x0400,
 		MediaOverriden           = 0x0800,
 		HeavyCustomEmoji         = 0x1000,
+		ResizeDeferred           = 0x2000,
 	};
 	using Flags = base::flags<Flag>;
 	friend inline constexpr auto is_flag_type(Flag) { return true; }
@@ -352,6 +353,14 @@ public:
 	[[nodiscard]] bool pendingResize() const;
 	[[nodiscard]] bool isUnderCursor() const;
 
+	// Returns an estimated height for newWidth without the layout, so
+	// that off-screen elements don't cost anything on window resize.
+	// The element keeps its size and layout for the previous width until
+	// resizeGetHeight(), so hit tests and paint stay consistent, and
+	// resizing back to that width brings it back without recounting.
+	int deferResizeGetHeight(int newWidth);
+	[[nodiscard]] bool resizeDeferred() const;
+
 	[[nodiscard]] bool isLastAndSelfMessage() const;
 
 	[[nodiscard]] bool isAttachedToPrevious() const;
@@ -576,6 +585,13 @@ public:
 
 	virtual ~Element();
 
+	// Views are allocated in the arena of the History of their item.
+	[[nodiscard]] static void *operator new(
+		std::size_t size,
+		not_null<History*> history);
+	static void operator delete(void *pointer, not_null<History*> history);
+	static void operator delete(void *pointer);
+
 	static void Hovered(Element *view);
 	[[nodiscard]] static Element *Hovered();
 	static void Pressed(Element *view);
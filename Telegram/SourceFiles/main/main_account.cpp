@@ -494,6 +494,12 @@ void Account::startMtp(std::unique_ptr<MTP::Config> config) {
 }
 
 bool Account::checkForUpdates(const MTP::Response &message) {
+	if (message.prepared) {
+		// Already deserialized on the connection thread.
+		_mtpUpdates.fire_copy(
+			*static_cast<const MTPUpdates*>(message.prepared.get()));
+		return true;
+	}
 	auto updates = MTPUpdates();
 	auto from = message.reply.constData();
 	if (!updates.read(from, from + message.reply.size())) {
@@ -34,9 +34,16 @@ namespace Clip {
 namespace {
 
 constexpr auto kClipThreadsCount = 8;
-constexpr auto kAverageGifSize = 320 * 240;
 constexpr auto kWaitBeforeGifPause = crl::time(200);
 
+// Load of a reader until its decode time is known, in microseconds
+// of decoding per second of playback, 20ms a second is 2% of a core.
+constexpr auto kDefaultReaderLoad = 20'000;
+
+[[nodiscard]] int ThreadsCount() {
+	return std::clamp(QThread::idealThreadCount(), 2, kClipThreadsCount);
+}
+
 QImage PrepareFrame(
 		const FrameRequest &request,
 		const QImage &original,
@@ -127,6 +134,9 @@ public:
 	int loadLevel() const {
 		return _loadLevel;
 	}
+	int queueDepth() const {
+		return _queueDepth.loadAcquire();
+	}
 	void append(Reader *reader, const Core::FileLocation &location, const QByteArray &data);
 	void start(Reader *reader);
 	void update(Reader *reader);
@@ -138,8 +148,12 @@ private:
 	void finish();
 	void callback(Reader *reader, Notification notification);
 	void clear();
+	void updateLoad(not_null<ReaderPrivate*> reader);
+	void removeLoad(not_null<ReaderPrivate*> reader);
 
+	// Sum of the loads of all readers, see kDefaultReaderLoad.
 	QAtomicInt _loadLevel;
+	QAtomicInt _queueDepth;
 	using ReaderPointers = QMap<Reader*, QAtomicInt>;
 	ReaderPointers _readerPointers;
 	mutable QMutex _readerPointersMutex;
@@ -203,7 +217,7 @@ Reader::Reader(const QByteArray &data, Callback &&callback)
 }
 
 void Reader::init(const Core::FileLocation &location, const QByteArray &data) {
-	if (Workers.size() < kClipThreadsCount) {
+	if (Workers.size() < ThreadsCount()) {
 		_threadIndex = Workers.size();
 		Workers.push_back(std::make_unique<Worker>());
 	} else {
@@ -427,6 +441,12 @@ bool Reader::videoPaused() const {
 	return _videoPauseRequest.loadAcquire() != 0;
 }
 
+int Reader::queueDepth() const {
+	return (Workers.size() > _threadIndex)
+		? Workers[_threadIndex]->manager.queueDepth()
+		: 0;
+}
+
 int32 Reader::width() const {
 	return _width;
 }
@@ -553,6 +573,7 @@ public:
 		} else if (readResult == internal::ReaderImplementation::ReadResult::Error) {
 			return error();
 		}
+		const auto previousFrameWhen = _nextFrameWhen;
 		_nextFramePositionMs = _implementation->frameRealTime();
 		_nextFrameWhen = _animationStarted + _implementation->framePresentationTime();
 		if (_nextFrameWhen > _seekPositionMs) {
@@ -560,6 +581,9 @@ public:
 		} else {
 			_nextFrameWhen = 1;
 		}
+		if (_nextFrameWhen > previousFrameWhen) {
+			_frameDelay = _nextFrameWhen - previousFrameWhen;
+		}
 
 		if (!renderFrame()) {
 			return error();
@@ -606,6 +630,20 @@ public:
 		_animationStarted = _nextFrameWhen = ms;
 	}
 
+	void frameDecoded(int microseconds) {
+		_decodeTime = _decodeTime
+			? ((_decodeTime * 7 + microseconds) / 8)
+			: std::max(microseconds, 1);
+	}
+
+	[[nodiscard]] int load() const {
+		if (!_decodeTime || !_frameDelay) {
+			return kDefaultReaderLoad;
+		}
+		const auto perSecond = int64(_decodeTime) * 1000 / _frameDelay;
+		return int(std::clamp(perSecond, int64(1), int64(1'000'000)));
+	}
+
 	void pauseVideo(crl::time ms) {
 		if (_videoPausedAtMs) return; // Paused already.
 
@@ -687,6 +725,10 @@ private:
 	bool _started = false;
 	crl::time _videoPausedAtMs = 0;
 
+	crl::time _frameDelay = 0;
+	int _decodeTime = 0;
+	int _load = 0;
+
 	friend class Manager;
 
 };
@@ -703,7 +745,7 @@ Manager::Manager(not_null<QThread*> thread) {
 
 void Manager::append(Reader *reader, const Core::FileLocation &location, const QByteArray &data) {
 	reader->_private = new ReaderPrivate(reader, location, data);
-	_loadLevel.fetchAndAddRelaxed(kAverageGifSize);
+	updateLoad(reader->_private);
 	update(reader);
 }
 
@@ -735,6 +777,15 @@ bool Manager::carries(Reader *reader) const {
 	return _readerPointers.contains(reader);
 }
 
+void Manager::updateLoad(not_null<ReaderPrivate*> reader) {
+	const auto load = reader->load();
+	_loadLevel.fetchAndAddRelaxed(load - std::exchange(reader->_load, load));
+}
+
+void Manager::removeLoad(not_null<ReaderPrivate*> reader) {
+	_loadLevel.fetchAndAddRelaxed(-std::exchange(reader->_load, 0));
+}
+
 auto Manager::unsafeFindReaderPointer(ReaderPrivate *reader)
 -> ReaderPointers::iterator {
 	const auto it = _readerPointers.find(reader->_interface);
@@ -783,8 +834,9 @@ bool Manager::handleProcessResult(ReaderPrivate *reader, ProcessResult result, c
 	}
 
 	if (result == ProcessResult::Started) {
-		_loadLevel.fetchAndAddRelaxed(reader->_width * reader->_height - kAverageGifSize);
 		it.key()->_durationMs = reader->_durationMs;
+	} else if (result == ProcessResult::CopyFrame) {
+		it.key()->_decodeTime.storeRelease(reader->_decodeTime);
 	}
 	// See if we need to pause GIF because it is not displayed right now.
 	if (!reader->_autoPausedGif && result == ProcessResult::Repaint) {
@@ -826,7 +878,7 @@ bool Manager::handleProcessResult(ReaderPrivate *reader, ProcessResult result, c
 
 Manager::ResultHandleState Manager::handleResult(ReaderPrivate *reader, ProcessResult result, crl::time ms) {
 	if (!handleProcessResult(reader, result, ms)) {
-		_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : kAverageGifSize));
+		removeLoad(reader);
 		delete reader;
 		return ResultHandleRemove;
 	}
@@ -851,7 +903,13 @@ Manager::ResultHandleState Manager::handleResult(ReaderPrivate *reader, ProcessR
 				reader->_frame = index;
 			}
 		}
-		return handleResult(reader, reader->finishProcess(ms), ms);
+		const auto started = std::chrono::steady_clock::now();
+		const auto finished = reader->finishProcess(ms);
+		reader->frameDecoded(int(std::chrono::duration_cast<
+			std::chrono::microseconds
+		>(std::chrono::steady_clock::now() - started).count()));
+		updateLoad(reader);
+		return handleResult(reader, finished, ms);
 	}
 
 	return ResultHandleContinue;
@@ -894,39 +952,66 @@ void Manager::process() {
 		checkAllReaders = (_readers.size() > _readerPointers.size());
 	}
 
+	// Readers that are shown right now go first, then the most late ones.
+	struct Scheduled {
+		not_null<ReaderPrivate*> reader;
+		crl::time when = 0;
+		bool visible = false;
+	};
+	auto scheduled = std::vector<Scheduled>();
 	for (auto i = _readers.begin(), e = _readers.end(); i != e;) {
-		ReaderPrivate *reader = i.key();
+		const auto reader = i.key();
 		if (i.value() <= ms) {
-			ResultHandleState state = handleResult(reader, reader->process(ms), ms);
-			if (state == ResultHandleRemove) {
-				i = _readers.erase(i);
-				continue;
-			} else if (state == ResultHandleStop) {
-				_processingInThread = nullptr;
-				return;
-			}
-			ms = crl::now();
-			if (reader->_videoPausedAtMs) {
-				i.value() = ms + 86400 * 1000ULL;
-			} else if (reader->_nextFrameWhen && reader->_started) {
-				i.value() = reader->_nextFrameWhen;
-			} else {
-				i.value() = (ms + 86400 * 1000ULL);
-			}
+			QMutexLocker lock(&_readerPointersMutex);
+			const auto it = constUnsafeFindReaderPointer(reader);
+			const auto frame = (it != _readerPointers.cend())
+				? it.key()->frameToShow()
+				: nullptr;
+			scheduled.push_back({
+				.reader = reader,
+				.when = i.value(),
+				.visible = frame && (frame->displayed.loadAcquire() > 0),
+			});
 		} else if (checkAllReaders) {
 			QMutexLocker lock(&_readerPointersMutex);
 			auto it = constUnsafeFindReaderPointer(reader);
 			if (it == _readerPointers.cend()) {
-				_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : kAverageGifSize));
+				removeLoad(reader);
 				delete reader;
 				i = _readers.erase(i);
 				continue;
 			}
 		}
-		if (!reader->_autoPausedGif && i.value() < minms) {
+		++i;
+	}
+	ranges::sort(scheduled, [](const Scheduled &a, const Scheduled &b) {
+		return (a.visible != b.visible) ? a.visible : (a.when < b.when);
+	});
+	_queueDepth.storeRelease(int(scheduled.size()));
+
+	for (const auto &entry : scheduled) {
+		const auto reader = entry.reader.get();
+		ResultHandleState state = handleResult(reader, reader->process(ms), ms);
+		if (state == ResultHandleRemove) {
+			_readers.remove(reader);
+			continue;
+		} else if (state == ResultHandleStop) {
+			_processingInThread = nullptr;
+			return;
+		}
+		ms = crl::now();
+		if (reader->_videoPausedAtMs) {
+			_readers[reader] = ms + 86400 * 1000ULL;
+		} else if (reader->_nextFrameWhen && reader->_started) {
+			_readers[reader] = reader->_nextFrameWhen;
+		} else {
+			_readers[reader] = (ms + 86400 * 1000ULL);
+		}
+	}
+	for (auto i = _readers.cbegin(), e = _readers.cend(); i != e; ++i) {
+		if (!i.key()->_autoPausedGif && i.value() < minms) {
 			minms = i.value();
 		}
-		++i;
 	}
 
 	ms = crl::now();
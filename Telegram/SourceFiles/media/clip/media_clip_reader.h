@@ -113,6 +113,15 @@ public:
 		return _threadIndex;
 	}
 
+	// Average time in microseconds to decode and prepare one frame.
+	[[nodiscard]] int decodeTime() const {
+		return _decodeTime.loadAcquire();
+	}
+
+	// Readers that were due for a frame in the last decoding pass
+	// of the thread this reader is assigned to.
+	[[nodiscard]] int queueDepth() const;
+
 	[[nodiscard]] int width() const;
 	[[nodiscard]] int height() const;
 
@@ -173,6 +182,7 @@ private:
 
 	QAtomicInt _autoPausedGif = 0;
 	QAtomicInt _videoPauseRequest = 0;
+	QAtomicInt _decodeTime = 0;
 	int32 _threadIndex;
 
 	friend class Manager;
@@ -19,6 +19,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/audio/media_audio_capture.h"
 #include "media/streaming/media_streaming_instance.h"
 #include "media/streaming/media_streaming_player.h"
+#include "media/streaming/media_streaming_reader.h"
 #include "media/view/media_view_playback_progress.h"
 #include "calls/calls_instance.h"
 #include "history/history.h"
@@ -52,6 +53,9 @@ constexpr auto kRememberShuffledOrderItems = 16;
 
 constexpr auto kMinLengthForSavePosition = 20 * TimeId(60); // 20 minutes.
 
+// Load the beginning of the next track while the current one is playing.
+constexpr auto kWarmUpNextTrackSize = int64(1024 * 1024);
+
 base::options::toggle OptionDisableAutoplayNext({
 	.id = kOptionDisableAutoplayNext,
 	.name = "Disable auto-play of the next track",
@@ -333,6 +337,9 @@ void Instance::playlistUpdated(not_null<Data*> data) {
 		data->playlistIndex = std::nullopt;
 		data->shuffleData = nullptr;
 	}
+	if (data->streamed && data->streamed->instance.ready()) {
+		warmUpNextTrack(data);
+	}
 	data->playlistChanges.fire({});
 }
 
@@ -494,6 +501,49 @@ HistoryItem *Instance::itemByIndex(not_null<Data*> data, int index) {
 	return data->history->owner().message(fullId);
 }
 
+HistoryItem *Instance::nextPlaylistItem(not_null<Data*> data) {
+	if (!data->playlistIndex || order(data) == OrderMode::Shuffle) {
+		return nullptr;
+	}
+	const auto delta = (order(data) == OrderMode::Reverse) ? -1 : 1;
+	return itemByIndex(data, *data->playlistIndex + delta);
+}
+
+void Instance::warmUpNextTrack(not_null<Data*> data) {
+	const auto item = OptionDisableAutoplayNext.value()
+		? nullptr
+		: nextPlaylistItem(data);
+	const auto media = item ? item->media() : nullptr;
+	const auto document = media ? media->document() : nullptr;
+	if (!document
+		|| media->ttlSeconds()
+		|| document == data->current.audio()
+		|| document->loadedInMediaCache()
+		|| !(document->isAudioFile()
+			|| document->isVoiceMessage()
+			|| document->isVideoMessage())) {
+		clearWarmedUp(data);
+		return;
+	}
+	auto reader = document->owner().streaming().sharedReader(
+		document,
+		item->fullId());
+	if (reader == data->warmedUp) {
+		return;
+	}
+	clearWarmedUp(data);
+	if (reader) {
+		reader->warmUp(kWarmUpNextTrackSize);
+		data->warmedUp = std::move(reader);
+	}
+}
+
+void Instance::clearWarmedUp(not_null<Data*> data) {
+	if (const auto reader = base::take(data->warmedUp)) {
+		reader->cancelWarmUp();
+	}
+}
+
 bool Instance::moveInPlaylist(
 		not_null<Data*> data,
 		int delta,
@@ -874,6 +924,7 @@ void Instance::stop(AudioMsgId::Type type) {
 		if (data->streamed) {
 			clearStreamed(data);
 		}
+		clearWarmedUp(data);
 		data->resumeOnCallEnd = false;
 		_playerStopped.fire_copy({type});
 	}
@@ -1296,6 +1347,7 @@ void Instance::handleStreamingUpdate(
 			Core::App().floatPlayerToggleGifsPaused(true);
 			requestRoundVideoResize();
 		}
+		warmUpNextTrack(data);
 		emitUpdate(data->type);
 	}, [&](PreloadedVideo &update) {
 		//emitUpdate(data->type, [](AudioMsgId) { return true; });
@@ -35,6 +35,7 @@ namespace Media {
 namespace Streaming {
 class Document;
 class Instance;
+class Reader;
 struct PlaybackOptions;
 struct Update;
 enum class Error;
@@ -196,6 +197,7 @@ private:
 		bool isPlaying = false;
 		bool resumeOnCallEnd = false;
 		std::unique_ptr<Streamed> streamed;
+		std::shared_ptr<Streaming::Reader> warmedUp;
 		std::unique_ptr<ShuffleData> shuffleData;
 		std::unique_ptr<base::PowerSaveBlocker> powerSaveBlocker;
 		std::unique_ptr<base::PowerSaveBlocker> powerSaveBlockerVideo;
@@ -242,6 +244,9 @@ private:
 		not_null<Data*> data,
 		const TrackState &state);
 	HistoryItem *itemByIndex(not_null<Data*> data, int index);
+	HistoryItem *nextPlaylistItem(not_null<Data*> data);
+	void warmUpNextTrack(not_null<Data*> data);
+	void clearWarmedUp(not_null<Data*> data);
 	void stopAndClear(not_null<Data*> data);
 
 	[[nodiscard]] MsgId computeCurrentUniversalId(
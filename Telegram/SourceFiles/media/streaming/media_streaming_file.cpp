@@ -291,6 +291,7 @@ void File::Context::start(StartOptions options) {
 	if ((error = avformat_find_stream_info(format.get(), nullptr))) {
 		return logFatal(qstr("avformat_find_stream_info"), error);
 	}
+	_reader->setBitrate(format->bit_rate);
 
 	const auto mode = _delegate->fileOpenMode();
 	auto video = initStream(
@@ -501,6 +501,7 @@ void Player::provideStartInformation() {
 		fail(Error::OpenFailed);
 	} else {
 		_stage = Stage::Ready;
+		_firstFrameDelay = crl::now() - _playRequestedTime;
 
 		if (_audio && _audioFinished) {
 			// Audio was stopped before it was ready.
@@ -538,6 +539,7 @@ void Player::play(const PlaybackOptions &options) {
 
 	stop(true);
 	_lastFailure = std::nullopt;
+	_playRequestedTime = crl::now();
 
 	savePreviousReceivedTill(options, previous);
 	_options = options;
@@ -704,6 +706,10 @@ bool Player::receivedTillEnd() const {
 void Player::checkResumeFromWaitingForData() {
 	if (_pausedByWaitingForData && bothReceivedEnough(kBufferFor)) {
 		_pausedByWaitingForData = false;
+		if (_stalledTime != kTimeUnknown) {
+			_stalledDuration += crl::now() - _stalledTime;
+			_stalledTime = kTimeUnknown;
+		}
 		updatePausedState();
 		_updates.fire({ WaitingForData{ false } });
 	}
@@ -722,6 +728,8 @@ void Player::start() {
 		return !bothReceivedEnough(kBufferFor);
 	}) | rpl::start_with_next([=] {
 		_pausedByWaitingForData = true;
+		++_stallsCount;
+		_stalledTime = crl::now();
 		updatePausedState();
 		_updates.fire({ WaitingForData{ true } });
 	}, _sessionLifetime);
@@ -784,7 +792,26 @@ void Player::checkVideoStep() {
 	}
 }
 
+void Player::logPlaybackStats() {
+	if (_firstFrameDelay == kTimeUnknown) {
+		return;
+	}
+	if (_stalledTime != kTimeUnknown) {
+		_stalledDuration += crl::now() - _stalledTime;
+	}
+	DEBUG_LOG(("Streaming Info: First frame in %1 ms, "
+		"stalled %2 times for %3 ms, remote: %4."
+		).arg(_firstFrameDelay
+		).arg(_stallsCount
+		).arg(_stalledDuration
+		).arg(Logs::b(_remoteLoader)));
+	_firstFrameDelay = _stalledTime = kTimeUnknown;
+	_stalledDuration = 0;
+	_stallsCount = 0;
+}
+
 void Player::stop(bool stillActive) {
+	logPlaybackStats();
 	_file->stop(stillActive);
 	_sessionLifetime = rpl::lifetime();
 	_stage = Stage::Uninitialized;
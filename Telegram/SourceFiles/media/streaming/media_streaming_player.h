@@ -132,6 +132,7 @@ private:
 	[[nodiscard]] bool bothReceivedEnough(crl::time amount) const;
 	[[nodiscard]] bool receivedTillEnd() const;
 	void checkResumeFromWaitingForData();
+	void logPlaybackStats();
 	[[nodiscard]] crl::time getCurrentReceivedTill(crl::time duration) const;
 	void savePreviousReceivedTill(
 		const PlaybackOptions &options,
@@ -204,6 +205,13 @@ private:
 	rpl::event_stream<bool> _fullInCache;
 	std::optional<bool> _fullInCacheSinceStart;
 
+	// Time to first frame and stalls, written to the log on stop().
+	crl::time _playRequestedTime = kTimeUnknown;
+	crl::time _firstFrameDelay = kTimeUnknown;
+	crl::time _stalledTime = kTimeUnknown;
+	crl::time _stalledDuration = 0;
+	int _stallsCount = 0;
+
 	crl::time _totalDuration = kTimeUnknown;
 	crl::time _loopingShift = 0;
 	crl::time _previousReceivedTill = kTimeUnknown;
@@ -23,8 +23,10 @@ constexpr auto kMaxOnlyInHeader = 80 * kPartSize;
 constexpr auto kPartsOutsideFirstSliceGood = 8;
 constexpr auto kSlicesInMemory = 2;
 
-// 1 MB of parts are requested from cloud ahead of reading demand.
-constexpr auto kPreloadPartsAhead = 8;
+// At least 1 MB of parts are requested from cloud ahead of reading demand,
+// for high bitrate files enough to cover kPreloadAheadDuration of playback.
+constexpr auto kPreloadPartsAheadMin = 8;
+constexpr auto kPreloadAheadDuration = crl::time(4000);
 constexpr auto kDownloaderRequestsLimit = 4;
 
 using PartsMap = base::flat_map<uint32, QByteArray>;
@@ -270,14 +272,16 @@ void Reader::Slice::addPart(uint32 offset, QByteArray bytes) {
 
 auto Reader::Slice::prepareFill(
 		uint32 from,
-		uint32 till) -> PrepareFillResult {
+		uint32 till,
+		int preloadParts) -> PrepareFillResult {
+	Expects(preloadParts <= kLoadFromRemoteMax);
+
 	auto result = PrepareFillResult();
 
 	result.ready = false;
 	const auto fromOffset = (from / kPartSize) * kPartSize;
 	const auto tillPart = (till + kPartSize - 1) / kPartSize;
-	const auto preloadTillOffset = (tillPart + kPreloadPartsAhead)
-		* kPartSize;
+	const auto preloadTillOffset = (tillPart + preloadParts) * kPartSize;
 
 	const auto after = ranges::upper_bound(
 		parts,
@@ -533,8 +537,10 @@ void Reader::Slices::processPart(
 	Expects(isFullInHeader() || (offset / kInSlice < _data.size()));
 
 	if (isFullInHeader()) {
-		_header.addPart(offset, bytes);
-		checkSliceFullLoaded(0);
+		if (!_header.parts.contains(offset)) {
+			_header.addPart(offset, bytes);
+			checkSliceFullLoaded(0);
+		}
 		return;
 	} else if (_headerMode == HeaderMode::Unknown) {
 		if (_header.parts.contains(offset)) {
@@ -544,11 +550,20 @@ void Reader::Slices::processPart(
 		}
 	}
 	const auto index = offset / kInSlice;
-	_data[index].addPart(offset - index * kInSlice, std::move(bytes));
+	auto &slice = _data[index];
+	const auto inSlice = offset - index * kInSlice;
+	if (slice.parts.contains(inSlice)) {
+		// Could be requested by warmUp() before the cache was read.
+		return;
+	}
+	slice.addPart(inSlice, std::move(bytes));
 	checkSliceFullLoaded(index + 1);
 }
 
-auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
+auto Reader::Slices::fill(
+		uint32 offset,
+		bytes::span buffer,
+		int preloadParts) -> FillResult {
 	Expects(!buffer.empty());
 	Expects(offset < _size);
 	Expects(offset + buffer.size() <= _size);
@@ -562,7 +577,7 @@ auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
 		Assert(waitingForHeaderCache());
 		return {};
 	} else if (isFullInHeader()) {
-		return fillFromHeader(offset, buffer);
+		return fillFromHeader(offset, buffer, preloadParts);
 	}
 
 	auto result = FillResult();
@@ -605,9 +620,15 @@ auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
 	const auto secondTill = (till > (fromSlice + 1) * kInSlice)
 		? (till - (fromSlice + 1) * kInSlice)
 		: 0;
-	const auto first = _data[fromSlice].prepareFill(firstFrom, firstTill);
+	const auto first = _data[fromSlice].prepareFill(
+		firstFrom,
+		firstTill,
+		preloadParts);
 	const auto second = (fromSlice + 1 < tillSlice)
-		? _data[fromSlice + 1].prepareFill(secondFrom, secondTill)
+		? _data[fromSlice + 1].prepareFill(
+			secondFrom,
+			secondTill,
+			preloadParts)
 		: Slice::PrepareFillResult();
 	handlePrepareResult(fromSlice, first);
 	if (fromSlice + 1 < tillSlice) {
@@ -639,13 +660,15 @@ auto Reader::Slices::fill(uint32 offset, bytes::span buffer) -> FillResult {
 	return result;
 }
 
-auto Reader::Slices::fillFromHeader(uint32 offset, bytes::span buffer)
--> FillResult {
+auto Reader::Slices::fillFromHeader(
+		uint32 offset,
+		bytes::span buffer,
+		int preloadParts) -> FillResult {
 	auto result = FillResult();
 	const auto from = offset;
 	const auto till = uint32(offset + buffer.size());
 
-	const auto prepared = _header.prepareFill(from, till);
+	const auto prepared = _header.prepareFill(from, till, preloadParts);
 	for (const auto full : prepared.offsetsFromLoader.values()) {
 		if (full < _size) {
 			result.offsetsFromLoader.add(full);
@@ -850,7 +873,7 @@ Reader::Reader(
 		if (_attachedDownloader) {
 			_partsForDownloader.fire_copy(part);
 		}
-		if (_streamingActive) {
+		if (_streamingActive || _warmingUp) {
 			_loadedParts.emplace(std::move(part));
 		}
 		if (const auto waiting = _waiting.load(std::memory_order_acquire)) {
@@ -895,7 +918,37 @@ void Reader::tryRemoveLoaderAsync() {
 
 void Reader::startStreaming() {
 	_streamingActive = true;
+	_warmingUp = false;
+	refreshLoaderPriority();
+}
+
+void Reader::warmUp(int64 bytes) {
+	if (_streamingActive
+		|| _warmingUp
+		|| _attachedDownloader
+		|| !isRemoteLoader()) {
+		return;
+	}
+	// Nobody reads from _loadingOffsets until startStreaming(), so we
+	// can fill it here and the loaded parts will wait in _loadedParts.
+	// There is no streaming thread yet, so downloader requests are still
+	// processed on the main thread, see continueDownloaderFromMainThread.
+	_warmingUp = true;
 	refreshLoaderPriority();
+	const auto till = std::min(bytes, size());
+	for (auto offset = int64(0); offset < till; offset += kPartSize) {
+		loadAtOffset(uint32(offset));
+	}
+}
+
+void Reader::cancelWarmUp() {
+	if (!_warmingUp) {
+		return;
+	}
+	_warmingUp = false;
+	refreshLoaderPriority();
+	cancelLoadInRange(0, uint32(size()));
+	_loadedParts.take();
 }
 
 void Reader::stopStreaming(bool stillActive) {
@@ -928,6 +981,9 @@ void Reader::loadForDownloader(
 		if (_attachedDownloader) {
 			cancelForDownloader(_attachedDownloader);
 		}
+		// Downloader requests go before the warm-up of a track that
+		// nobody plays yet, so the warm-up loads don't hold them back.
+		cancelWarmUp();
 		_attachedDownloader = downloader;
 		_loader->attachDownloader(downloader);
 	}
@@ -1092,7 +1148,7 @@ void Reader::checkCacheResultsForDownloader() {
 }
 
 void Reader::continueDownloaderFromMainThread() {
-	if (_streamingActive) {
+	if (_streamingActive && !_warmingUp) {
 		wakeFromSleep();
 	} else {
 		processDownloaderRequests();
@@ -1108,7 +1164,9 @@ void Reader::setLoaderPriority(int priority) {
 }
 
 void Reader::refreshLoaderPriority() {
-	_loader->setPriority(_streamingActive ? _realPriority : 0);
+	_loader->setPriority((_streamingActive && !_warmingUp)
+		? _realPriority
+		: 0);
 }
 
 bool Reader::isRemoteLoader() const {
@@ -1205,6 +1263,14 @@ void Reader::headerDone() {
 	_slices.headerDone(false);
 }
 
+void Reader::setBitrate(int64 bitsPerSecond) {
+	const auto ahead = (bitsPerSecond / 8) * kPreloadAheadDuration / 1000;
+	_preloadPartsAhead = int(std::clamp(
+		(ahead + kPartSize - 1) / kPartSize,
+		int64(kPreloadPartsAheadMin),
+		int64(kLoadFromRemoteMax)));
+}
+
 int Reader::headerSize() const {
 	return _slices.headerSize();
 }
@@ -1251,6 +1317,7 @@ Reader::FillState Reader::fill(
 	do {
 		lastResult = fillFromSlices(uint32(offset), buffer);
 		if (lastResult == FillState::Success) {
+			_readTill = uint32(offset + buffer.size());
 			return done();
 		}
 		startWaiting();
@@ -1262,7 +1329,7 @@ Reader::FillState Reader::fill(
 Reader::FillState Reader::fillFromSlices(uint32 offset, bytes::span buffer) {
 	using namespace rpl::mappers;
 
-	auto result = _slices.fill(offset, buffer);
+	auto result = _slices.fill(offset, buffer, preloadPartsAhead(offset));
 	if (result.state != FillState::Success && _slices.headerWontBeFilled()) {
 		_streamingError = Error::NotStreamable;
 		return FillState::Failed;
@@ -1292,6 +1359,16 @@ Reader::FillState Reader::fillFromSlices(uint32 offset, bytes::span buffer) {
 	return result.state;
 }
 
+int Reader::preloadPartsAhead(uint32 offset) {
+	if (offset + kPartSize < _readTill || offset > _readTill + kPartSize) {
+		// After a seek the whole read-ahead is empty, refill it faster.
+		_preloadBoostTill = offset + kLoadFromRemoteMax * kPartSize;
+	}
+	return (offset < _preloadBoostTill)
+		? kLoadFromRemoteMax
+		: std::max(_preloadPartsAhead, kPreloadPartsAheadMin);
+}
+
 void Reader::cancelLoadInRange(uint32 from, uint32 till) {
 	Expects(from < till);
 
@@ -57,6 +57,7 @@ public:
 		not_null<crl::semaphore*> notify);
 	[[nodiscard]] std::optional<Error> streamingError() const;
 	void headerDone();
+	void setBitrate(int64 bitsPerSecond);
 	[[nodiscard]] int headerSize() const;
 	[[nodiscard]] bool fullInCache() const;
 
@@ -79,10 +80,16 @@ public:
 		not_null<Storage::StreamedFileDownloader*> downloader);
 	void continueDownloaderFromMainThread();
 
+	// Request the first bytes of the file before anyone starts streaming,
+	// so that the following startStreaming() won't wait for the network.
+	void warmUp(int64 bytes);
+	void cancelWarmUp();
+
 	~Reader();
 
 private:
-	static constexpr auto kLoadFromRemoteMax = 8;
+	// Most parts that can be requested ahead of the reading position.
+	static constexpr auto kLoadFromRemoteMax = 32;
 
 	struct CacheHelper;
 
@@ -132,7 +139,10 @@ private:
 
 		void processCacheData(PartsMap &&data);
 		void addPart(uint32 offset, QByteArray bytes);
-		PrepareFillResult prepareFill(uint32 from, uint32 till);
+		PrepareFillResult prepareFill(
+			uint32 from,
+			uint32 till,
+			int preloadParts);
 
 		// Get up to kLoadFromRemoteMax not loaded parts in from-till range.
 		StackIntVector<kLoadFromRemoteMax> offsetsFromLoader(
@@ -163,7 +173,10 @@ private:
 		void processCachedSizes(const std::vector<int> &sizes);
 		void processPart(uint32 offset, QByteArray &&bytes);
 
-		[[nodiscard]] FillResult fill(uint32 offset, bytes::span buffer);
+		[[nodiscard]] FillResult fill(
+			uint32 offset,
+			bytes::span buffer,
+			int preloadParts);
 		[[nodiscard]] SerializedSlice unloadToCache();
 
 		[[nodiscard]] QByteArray partForDownloader(uint32 offset) const;
@@ -190,7 +203,8 @@ private:
 		[[nodiscard]] bool computeIsGoodHeader() const;
 		[[nodiscard]] FillResult fillFromHeader(
 			uint32 offset,
-			bytes::span buffer);
+			bytes::span buffer,
+			int preloadParts);
 		void unloadSlice(Slice &slice) const;
 		void checkSliceFullLoaded(int sliceNumber);
 		[[nodiscard]] bool checkFullInCache() const;
@@ -219,6 +233,7 @@ private:
 	bool checkForSomethingMoreReceived();
 
 	FillState fillFromSlices(uint32 offset, bytes::span buffer);
+	[[nodiscard]] int preloadPartsAhead(uint32 offset);
 
 	void finalizeCache();
 
@@ -262,8 +277,12 @@ private:
 	rpl::event_stream<LoadedPart> _partsForDownloader;
 	int _realPriority = 1;
 	bool _streamingActive = false;
+	bool _warmingUp = false;
 
 	// Streaming thread.
+	int _preloadPartsAhead = 0;
+	uint32 _readTill = 0;
+	uint32 _preloadBoostTill = 0;
 	std::deque<uint32> _offsetsForDownloader;
 	base::flat_set<uint32> _downloaderOffsetsRequested;
 	base::flat_map<uint32, std::optional<PartsMap>> _downloaderReadCache;
@@ -205,6 +205,67 @@ QImage ConvertFrame(
 	return storage;
 }
 
+QImage ConvertFrameYUV(
+		FrameFormat format,
+		const FrameYUV &data,
+		QSize resize,
+		QImage storage,
+		FFmpeg::SwscalePointer *existing) {
+	Expects(format == FrameFormat::YUV420 || format == FrameFormat::NV12);
+	Expects(data.y.data != nullptr);
+	Expects(data.u.data != nullptr);
+	Expects((format == FrameFormat::NV12) || (data.v.data != nullptr));
+	Expects(!data.size.isEmpty());
+
+	if (resize.isEmpty()) {
+		resize = data.size;
+	}
+	if (!FFmpeg::GoodStorageForFrame(storage, resize)) {
+		storage = FFmpeg::CreateFrameStorage(resize);
+	}
+
+	auto local = FFmpeg::SwscalePointer();
+	auto &swscale = existing ? *existing : local;
+	swscale = FFmpeg::MakeSwscalePointer(
+		data.size,
+		(format == FrameFormat::YUV420
+			? AV_PIX_FMT_YUV420P
+			: AV_PIX_FMT_NV12),
+		resize,
+		AV_PIX_FMT_BGRA,
+		&swscale);
+	if (!swscale) {
+		return QImage();
+	}
+
+	// AV_NUM_DATA_POINTERS defined in AVFrame struct
+	const uint8_t *srcData[AV_NUM_DATA_POINTERS] = {
+		static_cast<const uint8_t*>(data.y.data),
+		static_cast<const uint8_t*>(data.u.data),
+		static_cast<const uint8_t*>(data.v.data),
+		nullptr,
+	};
+	int srcLinesize[AV_NUM_DATA_POINTERS] = {
+		data.y.stride,
+		data.u.stride,
+		data.v.stride,
+		0,
+	};
+	uint8_t *dstData[AV_NUM_DATA_POINTERS] = { storage.bits(), nullptr };
+	int dstLinesize[AV_NUM_DATA_POINTERS] = { int(storage.bytesPerLine()), 0 };
+
+	sws_scale(
+		swscale.get(),
+		srcData,
+		srcLinesize,
+		0,
+		data.size.height(),
+		dstData,
+		dstLinesize);
+
+	return storage;
+}
+
 FrameYUV ExtractYUV(Stream &stream, AVFrame *frame) {
 	return {
 		.size = { frame->width, frame->height },
@@ -64,6 +64,14 @@ struct Stream {
 	not_null<AVFrame*> frame,
 	QSize resize,
 	QImage storage);
+// Converts and scales YUV420 / NV12 planes in a single pass, so a frame
+// that is painted smaller than its size is never converted in full.
+[[nodiscard]] QImage ConvertFrameYUV(
+	FrameFormat format,
+	const FrameYUV &data,
+	QSize resize,
+	QImage storage,
+	FFmpeg::SwscalePointer *existing = nullptr);
 [[nodiscard]] FrameYUV ExtractYUV(Stream &stream, AVFrame *frame);
 
 struct ExpandDecision {
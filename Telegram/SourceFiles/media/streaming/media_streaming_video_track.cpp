@@ -22,58 +22,6 @@ constexpr auto kDisplaySkipped = crl::time(-1);
 constexpr auto kFinishedPosition = std::numeric_limits<crl::time>::max();
 static_assert(kDisplaySkipped != kTimeUnknown);
 
-[[nodiscard]] QImage ConvertToARGB32(
-		FrameFormat format,
-		const FrameYUV &data) {
-	Expects(data.y.data != nullptr);
-	Expects(data.u.data != nullptr);
-	Expects((format == FrameFormat::NV12) || (data.v.data != nullptr));
-	Expects(!data.size.isEmpty());
-
-	//if (FFmpeg::RotationSwapWidthHeight(stream.rotation)) {
-	//	resize.transpose();
-	//}
-
-	auto result = FFmpeg::CreateFrameStorage(data.size);
-	const auto swscale = FFmpeg::MakeSwscalePointer(
-		data.size,
-		(format == FrameFormat::YUV420
-			? AV_PIX_FMT_YUV420P
-			: AV_PIX_FMT_NV12),
-		data.size,
-		AV_PIX_FMT_BGRA);
-	if (!swscale) {
-		return QImage();
-	}
-
-	// AV_NUM_DATA_POINTERS defined in AVFrame struct
-	const uint8_t *srcData[AV_NUM_DATA_POINTERS] = {
-		static_cast<const uint8_t*>(data.y.data),
-		static_cast<const uint8_t*>(data.u.data),
-		static_cast<const uint8_t*>(data.v.data),
-		nullptr,
-	};
-	int srcLinesize[AV_NUM_DATA_POINTERS] = {
-		data.y.stride,
-		data.u.stride,
-		data.v.stride,
-		0,
-	};
-	uint8_t *dstData[AV_NUM_DATA_POINTERS] = { result.bits(), nullptr };
-	int dstLinesize[AV_NUM_DATA_POINTERS] = { int(result.bytesPerLine()), 0 };
-
-	sws_scale(
-		swscale.get(),
-		srcData,
-		srcLinesize,
-		0,
-		data.size.height(),
-		dstData,
-		dstLinesize);
-
-	return result;
-}
-
 } // namespace
 
 class VideoTrackObject final {
@@ -1214,7 +1162,11 @@ QImage VideoTrack::frameImage(
 	if (frame->original.isNull()
 		&& (frame->format == FrameFormat::YUV420
 			|| frame->format == FrameFormat::NV12)) {
-		frame->original = ConvertToARGB32(frame->format, frame->yuv);
+		frame->original = ConvertFrameYUV(
+			frame->format,
+			frame->yuv,
+			frame->yuv.size,
+			QImage());
 	}
 	if (GoodForRequest(
 			frame->original,
@@ -1255,7 +1207,11 @@ QImage VideoTrack::currentFrameImage() {
 	if (frame->original.isNull()
 		&& (frame->format == FrameFormat::YUV420
 			|| frame->format == FrameFormat::NV12)) {
-		frame->original = ConvertToARGB32(frame->format, frame->yuv);
+		frame->original = ConvertFrameYUV(
+			frame->format,
+			frame->yuv,
+			frame->yuv.size,
+			QImage());
 	}
 	return frame->original;
 }
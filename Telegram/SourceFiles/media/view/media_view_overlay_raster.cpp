@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "ui/painter.h"
 #include "media/stories/media_stories_view.h"
+#include "media/streaming/media_streaming_utility.h"
 #include "media/view/media_view_pip.h"
 #include "platform/platform_overlay_widget.h"
 #include "styles/style_media_view.h"
@@ -92,10 +93,55 @@ void OverlayWidget::RendererSW::paintTransformedVideoFrame(
 	if (!rect.intersects(_clipOuter)) {
 		return;
 	}
-	paintTransformedImage(_owner->videoFrame(), rect, rotation);
+	const auto data = _owner->videoFrameWithInfo();
+	if (data.format == Streaming::FrameFormat::ARGB32) {
+		Assert(!data.image.isNull());
+		if (data.alpha) {
+			_p->fillRect(rect, _transparentBrush);
+		}
+		paintTransformedImage(data.image, rect, rotation);
+	} else if (data.format != Streaming::FrameFormat::None) {
+		const auto size = ((rotation % 180) == 90)
+			? rect.size().transposed()
+			: rect.size();
+		const auto image = convertVideoFrame(
+			data,
+			size * style::DevicePixelRatio());
+		if (!image.isNull()) {
+			paintTransformedImage(image, rect, rotation);
+		}
+	}
 	paintControlsFade(rect, geometry);
 }
 
+QImage OverlayWidget::RendererSW::convertVideoFrame(
+		const Streaming::FrameWithInfo &data,
+		QSize size) {
+	Expects(data.yuv != nullptr);
+
+	// Convert straight to the painted size, only up to the frame size,
+	// the storage and the scaler are reused while they fit.
+	const auto original = data.yuv->size;
+	if (size.width() >= original.width()
+		&& size.height() >= original.height()) {
+		size = original;
+	}
+	const auto reconvert = (_trackFrameIndex != data.index)
+		|| (_streamedIndex != _owner->streamedIndex())
+		|| (_videoFrame.size() != size);
+	_trackFrameIndex = data.index;
+	_streamedIndex = _owner->streamedIndex();
+	if (reconvert) {
+		_videoFrame = Streaming::ConvertFrameYUV(
+			data.format,
+			*data.yuv,
+			size,
+			std::move(_videoFrame),
+			&_videoSwscale);
+	}
+	return _videoFrame;
+}
+
 void OverlayWidget::RendererSW::paintTransformedStaticContent(
 		const QImage &image,
 		ContentGeometry geometry,
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "media/view/media_view_overlay_renderer.h"
+#include "ffmpeg/ffmpeg_utility.h"
 
 namespace Media::View {
 
@@ -34,6 +35,9 @@ private:
 		QRect rect,
 		int rotation);
 	void paintControlsFade(QRect content, const ContentGeometry &geometry);
+	[[nodiscard]] QImage convertVideoFrame(
+		const Streaming::FrameWithInfo &data,
+		QSize size);
 	void paintRadialLoading(
 		QRect inner,
 		bool radial,
@@ -73,6 +77,11 @@ private:
 
 	QImage _overControlImage;
 
+	QImage _videoFrame;
+	FFmpeg::SwscalePointer _videoSwscale;
+	int _trackFrameIndex = 0;
+	int _streamedIndex = 0;
+
 	QImage _topShadowCache;
 	QColor _topShadowColor;
 
@@ -0,0 +1,120 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_metrics.h"
+
+namespace MTP::details {
+namespace {
+
+struct MetricsSummary {
+	int64 bytesSent = 0;
+	int64 bytesReceived = 0;
+	int64 packetsSent = 0;
+	int64 packetsReceived = 0;
+	int64 containersSent = 0;
+	int64 resent = 0;
+	int64 sessionsCreated = 0;
+	int64 sessionsKilled = 0;
+	int64 gzipPacked = 0;
+	int64 gzipSkipped = 0;
+	int64 gzipBytesBefore = 0;
+	int64 gzipBytesAfter = 0;
+	int64 gzipMicroseconds = 0;
+	MetricsHistogram::Snapshot pingRoundTrip = {};
+	MetricsHistogram::Snapshot requestLatency = {};
+};
+
+void Accumulate(MetricsSummary &to, const SessionMetrics &from) {
+	const auto add = [](int64 &to, const std::atomic<int64> &from) {
+		to += from.load(std::memory_order_relaxed);
+	};
+	const auto addHistogram = [](
+			MetricsHistogram::Snapshot &to,
+			const MetricsHistogram &from) {
+		const auto snapshot = from.snapshot();
+		for (auto i = 0; i != MetricsHistogram::kBuckets; ++i) {
+			to[i] += snapshot[i];
+		}
+	};
+	add(to.bytesSent, from.bytesSent);
+	add(to.bytesReceived, from.bytesReceived);
+	add(to.packetsSent, from.packetsSent);
+	add(to.packetsReceived, from.packetsReceived);
+	add(to.containersSent, from.containersSent);
+	add(to.resent, from.resent);
+	add(to.sessionsCreated, from.sessionsCreated);
+	add(to.sessionsKilled, from.sessionsKilled);
+	add(to.gzipPacked, from.gzipPacked);
+	add(to.gzipSkipped, from.gzipSkipped);
+	add(to.gzipBytesBefore, from.gzipBytesBefore);
+	add(to.gzipBytesAfter, from.gzipBytesAfter);
+	add(to.gzipMicroseconds, from.gzipMicroseconds);
+	addHistogram(to.pingRoundTrip, from.pingRoundTrip);
+	addHistogram(to.requestLatency, from.requestLatency);
+}
+
+[[nodiscard]] QString SerializeSummary(
+		const QString &title,
+		const MetricsSummary &summary) {
+	return title
+		+ u": sent %1 bytes in %2 packets (%3 containers, %4 resent), "
+		"received %5 bytes in %6 packets, sessions +%7 -%8\n"_q
+			.arg(summary.bytesSent)
+			.arg(summary.packetsSent)
+			.arg(summary.containersSent)
+			.arg(summary.resent)
+			.arg(summary.bytesReceived)
+			.arg(summary.packetsReceived)
+			.arg(summary.sessionsCreated)
+			.arg(summary.sessionsKilled)
+		+ u"  gzip: %1 packed (%2 -> %3 bytes, %4%), %5 skipped, "
+		"%6 ms\n"_q
+			.arg(summary.gzipPacked)
+			.arg(summary.gzipBytesBefore)
+			.arg(summary.gzipBytesAfter)
+			.arg(summary.gzipBytesBefore
+				? (summary.gzipBytesAfter * 100 / summary.gzipBytesBefore)
+				: 100)
+			.arg(summary.gzipSkipped)
+			.arg(summary.gzipMicroseconds / 1000.)
+		+ u"  ping: "_q
+		+ MetricsHistogram::Serialize(summary.pingRoundTrip)
+		+ u"\n  requests: "_q
+		+ MetricsHistogram::Serialize(summary.requestLatency)
+		+ '\n';
+}
+
+} // namespace
+
+std::shared_ptr<SessionMetrics> Metrics::session(ShiftedDcId shiftedDcId) {
+	QMutexLocker lock(&_mutex);
+	auto &result = _sessions[shiftedDcId];
+	if (!result) {
+		result = std::make_shared<SessionMetrics>();
+	}
+	return result;
+}
+
+QString Metrics::dump() const {
+	QMutexLocker lock(&_mutex);
+	auto result = QString();
+	auto byDc = base::flat_map<DcId, MetricsSummary>();
+	for (const auto &[shiftedDcId, metrics] : _sessions) {
+		auto summary = MetricsSummary();
+		Accumulate(summary, *metrics);
+		Accumulate(byDc[BareDcId(shiftedDcId)], *metrics);
+		result += SerializeSummary(
+			u"Session %1"_q.arg(shiftedDcId),
+			summary);
+	}
+	for (const auto &[dcId, summary] : byDc) {
+		result += SerializeSummary(u"DC %1"_q.arg(dcId), summary);
+	}
+	return result;
+}
+
+} // namespace MTP::details
@@ -0,0 +1,53 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+#include "core/duration_histogram.h"
+#include "base/flat_map.h"
+
+#include <QtCore/QMutex>
+
+namespace MTP::details {
+
+using MetricsHistogram = Core::DurationHistogram<18>;
+
+// Counters of a single session, updated without locks from its thread.
+struct SessionMetrics {
+	std::atomic<int64> bytesSent = 0;
+	std::atomic<int64> bytesReceived = 0;
+	std::atomic<int64> packetsSent = 0;
+	std::atomic<int64> packetsReceived = 0;
+	std::atomic<int64> containersSent = 0;
+	std::atomic<int64> resent = 0;
+	std::atomic<int64> sessionsCreated = 0;
+	std::atomic<int64> sessionsKilled = 0;
+	std::atomic<int64> gzipPacked = 0;
+	std::atomic<int64> gzipSkipped = 0;
+	std::atomic<int64> gzipBytesBefore = 0; // Only of the packed requests.
+	std::atomic<int64> gzipBytesAfter = 0;
+	std::atomic<int64> gzipMicroseconds = 0; // Including skipped requests.
+	MetricsHistogram pingRoundTrip;
+	MetricsHistogram requestLatency;
+};
+
+class Metrics final {
+public:
+	[[nodiscard]] std::shared_ptr<SessionMetrics> session(
+		ShiftedDcId shiftedDcId);
+
+	// Per session and per datacenter summary as a readable text.
+	[[nodiscard]] QString dump() const;
+
+private:
+	mutable QMutex _mutex;
+	base::flat_map<ShiftedDcId, std::shared_ptr<SessionMetrics>> _sessions;
+
+};
+
+} // namespace MTP::details
@@ -0,0 +1,76 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace MTP::details {
+
+// Any thread may push() without locking, only a single consumer thread
+// may takeAll(), it receives everything pushed so far in the push order.
+//
+// Pushed nodes form a stack that the consumer detaches as a whole, so
+// there is no ABA problem, a node is never popped while being pushed.
+template <typename Type>
+class MpscQueue final {
+public:
+	MpscQueue() = default;
+	MpscQueue(const MpscQueue &other) = delete;
+	MpscQueue &operator=(const MpscQueue &other) = delete;
+	~MpscQueue() {
+		destroy(_head.exchange(nullptr, std::memory_order_acquire));
+	}
+
+	void push(Type value) {
+		const auto node = new Node{ std::move(value) };
+		node->next = _head.load(std::memory_order_relaxed);
+		while (!_head.compare_exchange_weak(
+			node->next,
+			node,
+			std::memory_order_release,
+			std::memory_order_relaxed)) {
+		}
+	}
+
+	[[nodiscard]] bool empty() const {
+		return !_head.load(std::memory_order_acquire);
+	}
+
+	[[nodiscard]] std::vector<Type> takeAll() {
+		auto node = _head.exchange(nullptr, std::memory_order_acquire);
+		auto count = 0;
+		for (auto i = node; i; i = i->next) {
+			++count;
+		}
+		auto result = std::vector<Type>(count);
+		while (node) {
+			result[--count] = std::move(node->value);
+			delete std::exchange(node, node->next);
+		}
+		return result;
+	}
+
+private:
+	struct Node {
+		Type value;
+		Node *next = nullptr;
+	};
+
+	static void destroy(Node *node) {
+		while (node) {
+			delete std::exchange(node, node->next);
+		}
+	}
+
+	std::atomic<Node*> _head = nullptr;
+
+};
+
+} // namespace MTP::details
@@ -9,9 +9,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "base/random.h"
 
+#include <zlib.h>
+
 namespace MTP::details {
 namespace {
 
+// Packed body should be at least 10% smaller to be worth unpacking.
+constexpr auto kGzipMaxRatioPercent = 90;
+
 uint32 CountPaddingPrimesCount(
 		uint32 requestSize,
 		bool forAuthKeyInner) {
@@ -143,6 +148,61 @@ bool SerializedRequest::needAck() const {
 	return true;
 }
 
+mtpTypeId SerializedRequest::type() const {
+	Expects(_data != nullptr);
+	Expects(_data->size() > kMessageBodyPosition);
+
+	return mtpTypeId((*_data)[kMessageBodyPosition]);
+}
+
+bool SerializedRequest::gzip() {
+	Expects(_data != nullptr);
+	Expects(_data->size() > kMessageBodyPosition);
+
+	const auto size = uint32(sizeInBytes());
+	auto stream = z_stream();
+	const auto init = deflateInit2(
+		&stream,
+		Z_DEFAULT_COMPRESSION,
+		Z_DEFLATED,
+		16 + MAX_WBITS,
+		8,
+		Z_DEFAULT_STRATEGY);
+	if (init != Z_OK) {
+		LOG(("MTP Error: could not init zlib stream, code: %1").arg(init));
+		return false;
+	}
+	const auto limit = size * kGzipMaxRatioPercent / 100;
+	auto packed = QByteArray(int(limit), Qt::Uninitialized);
+	stream.next_in = reinterpret_cast<Bytef*>(
+		const_cast<void*>(dataInBytes()));
+	stream.avail_in = size;
+	stream.next_out = reinterpret_cast<Bytef*>(packed.data());
+	stream.avail_out = limit;
+	const auto result = deflate(&stream, Z_FINISH);
+	const auto packedSize = limit - stream.avail_out;
+	deflateEnd(&stream);
+	if (result != Z_STREAM_END) {
+		// Didn't fit in the limit, so it is not worth it.
+		return false;
+	}
+	packed.resize(packedSize);
+
+	auto wrapped = mtpBuffer();
+	wrapped.reserve(kMessageBodyPosition + 2 + (packedSize >> 2) + 1);
+	wrapped.resize(kMessageBodyPosition);
+	memcpy(
+		wrapped.data(),
+		_data->constData(),
+		kMessageBodyPosition * sizeof(mtpPrime));
+	wrapped.push_back(mtpc_gzip_packed);
+	MTP_bytes(packed).write(wrapped);
+	wrapped[kMessageLengthPosition] = mtpPrime(
+		(wrapped.size() - kMessageBodyPosition) * sizeof(mtpPrime));
+	static_cast<mtpBuffer&>(*_data) = std::move(wrapped);
+	return true;
+}
+
 size_t SerializedRequest::sizeInBytes() const {
 	Expects(!_data || _data->size() > kMessageBodyPosition);
 	return _data ? (*_data)[kMessageLengthPosition] : 0;
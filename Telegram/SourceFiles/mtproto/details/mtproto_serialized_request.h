@@ -69,6 +69,11 @@ public:
 	[[nodiscard]] uint32 messageSize() const;
 
 	[[nodiscard]] bool needAck() const;
+	[[nodiscard]] mtpTypeId type() const;
+
+	// Replaces the body with its gzip_packed version,
+	// returns false if that didn't make it noticeably smaller.
+	bool gzip();
 
 	using ResponseType = void; // don't know real response type =(
 
@@ -0,0 +1,113 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_session_queues.h"
+
+namespace MTP::details {
+
+void SessionQueues::queueToSend(SerializedRequest request) {
+	if (const auto requestId = request->requestId) {
+		QMutexLocker lock(&_idsMutex);
+		_queuedIds.emplace(requestId);
+	}
+	_toSendQueue.push(std::move(request));
+}
+
+void SessionQueues::queueCancel(mtpRequestId requestId, mtpMsgId msgId) {
+	if (requestId) {
+		QMutexLocker lock(&_idsMutex);
+		_cancelledIds.emplace(requestId);
+	}
+	_cancelQueue.push({ requestId, msgId });
+}
+
+bool SessionQueues::waitingToSend(mtpRequestId requestId) const {
+	QMutexLocker lock(&_idsMutex);
+	return !_cancelledIds.contains(requestId)
+		&& (_queuedIds.contains(requestId) || _toSendIds.contains(requestId));
+}
+
+void SessionQueues::addToSend(SerializedRequest request) {
+	const auto requestId = request->requestId;
+	{
+		QMutexLocker lock(&_idsMutex);
+		_toSendIds.emplace(requestId);
+	}
+	_toSend.emplace(requestId, std::move(request));
+}
+
+void SessionQueues::eraseToSend(mtpRequestId requestId) {
+	{
+		QMutexLocker lock(&_idsMutex);
+		_toSendIds.remove(requestId);
+	}
+	_toSend.remove(requestId);
+}
+
+void SessionQueues::eraseToSend(
+		ToSendMap::iterator from,
+		ToSendMap::iterator till) {
+	if (from == till) {
+		return;
+	}
+	{
+		// Both are sorted by id and hold the same ids,
+		// so the erased ones are a single range in the set.
+		QMutexLocker lock(&_idsMutex);
+		const auto idsFrom = _toSendIds.lower_bound(from->first);
+		const auto idsTill = (till == _toSend.end())
+			? _toSendIds.end()
+			: _toSendIds.lower_bound(till->first);
+		_toSendIds.erase(idsFrom, idsTill);
+	}
+	_toSend.erase(from, till);
+}
+
+void SessionQueues::applyQueued() {
+	// Cancels are taken first, so each of them is taken together with
+	// or after the request it refers to.
+	const auto cancels = _cancelQueue.takeAll();
+	auto requests = _toSendQueue.takeAll();
+
+	QMutexLocker lock(&_idsMutex);
+	for (auto &request : requests) {
+		const auto requestId = request->requestId;
+		_queuedIds.remove(requestId);
+		_toSendIds.emplace(requestId);
+		_toSend.emplace(requestId, std::move(request));
+	}
+
+	// Cancels still in the queue have their ids here already,
+	// so they're never sent, whenever they're taken.
+	for (const auto requestId : _cancelledIds) {
+		if (_toSend.remove(requestId)) {
+			_toSendIds.remove(requestId);
+		}
+	}
+	for (const auto &[requestId, msgId] : cancels) {
+		if (requestId) {
+			_cancelledIds.remove(requestId);
+		}
+		if (msgId) {
+			_haveSent.remove(msgId);
+		}
+	}
+}
+
+void SessionQueues::addReceived(Response &&response) {
+	_receivedMessages.push(std::move(response));
+}
+
+bool SessionQueues::haveReceived() const {
+	return !_receivedMessages.empty();
+}
+
+std::vector<Response> SessionQueues::takeReceived() {
+	return _receivedMessages.takeAll();
+}
+
+} // namespace MTP::details
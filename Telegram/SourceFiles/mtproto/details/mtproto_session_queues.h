@@ -0,0 +1,75 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/mtproto_response.h"
+#include "mtproto/details/mtproto_serialized_request.h"
+#include "mtproto/details/mtproto_mpsc_queue.h"
+#include "base/flat_map.h"
+#include "base/flat_set.h"
+
+namespace MTP::details {
+
+// Requests and responses of SessionData, passed between the Session
+// and the SessionPrivate threads without locking. Only the ids of the
+// requests that are not sent yet are guarded by a mutex, so that their
+// state can be answered and cancels are seen before they're sent.
+class SessionQueues {
+public:
+	// Any thread -> SessionPrivate thread.
+	void queueToSend(SerializedRequest request);
+	void queueCancel(mtpRequestId requestId, mtpMsgId msgId);
+	[[nodiscard]] bool waitingToSend(mtpRequestId requestId) const;
+
+	// SessionPrivate thread only.
+	// Cancels are applied to everything in the toSend map, including the
+	// requests cancelled after the last applyQueued() call.
+	void applyQueued();
+
+	// Requests are added to and erased from the toSend map only by these
+	// methods, so that the ids of the waiting ones are kept up to date.
+	using ToSendMap = base::flat_map<mtpRequestId, SerializedRequest>;
+	ToSendMap &toSendMap() {
+		return _toSend;
+	}
+	void addToSend(SerializedRequest request);
+	void eraseToSend(mtpRequestId requestId);
+	void eraseToSend(
+		ToSendMap::iterator from,
+		ToSendMap::iterator till);
+	base::flat_map<mtpMsgId, SerializedRequest> &haveSentMap() {
+		return _haveSent;
+	}
+
+	// SessionPrivate thread -> Session thread.
+	void addReceived(Response &&response);
+	[[nodiscard]] bool haveReceived() const;
+	[[nodiscard]] std::vector<Response> takeReceived();
+
+private:
+	struct Cancel {
+		mtpRequestId requestId = 0;
+		mtpMsgId msgId = 0;
+	};
+
+	MpscQueue<SerializedRequest> _toSendQueue;
+	MpscQueue<Cancel> _cancelQueue;
+
+	mutable QMutex _idsMutex;
+	base::flat_set<mtpRequestId> _queuedIds; // in _toSendQueue
+	base::flat_set<mtpRequestId> _toSendIds; // in _toSend
+	base::flat_set<mtpRequestId> _cancelledIds; // in _cancelQueue
+
+	ToSendMap _toSend; // map of request_id -> request, that is waiting to be sent
+	base::flat_map<mtpMsgId, SerializedRequest> _haveSent; // map of msg_id -> request, that was sent
+
+	MpscQueue<Response> _receivedMessages; // list of responses / updates that should be processed in the main thread
+
+};
+
+} // namespace MTP::details
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/mtp_instance.h"
 
 #include "mtproto/details/mtproto_dcenter.h"
+#include "mtproto/details/mtproto_metrics.h"
 #include "mtproto/details/mtproto_rsa_public_key.h"
 #include "mtproto/special_config_request.h"
 #include "mtproto/session.h"
@@ -32,6 +33,7 @@ namespace {
 
 constexpr auto kConfigBecomesOldIn = 2 * 60 * crl::time(1000);
 constexpr auto kConfigBecomesOldForBlockedIn = 8 * crl::time(1000);
+constexpr auto kGzipRequestsFromSize = 1024;
 
 using namespace details;
 
@@ -100,6 +102,7 @@ public:
 
 	[[nodiscard]] auto nonPremiumDelayedRequests() const
 	-> rpl::producer<mtpRequestId>;
+	[[nodiscard]] details::Metrics &metrics();
 
 	void restart();
 	void restart(ShiftedDcId shiftedDcId);
@@ -128,6 +131,9 @@ public:
 		crl::time msCanWait,
 		bool needsLayer,
 		mtpRequestId afterRequestId);
+	void gzipIfUseful(
+		SerializedRequest &request,
+		details::SessionMetrics &metrics);
 	void registerRequest(mtpRequestId requestId, ShiftedDcId shiftedDcId);
 	void unregisterRequest(mtpRequestId requestId);
 	void storeRequest(
@@ -136,6 +142,7 @@ public:
 		ResponseHandler &&callbacks);
 	SerializedRequest getRequest(mtpRequestId requestId);
 	[[nodiscard]] bool hasCallback(mtpRequestId requestId) const;
+	void prepareCallback(Response &response) const;
 	void processCallback(const Response &response);
 	void processUpdate(const Response &message);
 
@@ -286,6 +293,7 @@ private:
 	Fn<void(ShiftedDcId shiftedDcId)> _sessionResetHandler;
 
 	rpl::event_stream<mtpRequestId> _nonPremiumDelayedRequests;
+	details::Metrics _metrics;
 
 	base::Timer _checkDelayedTimer;
 
@@ -557,6 +565,10 @@ rpl::producer<ShiftedDcId> Instance::Private::restartsByTimeout() const {
 	return _restartsByTimeout.events();
 }
 
+details::Metrics &Instance::Private::metrics() {
+	return _metrics;
+}
+
 auto Instance::Private::nonPremiumDelayedRequests() const
 -> rpl::producer<mtpRequestId> {
 	return _nonPremiumDelayedRequests.events();
@@ -1011,12 +1023,13 @@ void Instance::Private::sendRequest(
 		bool needsLayer,
 		mtpRequestId afterRequestId) {
 	const auto session = getSession(shiftedDcId);
+	const auto realShiftedDcId = session->getDcWithShift();
 
+	gzipIfUseful(request, *_metrics.session(realShiftedDcId));
 	request->requestId = requestId;
 	storeRequest(requestId, request, std::move(callbacks));
 
 	const auto toMainDc = (shiftedDcId == 0);
-	const auto realShiftedDcId = session->getDcWithShift();
 	const auto signedDcId = toMainDc ? -realShiftedDcId : realShiftedDcId;
 	registerRequest(requestId, signedDcId);
 
@@ -1042,6 +1055,36 @@ void Instance::Private::sendRequest(
 	session->sendPrepared(request, msCanWait);
 }
 
+void Instance::Private::gzipIfUseful(
+		SerializedRequest &request,
+		details::SessionMetrics &metrics) {
+	const auto size = tl::count_length(request);
+	if (size < kGzipRequestsFromSize) {
+		return;
+	}
+	switch (request.type()) {
+	case mtpc_upload_saveFilePart:
+	case mtpc_upload_saveBigFilePart:
+		return; // Media files are compressed already in most cases.
+	}
+	const auto started = std::chrono::steady_clock::now();
+	const auto packed = request.gzip();
+	metrics.gzipMicroseconds += std::chrono::duration_cast<
+		std::chrono::microseconds
+	>(std::chrono::steady_clock::now() - started).count();
+	if (!packed) {
+		++metrics.gzipSkipped;
+		return;
+	}
+	const auto packedSize = tl::count_length(request);
+	++metrics.gzipPacked;
+	metrics.gzipBytesBefore += size;
+	metrics.gzipBytesAfter += packedSize;
+	DEBUG_LOG(("MTP Info: request gzipped from %1 to %2 bytes."
+		).arg(size
+		).arg(packedSize));
+}
+
 void Instance::Private::registerRequest(
 		mtpRequestId requestId,
 		ShiftedDcId shiftedDcId) {
@@ -1136,6 +1179,20 @@ bool Instance::Private::hasCallback(mtpRequestId requestId) const {
 	return (it != _parserMap.cend());
 }
 
+void Instance::Private::prepareCallback(Response &response) const {
+	auto parse = ParseHandler();
+	{
+		QMutexLocker locker(&_parserMapLock);
+		const auto i = _parserMap.find(response.requestId);
+		if (i == _parserMap.cend() || !i->second.parse) {
+			return;
+		}
+		parse = i->second.parse;
+	}
+	response.prepared = parse(response.reply);
+	ReleasePreparedReply(response);
+}
+
 void Instance::Private::processCallback(const Response &response) {
 	const auto requestId = response.requestId;
 	ResponseHandler handler;
@@ -1632,6 +1689,7 @@ not_null<Session*> Instance::Private::startSession(ShiftedDcId shiftedDcId) {
 		shiftedDcId,
 		std::make_unique<Session>(_instance, thread, shiftedDcId, dc)
 	).first->second.get();
+	++_metrics.session(shiftedDcId)->sessionsCreated;
 	if (isKeysDestroyer()) {
 		scheduleKeyDestroy(shiftedDcId);
 	}
@@ -1645,6 +1703,7 @@ void Instance::Private::scheduleSessionDestroy(ShiftedDcId shiftedDcId) {
 		return;
 	}
 	i->second->kill();
+	++_metrics.session(shiftedDcId)->sessionsKilled;
 	_sessionsToDestroy.push_back(std::move(i->second));
 	_sessions.erase(i);
 	InvokeQueued(_instance, [=] {
@@ -1920,6 +1979,10 @@ rpl::producer<mtpRequestId> Instance::nonPremiumDelayedRequests() const {
 	return _private->nonPremiumDelayedRequests();
 }
 
+details::Metrics &Instance::metrics() const {
+	return _private->metrics();
+}
+
 void Instance::requestConfigIfOld() {
 	_private->requestConfigIfOld();
 }
@@ -2057,6 +2120,10 @@ bool Instance::hasCallback(mtpRequestId requestId) const {
 	return _private->hasCallback(requestId);
 }
 
+void Instance::prepareCallback(Response &response) const {
+	_private->prepareCallback(response);
+}
+
 void Instance::processCallback(const Response &response) {
 	_private->processCallback(response);
 }
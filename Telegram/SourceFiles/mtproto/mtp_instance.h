@@ -15,6 +15,7 @@ namespace details {
 
 class Dcenter;
 class Session;
+class Metrics;
 
 [[nodiscard]] int GetNextRequestId();
 
@@ -115,6 +116,7 @@ public:
 	void onSessionReset(ShiftedDcId shiftedDcId);
 
 	[[nodiscard]] bool hasCallback(mtpRequestId requestId) const;
+	void prepareCallback(Response &response) const;
 	void processCallback(const Response &response);
 	void processUpdate(const Response &message);
 
@@ -143,6 +145,9 @@ public:
 	[[nodiscard]] auto nonPremiumDelayedRequests() const
 		-> rpl::producer<mtpRequestId>;
 
+	// Thread safe.
+	[[nodiscard]] details::Metrics &metrics() const;
+
 	void syncHttpUnixtime();
 
 	void sendAnything(ShiftedDcId shiftedDcId = 0, crl::time msCanWait = 0);
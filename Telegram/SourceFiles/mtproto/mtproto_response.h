@@ -59,14 +59,31 @@ struct Response {
 	mtpBuffer reply;
 	mtpMsgId outerMsgId = 0;
 	mtpRequestId requestId = 0;
+
+	// Reply already deserialized on the connection thread, if any.
+	// For results it is what the ParseHandler of the request returned,
+	// for updates (requestId == 0) it is MTPUpdates.
+	std::shared_ptr<const void> prepared;
 };
 
+// Keeps only the type id of a deserialized reply, enough for the checks
+// of the error replies, so that the raw reply isn't kept in memory twice.
+inline void ReleasePreparedReply(Response &response) {
+	if (response.prepared && !response.reply.isEmpty()) {
+		response.reply = mtpBuffer(1, response.reply.front());
+	}
+}
+
 using DoneHandler = FnMut<bool(const Response&)>;
 using FailHandler = Fn<bool(const Error&, const Response&)>;
 
+// Called on the connection thread, must not touch anything but the reply.
+using ParseHandler = Fn<std::shared_ptr<const void>(const mtpBuffer&)>;
+
 struct ResponseHandler {
 	DoneHandler done;
 	FailHandler fail;
+	ParseHandler parse;
 };
 
 } // namespace MTP
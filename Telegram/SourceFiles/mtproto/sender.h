@@ -14,6 +14,28 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace MTP {
 
+// Large results that are deserialized on the connection thread, so that
+// the main thread only applies them. Their raw reply is released right
+// after that, see ReleasePreparedReply(). Everything else is parsed on
+// the main thread, as before.
+template <typename Result>
+inline constexpr auto kParseOffMain = false;
+
+template <>
+inline constexpr auto kParseOffMain<MTPUpdates> = true;
+
+template <>
+inline constexpr auto kParseOffMain<MTPupdates_Difference> = true;
+
+template <>
+inline constexpr auto kParseOffMain<MTPupdates_ChannelDifference> = true;
+
+template <>
+inline constexpr auto kParseOffMain<MTPmessages_Messages> = true;
+
+template <>
+inline constexpr auto kParseOffMain<MTPmessages_Dialogs> = true;
+
 class Sender {
 	class RequestBuilder {
 	public:
@@ -45,11 +67,18 @@ class Sender {
 				auto onstack = std::move(handler);
 				sender->senderRequestHandled(response.requestId);
 
-				auto result = Result();
-				auto from = response.reply.constData();
-				if (!result.read(from, from + response.reply.size())) {
-					return false;
-				} else if (!onstack) {
+				auto parsed = std::optional<Result>();
+				if (!response.prepared) {
+					auto from = response.reply.constData();
+					parsed.emplace();
+					if (!parsed->read(from, from + response.reply.size())) {
+						return false;
+					}
+				}
+				const auto &result = parsed
+					? *parsed
+					: *static_cast<const Result*>(response.prepared.get());
+				if (!onstack) {
 					return true;
 				} else if constexpr (IsCallable<
 						Handler,
@@ -74,6 +103,21 @@ class Sender {
 			};
 		}
 
+		template <typename Result>
+		[[nodiscard]] static ParseHandler MakeParseHandler() {
+			if constexpr (!kParseOffMain<Result>) {
+				return nullptr;
+			} else {
+				return [](const mtpBuffer &reply) {
+					auto result = std::make_shared<Result>();
+					auto from = reply.constData();
+					return result->read(from, from + reply.size())
+						? std::shared_ptr<const void>(std::move(result))
+						: nullptr;
+				};
+			}
+		}
+
 		template <typename Handler>
 		[[nodiscard]] FailHandler MakeFailHandler(
 				not_null<Sender*> sender,
@@ -136,8 +180,11 @@ class Sender {
 		void setCanWait(crl::time ms) noexcept {
 			_canWait = ms;
 		}
-		void setDoneHandler(DoneHandler &&handler) noexcept {
+		void setDoneHandler(
+				DoneHandler &&handler,
+				ParseHandler &&parse = nullptr) noexcept {
 			_done = std::move(handler);
+			_parse = std::move(parse);
 		}
 		template <typename Handler>
 		void setFailHandler(Handler &&handler) noexcept {
@@ -159,6 +206,9 @@ class Sender {
 		[[nodiscard]] DoneHandler takeOnDone() noexcept {
 			return std::move(_done);
 		}
+		[[nodiscard]] ParseHandler takeOnParse() noexcept {
+			return std::move(_parse);
+		}
 		[[nodiscard]] FailHandler takeOnFail() {
 			return v::match(_fail, [&](auto &value) {
 				return MakeFailHandler(
@@ -186,6 +236,7 @@ class Sender {
 		ShiftedDcId _dcId = 0;
 		crl::time _canWait = 0;
 		DoneHandler _done;
+		ParseHandler _parse;
 		std::variant<
 			FailPlainHandler,
 			FailErrorHandler,
@@ -237,7 +288,8 @@ public:
 				const Result &result,
 				mtpRequestId requestId)> callback) {
 			setDoneHandler(
-				MakeDoneHandler<Result>(sender(), std::move(callback)));
+				MakeDoneHandler<Result>(sender(), std::move(callback)),
+				MakeParseHandler<Result>());
 			return *this;
 		}
 		[[nodiscard]] SpecificRequestBuilder &done(
@@ -245,20 +297,23 @@ public:
 				const Result &result,
 				const Response &response)> callback) {
 			setDoneHandler(
-				MakeDoneHandler<Result>(sender(), std::move(callback)));
+				MakeDoneHandler<Result>(sender(), std::move(callback)),
+				MakeParseHandler<Result>());
 			return *this;
 		}
 		[[nodiscard]] SpecificRequestBuilder &done(
 				FnMut<void()> callback) {
 			setDoneHandler(
-				MakeDoneHandler<Result>(sender(), std::move(callback)));
+				MakeDoneHandler<Result>(sender(), std::move(callback)),
+				MakeParseHandler<Result>());
 			return *this;
 		}
 		[[nodiscard]] SpecificRequestBuilder &done(
 			FnMut<void(
 				const typename Request::ResponseType &result)> callback) {
 			setDoneHandler(
-				MakeDoneHandler<Result>(sender(), std::move(callback)));
+				MakeDoneHandler<Result>(sender(), std::move(callback)),
+				MakeParseHandler<Result>());
 			return *this;
 		}
 
@@ -303,8 +358,11 @@ public:
 		mtpRequestId send() {
 			const auto id = sender()->_instance->send(
 				_request,
-				takeOnDone(),
-				takeOnFail(),
+				ResponseHandler{
+					.done = takeOnDone(),
+					.fail = takeOnFail(),
+					.parse = takeOnParse(),
+				},
 				takeDcId(),
 				takeCanWait(),
 				takeAfter(),
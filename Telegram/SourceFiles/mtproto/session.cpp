@@ -349,13 +349,16 @@ void Session::resetDone() {
 }
 
 void Session::cancel(mtpRequestId requestId, mtpMsgId msgId) {
-	if (requestId) {
-		QWriteLocker locker(_data->toSendMutex());
-		_data->toSendMap().remove(requestId);
-	}
-	if (msgId) {
-		QWriteLocker locker(_data->haveSentMutex());
-		_data->haveSentMap().remove(msgId);
+	if (requestId || msgId) {
+		_data->queueCancel(requestId, msgId);
+
+		// Wake up the connection thread, so that the cancelled request
+		// is forgotten before it is resent by a timer or a server notice.
+		if (const auto captured = _private) {
+			InvokeQueued(captured, [=] {
+				captured->tryToSend();
+			});
+		}
 	}
 }
 
@@ -388,8 +391,7 @@ int32 Session::requestState(mtpRequestId requestId) const {
 		return MTP::RequestSent;
 	}
 
-	QWriteLocker locker(_data->toSendMutex());
-	return _data->toSendMap().contains(requestId)
+	return _data->waitingToSend(requestId)
 		? MTP::RequestSending
 		: MTP::RequestSent;
 }
@@ -426,12 +428,9 @@ void Session::sendPrepared(
 		crl::time msCanWait) {
 	DEBUG_LOG(("MTP Info: adding request to toSendMap, msCanWait %1"
 		).arg(msCanWait));
-	{
-		QWriteLocker locker(_data->toSendMutex());
-		_data->toSendMap().emplace(request->requestId, request);
-		*(mtpMsgId*)(request->data() + 4) = 0;
-		*(request->data() + 6) = 0;
-	}
+	*(mtpMsgId*)(request->data() + 4) = 0;
+	*(request->data() + 6) = 0;
+	_data->queueToSend(request);
 
 	DEBUG_LOG(("MTP Info: added, requestId %1").arg(request->requestId));
 	if (msCanWait >= 0) {
@@ -551,9 +550,7 @@ void Session::tryToReceive() {
 		return;
 	}
 	while (true) {
-		auto lock = QWriteLocker(_data->haveReceivedMutex());
-		const auto messages = base::take(_data->haveReceivedMessages());
-		lock.unlock();
+		const auto messages = _data->takeReceived();
 		if (messages.empty()) {
 			break;
 		}
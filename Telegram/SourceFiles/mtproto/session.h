@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/mtproto_response.h"
 #include "mtproto/mtproto_proxy_data.h"
 #include "mtproto/details/mtproto_serialized_request.h"
+#include "mtproto/details/mtproto_session_queues.h"
 
 #include <QtCore/QTimer>
 
@@ -53,7 +54,7 @@ struct SessionOptions {
 };
 
 class Session;
-class SessionData final {
+class SessionData final : public SessionQueues {
 public:
 	explicit SessionData(not_null<Session*> creator) : _owner(creator) {
 	}
@@ -68,26 +69,6 @@ public:
 		return _options;
 	}
 
-	not_null<QReadWriteLock*> toSendMutex() {
-		return &_toSendLock;
-	}
-	not_null<QReadWriteLock*> haveSentMutex() {
-		return &_haveSentLock;
-	}
-	not_null<QReadWriteLock*> haveReceivedMutex() {
-		return &_haveReceivedLock;
-	}
-
-	base::flat_map<mtpRequestId, SerializedRequest> &toSendMap() {
-		return _toSend;
-	}
-	base::flat_map<mtpMsgId, SerializedRequest> &haveSentMap() {
-		return _haveSent;
-	}
-	std::vector<Response> &haveReceivedMessages() {
-		return _receivedMessages;
-	}
-
 	// SessionPrivate -> Session interface.
 	void queueTryToReceive();
 	void queueNeedToResumeAndSend();
@@ -119,15 +100,6 @@ private:
 	SessionOptions _options;
 	mutable QReadWriteLock _optionsLock;
 
-	base::flat_map<mtpRequestId, SerializedRequest> _toSend; // map of request_id -> request, that is waiting to be sent
-	QReadWriteLock _toSendLock;
-
-	base::flat_map<mtpMsgId, SerializedRequest> _haveSent; // map of msg_id -> request, that was sent
-	QReadWriteLock _haveSentLock;
-
-	std::vector<Response> _receivedMessages; // list of responses / updates that should be processed in the main thread
-	QReadWriteLock _haveReceivedLock;
-
 };
 
 class Session final : public QObject {
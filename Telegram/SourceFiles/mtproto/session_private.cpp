@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/details/mtproto_bound_key_creator.h"
 #include "mtproto/details/mtproto_dcenter.h"
 #include "mtproto/details/mtproto_dump_to_text.h"
+#include "mtproto/details/mtproto_metrics.h"
 #include "mtproto/details/mtproto_rsa_public_key.h"
 #include "mtproto/session.h"
 #include "mtproto/mtproto_response.h"
@@ -148,6 +149,7 @@ SessionPrivate::SessionPrivate(
 : QObject(nullptr)
 , _instance(instance)
 , _shiftedDcId(shiftedDcId)
+, _metrics(_instance->metrics().session(_shiftedDcId))
 , _realDcType(_instance->dcOptions().dcType(_shiftedDcId))
 , _currentDcType(_realDcType)
 , _state(DisconnectedState)
@@ -263,19 +265,16 @@ void SessionPrivate::checkSentRequests() {
 	}
 	auto requesting = false;
 	auto nextTimeout = kCheckSentRequestTimeout;
-	{
-		QReadLocker locker(_sessionData->haveSentMutex());
-		auto &haveSent = _sessionData->haveSentMap();
-		for (const auto &[msgId, request] : haveSent) {
-			if (request->lastSentTime <= checkTime) {
-				// Need to check state.
-				request->lastSentTime = now;
-				if (_stateRequestData.emplace(msgId).second) {
-					requesting = true;
-				}
-			} else {
-				nextTimeout = std::min(request->lastSentTime - checkTime, nextTimeout);
+	_sessionData->applyQueued();
+	for (const auto &[msgId, request] : _sessionData->haveSentMap()) {
+		if (request->lastSentTime <= checkTime) {
+			// Need to check state.
+			request->lastSentTime = now;
+			if (_stateRequestData.emplace(msgId).second) {
+				requesting = true;
 			}
+		} else {
+			nextTimeout = std::min(request->lastSentTime - checkTime, nextTimeout);
 		}
 	}
 	if (requesting) {
@@ -474,7 +473,6 @@ mtpMsgId SessionPrivate::replaceMsgId(SerializedRequest &request, mtpMsgId newId
 	if (oldMsgId == newId) {
 		return newId;
 	}
-	// haveSentMutex() was locked in tryToSend()
 	auto &haveSent = _sessionData->haveSentMap();
 
 	while (_resendingIds.contains(newId)
@@ -562,6 +560,7 @@ MTPVector<MTPJSONObjectValue> SessionPrivate::prepareInitParams() {
 
 void SessionPrivate::tryToSend() {
 	DEBUG_LOG(("MTP Info: tryToSend for dc %1.").arg(_shiftedDcId));
+	_sessionData->applyQueued();
 	if (!_connection) {
 		DEBUG_LOG(("MTP Info: not yet connected in dc %1.").arg(_shiftedDcId));
 		return;
@@ -702,17 +701,12 @@ void SessionPrivate::tryToSend() {
 	auto someSkipped = false;
 	SerializedRequest toSendRequest;
 	{
-		QWriteLocker locker1(_sessionData->toSendMutex());
-
 		auto scheduleCheckSentRequests = false;
 
 		auto toSendDummy = base::flat_map<mtpRequestId, SerializedRequest>();
 		auto &toSend = sendAll
 			? _sessionData->toSendMap()
 			: toSendDummy;
-		if (!sendAll) {
-			locker1.unlock();
-		}
 
 		auto totalSending = int(toSend.size());
 		auto sendingFrom = begin(toSend);
@@ -760,8 +754,7 @@ void SessionPrivate::tryToSend() {
 		if (totalSending == 1 && !first->forceSendInContainer) {
 			toSendRequest = first;
 			if (sendAll) {
-				toSend.erase(sendingFrom, sendingTill);
-				locker1.unlock();
+				_sessionData->eraseToSend(sendingFrom, sendingTill);
 			}
 
 			const auto msgId = prepareToSend(
@@ -786,7 +779,6 @@ void SessionPrivate::tryToSend() {
 				if (toSendRequest.needAck()) {
 					toSendRequest->lastSentTime = crl::now();
 
-					QWriteLocker locker2(_sessionData->haveSentMutex());
 					auto &haveSent = _sessionData->haveSentMap();
 					haveSent.emplace(msgId, toSendRequest);
 					scheduleCheckSentRequests = true;
@@ -849,12 +841,11 @@ void SessionPrivate::tryToSend() {
 				containerSize + 3 * sendingCount);
 			toSendRequest->push_back(mtpc_msg_container);
 			toSendRequest->push_back(totalSending);
+			++_metrics->containersSent;
 
 			// check for a valid container
 			auto bigMsgId = base::unixtime::mtproto_msg_id();
 
-			// the fact of this lock is used in replaceMsgId()
-			QWriteLocker locker2(_sessionData->haveSentMutex());
 			auto &haveSent = _sessionData->haveSentMap();
 
 			// prepare sent container
@@ -927,7 +918,9 @@ void SessionPrivate::tryToSend() {
 					memcpy(toSendRequest->data() + from, request->constData() + 4, len * sizeof(mtpPrime));
 				}
 			}
-			toSend.erase(sendingFrom, sendingTill);
+			if (sendAll) {
+				_sessionData->eraseToSend(sendingFrom, sendingTill);
+			}
 
 			if (stateRequest) {
 				const auto msgId = placeToContainer(
@@ -1273,6 +1266,8 @@ void SessionPrivate::handleReceived() {
 		constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
 		auto intsCount = uint32(intsBuffer.size());
 		auto ints = intsBuffer.constData();
+		++_metrics->packetsReceived;
+		_metrics->bytesReceived += intsCount * kIntSize;
 		if ((intsCount < kMinimalIntsCount) || (intsCount > kMaxMessageLength / kIntSize)) {
 			LOG(("TCP Error: bad message received, len %1").arg(intsCount * kIntSize));
 			return restart();
@@ -1404,12 +1399,8 @@ void SessionPrivate::handleReceived() {
 			_sessionData->queueSendAnything(kAckSendWaiting);
 		}
 
-		auto lock = QReadLocker(_sessionData->haveReceivedMutex());
-		const auto tryToReceive = !_sessionData->haveReceivedMessages().empty();
-		lock.unlock();
-
-		if (tryToReceive) {
-			DEBUG_LOG(("MTP Info: queueTryToReceive() - need to parse in another thread, %1 messages.").arg(_sessionData->haveReceivedMessages().size()));
+		if (_sessionData->haveReceived()) {
+			DEBUG_LOG(("MTP Info: queueTryToReceive() - need to parse in another thread."));
 			_sessionData->queueTryToReceive();
 		}
 
@@ -1631,8 +1622,7 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 				)).write(reply);
 
 				// Save rpc_error for processing in the main thread.
-				QWriteLocker locker(_sessionData->haveReceivedMutex());
-				_sessionData->haveReceivedMessages().push_back({
+				_sessionData->addReceived({
 					.reply = std::move(reply),
 					.outerMsgId = info.outerMsgId,
 					.requestId = requestId,
@@ -1830,6 +1820,13 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 			}
 		}
 
+		const auto &haveSent = _sessionData->haveSentMap();
+		const auto sent = haveSent.find(requestMsgId);
+		if (sent != end(haveSent)) {
+			_metrics->requestLatency.add(
+				crl::now() - sent->second->lastSentTime);
+		}
+
 		mtpTypeId typeId = from[0];
 		if (typeId == mtpc_gzip_packed) {
 			DEBUG_LOG(("RPC Info: gzip container"));
@@ -1860,13 +1857,17 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		}
 		const auto requestId = wasSent(requestMsgId);
 		if (requestId && requestId != mtpRequestId(0xFFFFFFFF)) {
-			// Save rpc_result for processing in the main thread.
-			QWriteLocker locker(_sessionData->haveReceivedMutex());
-			_sessionData->haveReceivedMessages().push_back({
+			auto received = Response{
 				.reply = std::move(response),
 				.outerMsgId = info.outerMsgId,
 				.requestId = requestId,
-			});
+			};
+			if (typeId != mtpc_rpc_error) {
+				_instance->prepareCallback(received);
+			}
+
+			// Save rpc_result for processing in the main thread.
+			_sessionData->addReceived(std::move(received));
 		} else {
 			DEBUG_LOG(("RPC Info: requestId not found for msgId %1").arg(requestMsgId));
 		}
@@ -1895,7 +1896,6 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		mtpMsgId firstMsgId = data.vfirst_msg_id().v;
 		QVector<quint64> toResend;
 		{
-			QReadLocker locker(_sessionData->haveSentMutex());
 			const auto &haveSent = _sessionData->haveSentMap();
 			toResend.reserve(haveSent.size());
 			for (const auto &[msgId, request] : haveSent) {
@@ -1914,8 +1914,7 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		if (from > start) memcpy(update.data(), start, (from - start) * sizeof(mtpPrime));
 
 		// Notify main process about new session - need to get difference.
-		QWriteLocker locker(_sessionData->haveReceivedMutex());
-		_sessionData->haveReceivedMessages().push_back({
+		_sessionData->addReceived({
 			.reply = update,
 			.outerMsgId = info.outerMsgId,
 		});
@@ -1935,6 +1934,12 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		}
 		if (data.vping_id().v == _pingId) {
 			_pingId = 0;
+			const auto &haveSent = _sessionData->haveSentMap();
+			const auto i = haveSent.find(data.vmsg_id().v);
+			if (i != end(haveSent)) {
+				_metrics->pingRoundTrip.add(
+					crl::now() - i->second->lastSentTime);
+			}
 		} else {
 			DEBUG_LOG(("Message Info: just pong..."));
 		}
@@ -1963,12 +1968,23 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 			memcpy(update.data(), from, (end - from) * sizeof(mtpPrime));
 		}
 
-		// Notify main process about the new updates.
-		QWriteLocker locker(_sessionData->haveReceivedMutex());
-		_sessionData->haveReceivedMessages().push_back({
-			.reply = update,
+		auto updates = std::make_shared<MTPUpdates>();
+		auto parsed = update.constData();
+		const auto prepared = updates->read(
+			parsed,
+			parsed + update.size());
+
+		auto received = Response{
+			.reply = std::move(update),
 			.outerMsgId = info.outerMsgId,
-		});
+			.prepared = (prepared
+				? std::shared_ptr<const void>(std::move(updates))
+				: nullptr),
+		};
+		ReleasePreparedReply(received);
+
+		// Notify main process about the new updates.
+		_sessionData->addReceived(std::move(received));
 	} else {
 		LOG(("Message Error: unexpected updates in dcType: %1"
 			).arg(static_cast<int>(_currentDcType)));
@@ -2078,7 +2094,6 @@ void SessionPrivate::correctUnixtimeByFastRequest(
 		TimeId serverTime) {
 	const auto now = crl::now();
 
-	QReadLocker locker(_sessionData->haveSentMutex());
 	const auto &haveSent = _sessionData->haveSentMap();
 	for (const auto &id : ids) {
 		const auto i = haveSent.find(id.v);
@@ -2089,7 +2104,6 @@ void SessionPrivate::correctUnixtimeByFastRequest(
 		if (duration < 0 || duration > SyncTimeRequestDuration) {
 			continue;
 		}
-		locker.unlock();
 
 		SyncTimeRequestDuration = duration;
 		base::unixtime::update(serverTime);
@@ -2107,7 +2121,6 @@ void SessionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byResponse)
 
 	QVector<MTPlong> toAckMore;
 	{
-		QWriteLocker locker2(_sessionData->haveSentMutex());
 		auto &haveSent = _sessionData->haveSentMap();
 
 		for (const auto &wrappedMsgId : ids) {
@@ -2148,7 +2161,6 @@ void SessionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byResponse)
 				}
 				_resendingIds.erase(i);
 
-				QWriteLocker locker4(_sessionData->toSendMutex());
 				auto &toSend = _sessionData->toSendMap();
 				const auto j = toSend.find(requestId);
 				if (j == end(toSend)) {
@@ -2163,7 +2175,7 @@ void SessionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byResponse)
 
 				_ackedIds.emplace(msgId, j->second->requestId);
 
-				toSend.erase(j);
+				_sessionData->eraseToSend(requestId);
 				continue;
 			}
 			DEBUG_LOG(("Message Info: msgId %1 was not found in recent resent either").arg(msgId));
@@ -2200,7 +2212,6 @@ void SessionPrivate::handleMsgsStates(const QVector<MTPlong> &ids, const QByteAr
 		const auto state = states[i];
 		const auto requestMsgId = ids[i].v;
 		{
-			QReadLocker locker(_sessionData->haveSentMutex());
 			if (!_sessionData->haveSentMap().contains(requestMsgId)) {
 				DEBUG_LOG(("Message Info: state was received for msgId %1, but request is not found, looking in resent requests...").arg(requestMsgId));
 				const auto reqIt = _resendingIds.find(requestMsgId);
@@ -2255,7 +2266,6 @@ void SessionPrivate::resend(mtpMsgId msgId, crl::time msCanWait) {
 		}
 		return;
 	}
-	auto lock = QWriteLocker(_sessionData->haveSentMutex());
 	auto &haveSent = _sessionData->haveSentMap();
 	auto i = haveSent.find(msgId);
 	if (i == haveSent.end()) {
@@ -2263,32 +2273,22 @@ void SessionPrivate::resend(mtpMsgId msgId, crl::time msCanWait) {
 	}
 	auto request = i->second;
 	haveSent.erase(i);
-	lock.unlock();
+	++_metrics->resent;
 
 	request->lastSentTime = crl::now();
 	request->forceSendInContainer = true;
 	_resendingIds.emplace(msgId, request->requestId);
-	{
-		QWriteLocker locker(_sessionData->toSendMutex());
-		_sessionData->toSendMap().emplace(request->requestId, request);
-	}
+	_sessionData->addToSend(request);
 }
 
 void SessionPrivate::resendAll() {
-	auto lock = QWriteLocker(_sessionData->haveSentMutex());
 	auto haveSent = base::take(_sessionData->haveSentMap());
-	lock.unlock();
-	{
-		auto lock = QWriteLocker(_sessionData->toSendMutex());
-		auto &toSend = _sessionData->toSendMap();
-		const auto now = crl::now();
-		for (auto &[msgId, request] : haveSent) {
-			const auto requestId = request->requestId;
-			request->lastSentTime = now;
-			request->forceSendInContainer = true;
-			_resendingIds.emplace(msgId, requestId);
-			toSend.emplace(requestId, std::move(request));
-		}
+	const auto now = crl::now();
+	for (auto &[msgId, request] : haveSent) {
+		request->lastSentTime = now;
+		request->forceSendInContainer = true;
+		_resendingIds.emplace(msgId, request->requestId);
+		_sessionData->addToSend(std::move(request));
 	}
 
 	_sessionData->queueSendAnything();
@@ -2682,6 +2682,8 @@ bool SessionPrivate::sendSecureRequest(
 
 	_connection->setSentEncryptedWithKeyId(_keyId);
 	_connection->sendData(std::move(packet));
+	++_metrics->packetsSent;
+	_metrics->bytesSent += (prefix + fullSize) * sizeof(mtpPrime);
 
 	if (needAnyResponse) {
 		onSentSome((prefix + fullSize) * sizeof(mtpPrime));
@@ -2704,15 +2706,12 @@ mtpRequestId SessionPrivate::wasSent(mtpMsgId msgId) const {
 		return mtpRequestId(0xFFFFFFFF);
 	}
 
-	{
-		QReadLocker locker(_sessionData->haveSentMutex());
-		const auto &haveSent = _sessionData->haveSentMap();
-		const auto i = haveSent.find(msgId);
-		if (i != haveSent.end()) {
-			return i->second->requestId
-				? i->second->requestId
-				: mtpRequestId(0xFFFFFFFF);
-		}
+	const auto &haveSent = _sessionData->haveSentMap();
+	const auto i = haveSent.find(msgId);
+	if (i != haveSent.end()) {
+		return i->second->requestId
+			? i->second->requestId
+			: mtpRequestId(0xFFFFFFFF);
 	}
 	return 0;
 }
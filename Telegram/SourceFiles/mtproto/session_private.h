@@ -18,6 +18,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace MTP {
 namespace details {
 class BoundKeyCreator;
+struct SessionMetrics;
 } // namespace details
 
 class Instance;
@@ -182,6 +183,7 @@ private:
 
 	const not_null<Instance*> _instance;
 	const ShiftedDcId _shiftedDcId = 0;
+	const std::shared_ptr<SessionMetrics> _metrics;
 	DcType _realDcType = DcType();
 	DcType _currentDcType = DcType();
 
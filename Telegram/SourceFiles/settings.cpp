@@ -38,6 +38,7 @@ int32 gLastUpdateCheck = 0;
 bool gNoStartUpdate = false;
 bool gStartToSettings = false;
 bool gDebugMode = false;
+crl::time gStallThreshold = 0;
 
 uint32 gConnectionsInSession = 1;
 
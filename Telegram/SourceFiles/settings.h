@@ -80,6 +80,7 @@ DeclareSetting(int32, LastUpdateCheck);
 DeclareSetting(bool, NoStartUpdate);
 DeclareSetting(bool, StartToSettings);
 DeclareSetting(bool, DebugMode);
+DeclareSetting(crl::time, StallThreshold);
 DeclareReadSetting(bool, ManyInstance);
 DeclareSetting(bool, Quit);
 
@@ -11,7 +11,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwidget.h"
 #include "mainwindow.h"
 #include "data/data_session.h"
+#include "data/data_changes.h"
 #include "data/data_cloud_themes.h"
+#include "data/stickers/data_custom_emoji.h"
+#include "history/history_arena.h"
 #include "main/main_session.h"
 #include "main/main_account.h"
 #include "main/main_domain.h"
@@ -20,6 +23,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_instance.h"
 #include "core/application.h"
 #include "mtproto/mtp_instance.h"
+#include "mtproto/details/mtproto_metrics.h"
 #include "mtproto/mtproto_dc_options.h"
 #include "core/file_utilities.h"
 #include "core/update_checker.h"
@@ -28,6 +32,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "window/window_session_controller.h"
 #include "media/audio/media_audio_track.h"
 #include "settings/settings_folders.h"
+#include "storage/localimageloader.h"
 #include "api/api_updates.h"
 #include "base/qt/qt_common_adapters.h"
 #include "base/custom_app_icon.h"
@@ -71,6 +76,20 @@ using SessionController = Window::SessionController;
 	return result;
 }
 
+void WriteAndShowDump(const QString &name, const QString &text) {
+	const auto path = cWorkingDir() + name;
+	auto f = QFile(path);
+	const auto bytes = text.toUtf8();
+	if (!f.open(QIODevice::WriteOnly)) {
+		Ui::Toast::Show("Could not open " + name + " :(");
+	} else if (f.write(bytes) != bytes.size()) {
+		Ui::Toast::Show("Could not write " + name + " :(");
+	} else {
+		f.close();
+		File::ShowInFolder(path);
+	}
+}
+
 auto GenerateCodes() {
 	auto codes = std::map<QString, Fn<void(SessionController*)>>();
 	codes.emplace(u"debugmode"_q, [](SessionController *window) {
@@ -84,6 +103,52 @@ auto GenerateCodes() {
 	codes.emplace(u"viewlogs"_q, [](SessionController *window) {
 		File::ShowInFolder(cWorkingDir() + "log.txt");
 	});
+	codes.emplace(u"netmetrics"_q, [](SessionController *window) {
+		if (!Core::App().domain().started()) {
+			return;
+		}
+		auto text = QString();
+		for (const auto &[index, account] : Core::App().domain().accounts()) {
+			text += u"Account %1\n"_q.arg(index)
+				+ account->mtp().metrics().dump();
+		}
+		WriteAndShowDump(u"mtproto_metrics.txt"_q, text);
+	});
+	codes.emplace(u"perfstats"_q, [](SessionController *window) {
+		if (!Core::App().domain().started()) {
+			return;
+		}
+		auto text = QString();
+		for (const auto &[index, account] : Core::App().domain().accounts()) {
+			if (account->sessionExists()) {
+				text += u"Account %1\n"_q.arg(index);
+				const auto changes = account->session().changes().stats();
+				text += u"Changes: %1 updates sent, %2 to objects, "
+					"%3 object streams with %4 subscribers\n"_q
+						.arg(changes.sent)
+						.arg(changes.sentToObjects)
+						.arg(changes.objectStreams)
+						.arg(changes.objectSubscribers);
+				const auto emoji = account->session().data()
+					.customEmojiManager().cacheStats();
+				text += u"Custom emoji: %1 instances (%2 unused, %3 KB "
+					"of frames), %4 hits, %5 misses, %6 evicted\n"_q
+						.arg(emoji.instances)
+						.arg(emoji.unused)
+						.arg(emoji.frameBytes / 1024)
+						.arg(emoji.hits)
+						.arg(emoji.misses)
+						.arg(emoji.evicted);
+			}
+		}
+		const auto arena = HistoryArena::Total();
+		text += u"\nHistory arenas: %1 objects (%2 bytes) in %3 pages\n"_q
+			.arg(arena.objects)
+			.arg(arena.bytes)
+			.arg(arena.pages);
+		text += u"\nFiles for sending\n  "_q + FilePrepareStats() + '\n';
+		WriteAndShowDump(u"perf_stats.txt"_q, text);
+	});
 	if (!Core::UpdaterDisabled()) {
 		codes.emplace(u"testupdate"_q, [](SessionController *window) {
 			Core::UpdateChecker().test();
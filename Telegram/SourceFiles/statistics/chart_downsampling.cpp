@@ -0,0 +1,86 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "statistics/chart_downsampling.h"
+
+namespace Statistic {
+
+std::vector<int> DownsampleIndices(
+		const std::vector<float64> &x,
+		const std::vector<not_null<const std::vector<ChartValue>*>> &lines,
+		int from,
+		int till,
+		int count) {
+	from = std::max(from, 0);
+	till = std::min(till, int(x.size()) - 1);
+	auto result = std::vector<int>();
+	if (from > till) {
+		return result;
+	}
+	const auto size = till - from + 1;
+	if (size <= count || count < 3) {
+		result.resize(size);
+		ranges::iota(result, from);
+		return result;
+	}
+	result.reserve(count);
+	result.push_back(from);
+
+	// Buckets are between the first and the last points.
+	const auto bucket = float64(size - 2) / (count - 2);
+	const auto bucketStart = [&](int index) {
+		return from + 1 + int(bucket * index);
+	};
+	auto averageY = std::vector<float64>(lines.size());
+	auto chosen = from;
+	for (auto i = 0; i != count - 2; ++i) {
+		const auto start = bucketStart(i);
+		const auto end = bucketStart(i + 1);
+
+		// Average of the next bucket, or the last point for the last one.
+		const auto nextStart = end;
+		const auto nextEnd = (i + 2 < count - 2)
+			? bucketStart(i + 2)
+			: (till + 1);
+		const auto nextCount = nextEnd - nextStart;
+		auto averageX = 0.;
+		for (auto j = nextStart; j != nextEnd; ++j) {
+			averageX += x[j];
+		}
+		averageX /= nextCount;
+		for (auto k = 0; k != lines.size(); ++k) {
+			const auto &y = *lines[k];
+			auto sum = 0.;
+			for (auto j = nextStart; j != nextEnd; ++j) {
+				sum += y[j];
+			}
+			averageY[k] = sum / nextCount;
+		}
+
+		auto maxArea = -1.;
+		auto maxIndex = start;
+		const auto ax = x[chosen];
+		for (auto j = start; j != end; ++j) {
+			auto area = 0.;
+			for (auto k = 0; k != lines.size(); ++k) {
+				const auto &y = *lines[k];
+				const auto ay = float64(y[chosen]);
+				area += std::abs((ax - averageX) * (y[j] - ay)
+					- (ax - x[j]) * (averageY[k] - ay));
+			}
+			if (area > maxArea) {
+				maxArea = area;
+				maxIndex = j;
+			}
+		}
+		result.push_back(chosen = maxIndex);
+	}
+	result.push_back(till);
+	return result;
+}
+
+} // namespace Statistic
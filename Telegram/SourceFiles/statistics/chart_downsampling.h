@@ -0,0 +1,27 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "statistics/statistics_types.h"
+
+namespace Statistic {
+
+// Chooses at most `count` indices from [from, till] for drawing, using
+// Largest-Triangle-Three-Buckets: the first and the last indices are
+// always kept and from each bucket between them the one making the
+// largest triangle with the previously chosen point and the average of
+// the next bucket is taken. With several lines the areas are summed,
+// so that the chosen indices can be shared by stacked lines.
+[[nodiscard]] std::vector<int> DownsampleIndices(
+	const std::vector<float64> &x,
+	const std::vector<not_null<const std::vector<ChartValue>*>> &lines,
+	int from,
+	int till,
+	int count);
+
+} // namespace Statistic
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "statistics/view/linear_chart_view.h"
 
 #include "data/data_statistics_chart.h"
+#include "statistics/chart_downsampling.h"
 #include "statistics/chart_lines_filter_controller.h"
 #include "statistics/statistics_common.h"
 #include "ui/effects/animation_value_f.h"
@@ -35,7 +36,15 @@ void PaintChartLine(
 
 	const auto ratio = ratios.ratio(line.id);
 
-	for (auto i = localStart; i <= localEnd; i++) {
+	// There is no sense to draw more than one point per pixel.
+	const auto indices = DownsampleIndices(
+		c.chartData.xPercentage,
+		{ &line.y },
+		localStart,
+		localEnd,
+		c.rect.width() * style::DevicePixelRatio());
+	chartPoints.reserve(indices.size());
+	for (const auto i : indices) {
 		if (line.y[i] < 0) {
 			continue;
 		}
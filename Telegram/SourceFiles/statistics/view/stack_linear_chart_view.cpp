@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "statistics/view/stack_linear_chart_view.h"
 
 #include "data/data_statistics_chart.h"
+#include "statistics/chart_downsampling.h"
 #include "statistics/chart_lines_filter_controller.h"
 #include "statistics/view/stack_chart_common.h"
 #include "statistics/widgets/point_details_widget.h"
@@ -307,7 +308,27 @@ void StackLinearChartView::paintChartOrZoomAnimation(
 		ovalPath = ovalPath.intersected(rectPath);
 	}
 
-	for (auto i = localStart; i <= localEnd; i++) {
+	// There is no sense to draw more than one point per pixel, the same
+	// indices are taken for all the lines so that they stay stacked.
+	auto shownLines = std::vector<not_null<const std::vector<ChartValue>*>>();
+	for (const auto &line : c.chartData.lines) {
+		if (linesFilter->alpha(line.id)) {
+			shownLines.push_back(&line.y);
+		}
+	}
+	const auto indices = DownsampleIndices(
+		c.chartData.xPercentage,
+		shownLines,
+		int(localStart),
+		int(localEnd),
+		c.rect.width() * style::DevicePixelRatio());
+
+	for (auto j = 0; j != int(indices.size()); ++j) {
+		const auto i = indices[j];
+		const auto previous = (j > 0) ? indices[j - 1] : -1;
+		const auto next = (j + 1 < int(indices.size()))
+			? indices[j + 1]
+			: -1;
 		auto stackOffset = 0.;
 		auto sum = 0.;
 		auto lastEnabled = int(0);
@@ -402,9 +423,9 @@ void StackLinearChartView::paintChartOrZoomAnimation(
 				} else {
 					const auto &xLimits = xPercentageLimits;
 					const auto isNextXPointAfterCenter = false
-						|| center.x() < (c.rect.width() * ((i == localEnd)
+						|| center.x() < (c.rect.width() * ((next < 0)
 							? 1.
-							: ((c.chartData.xPercentage[i + 1] - xLimits.min)
+							: ((c.chartData.xPercentage[next] - xLimits.min)
 								/ (xLimits.max - xLimits.min))));
 					if (isNextXPointAfterCenter) {
 						pointZero = resultPoint = QPointF()
@@ -436,8 +457,8 @@ void StackLinearChartView::paintChartOrZoomAnimation(
 
 			const auto yRatio = 1. - (isLastLine ? _transition.progress : 0.);
 			if ((!yPercentage)
-				&& (i > 0 && (y[i - 1] == 0))
-				&& (i < localEnd && (y[i + 1] == 0))
+				&& (previous >= 0 && (y[previous] == 0))
+				&& (next >= 0 && (y[next] == 0))
 				&& (!hasTransitionAnimation)) {
 				if (!_skipPoints[k]) {
 					chartPath.lineTo(pointZero.x(), pointZero.y() * yRatio);
@@ -0,0 +1,46 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/details/storage_drafts_store.h"
+
+#include "storage/serialize_common.h"
+
+namespace Storage {
+namespace details {
+
+int DraftsStoreEntrySize(const DraftsStoreEntry &entry) {
+	return sizeof(quint64)
+		+ Serialize::bytearraySize(entry.drafts)
+		+ Serialize::bytearraySize(entry.cursors);
+}
+
+void WriteDraftsStoreEntry(
+		QDataStream &stream,
+		quint64 peerIdSerialized,
+		const DraftsStoreEntry &entry) {
+	stream << peerIdSerialized << entry.drafts << entry.cursors;
+}
+
+bool ReadDraftsStoreEntries(
+		QDataStream &stream,
+		Fn<void(quint64 peerIdSerialized, DraftsStoreEntry &&entry)> callback) {
+	auto count = quint32();
+	stream >> count;
+	for (auto i = quint32(); i != count; ++i) {
+		auto peerIdSerialized = quint64();
+		auto entry = DraftsStoreEntry();
+		stream >> peerIdSerialized >> entry.drafts >> entry.cursors;
+		if (stream.status() != QDataStream::Ok) {
+			return false;
+		}
+		callback(peerIdSerialized, std::move(entry));
+	}
+	return stream.status() == QDataStream::Ok;
+}
+
+} // namespace details
+} // namespace Storage
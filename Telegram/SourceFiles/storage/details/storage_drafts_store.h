@@ -0,0 +1,34 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Storage {
+namespace details {
+
+// Drafts of all peers are kept in one file. Its snapshot and each of
+// its journal records hold the generation, the entries count and the
+// entries, removed peers are written with empty drafts and cursors.
+struct DraftsStoreEntry {
+	QByteArray drafts;
+	QByteArray cursors;
+};
+
+[[nodiscard]] int DraftsStoreEntrySize(const DraftsStoreEntry &entry);
+void WriteDraftsStoreEntry(
+	QDataStream &stream,
+	quint64 peerIdSerialized,
+	const DraftsStoreEntry &entry);
+
+// Returns false if the stream is broken, the entries read before
+// that are already passed to the callback.
+[[nodiscard]] bool ReadDraftsStoreEntries(
+	QDataStream &stream,
+	Fn<void(quint64 peerIdSerialized, DraftsStoreEntry &&entry)> callback);
+
+} // namespace details
+} // namespace Storage
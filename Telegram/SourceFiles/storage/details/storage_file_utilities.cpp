@@ -30,8 +30,19 @@ struct WriteEntry {
 	QString base;
 	QByteArray data;
 	QByteArray md5;
+	std::vector<Fn<void()>> whenWritten;
+	bool append = false;
+	bool clearJournal = false;
 };
 
+[[nodiscard]] std::vector<Fn<void()>> WhenWritten(Fn<void()> callback) {
+	auto result = std::vector<Fn<void()>>();
+	if (callback) {
+		result.push_back(std::move(callback));
+	}
+	return result;
+}
+
 class WriteManager final {
 public:
 	explicit WriteManager(crl::weak_on_thread<WriteManager> weak);
@@ -45,6 +56,9 @@ private:
 	void writeScheduled();
 	bool writeOneScheduledNow();
 	void writeNow(WriteEntry &&entry);
+	void appendNow(WriteEntry &&entry);
+	void notifyWritten(WriteEntry &entry);
+	int removeReplaced(WriteEntry &entry);
 
 	template <typename File>
 	[[nodiscard]] bool open(File &file, const WriteEntry &entry, char postfix);
@@ -52,7 +66,8 @@ private:
 	[[nodiscard]] QString path(const WriteEntry &entry, char postfix) const;
 	[[nodiscard]] bool writeHeader(
 		const QString &basePath,
-		QFileDevice &file);
+		QFileDevice &file,
+		QIODevice::OpenMode mode = QIODevice::WriteOnly);
 
 	crl::weak_on_thread<WriteManager> _weak;
 	std::deque<WriteEntry> _scheduled;
@@ -77,24 +92,52 @@ WriteManager::WriteManager(crl::weak_on_thread<WriteManager> weak)
 }
 
 void WriteManager::write(WriteEntry &&entry) {
-	const auto i = ranges::find(_scheduled, entry.base, &WriteEntry::base);
-	if (i == end(_scheduled)) {
+	// Journal appends are never merged, they must keep their order.
+	const auto index = entry.append ? -1 : removeReplaced(entry);
+	if (index < 0) {
 		_scheduled.push_back(std::move(entry));
 	} else {
-		*i = std::move(entry);
+		_scheduled.insert(begin(_scheduled) + index, std::move(entry));
 	}
 	scheduleWrite();
 }
 
 void WriteManager::writeSync(WriteEntry &&entry) {
-	const auto i = ranges::find(_scheduled, entry.base, &WriteEntry::base);
-	if (i != end(_scheduled)) {
-		_scheduled.erase(i);
-	}
+	Expects(!entry.append);
+
+	removeReplaced(entry);
 	writeNow(std::move(entry));
 }
 
+// Removes the scheduled writes of the same file, a write that clears the
+// journal removes the scheduled appends as well, their records are already
+// in its data. Returns the index of the first removed write, the new one
+// takes its place, so it is committed before anything scheduled after.
+int WriteManager::removeReplaced(WriteEntry &entry) {
+	auto result = -1;
+	for (auto i = 0; i != int(_scheduled.size());) {
+		auto &scheduled = _scheduled[i];
+		if (scheduled.base != entry.base
+			|| (scheduled.append && !entry.clearJournal)) {
+			++i;
+			continue;
+		}
+		for (auto &callback : scheduled.whenWritten) {
+			entry.whenWritten.push_back(std::move(callback));
+		}
+		_scheduled.erase(begin(_scheduled) + i);
+		if (result < 0) {
+			result = i;
+		}
+	}
+	return result;
+}
+
 void WriteManager::writeNow(WriteEntry &&entry) {
+	if (entry.append) {
+		appendNow(std::move(entry));
+		return;
+	}
 	const auto path = [&](char postfix) {
 		return this->path(entry, postfix);
 	};
@@ -105,6 +148,12 @@ void WriteManager::writeNow(WriteEntry &&entry) {
 		file.write(entry.data);
 		file.write(entry.md5);
 	};
+	const auto written = [&] {
+		if (entry.clearJournal) {
+			QFile::remove(path('j'));
+		}
+		notifyWritten(entry);
+	};
 	const auto safe = path('s');
 	const auto simple = path('0');
 	const auto backup = path('1');
@@ -114,6 +163,7 @@ void WriteManager::writeNow(WriteEntry &&entry) {
 		if (save.commit()) {
 			QFile::remove(simple);
 			QFile::remove(backup);
+			written();
 			return;
 		}
 		LOG(("Storage Error: Could not commit '%1'.").arg(safe));
@@ -126,6 +176,7 @@ void WriteManager::writeNow(WriteEntry &&entry) {
 
 		QFile::remove(backup);
 		if (base::Platform::RenameWithOverwrite(simple, safe)) {
+			written();
 			return;
 		}
 		QFile::remove(safe);
@@ -135,6 +186,35 @@ void WriteManager::writeNow(WriteEntry &&entry) {
 	}
 }
 
+void WriteManager::appendNow(WriteEntry &&entry) {
+	const auto name = path(entry, 'j');
+	auto file = QFile(name);
+	if (file.open(QIODevice::Append)) {
+		if (!file.size()) {
+			file.write(TdfMagic, TdfMagicLen);
+			const auto version = qint32(AppVersion);
+			file.write((const char*)&version, sizeof(version));
+		}
+	} else if (!writeHeader(entry.basePath, file, QIODevice::Append)) {
+		LOG(("Storage Error: Could not open '%1' for appending.").arg(name));
+		return;
+	}
+	const auto size = quint32(entry.data.size());
+	if (file.write((const char*)&size, sizeof(size)) != sizeof(size)
+		|| file.write(entry.data) != entry.data.size()
+		|| !file.flush()) {
+		LOG(("Storage Error: Could not append to '%1'.").arg(name));
+		return;
+	}
+	notifyWritten(entry);
+}
+
+void WriteManager::notifyWritten(WriteEntry &entry) {
+	for (const auto &callback : base::take(entry.whenWritten)) {
+		callback();
+	}
+}
+
 void WriteManager::writeSyncAll() {
 	while (writeOneScheduledNow()) {
 	}
@@ -152,14 +232,17 @@ bool WriteManager::writeOneScheduledNow() {
 	return true;
 }
 
-bool WriteManager::writeHeader(const QString &basePath, QFileDevice &file) {
-	if (!file.open(QIODevice::WriteOnly)) {
+bool WriteManager::writeHeader(
+		const QString &basePath,
+		QFileDevice &file,
+		QIODevice::OpenMode mode) {
+	if (!file.open(mode)) {
 		const auto dir = QDir(basePath);
 		if (dir.exists()) {
 			return false;
 		} else if (!QDir().mkpath(dir.absolutePath())) {
 			return false;
-		} else if (!file.open(QIODevice::WriteOnly)) {
+		} else if (!file.open(mode)) {
 			return false;
 		}
 	}
@@ -288,6 +371,8 @@ void ClearKey(const FileKey &key, const QString &basePath) {
 	QFile::remove(name);
 	name[name.size() - 1] = 's';
 	QFile::remove(name);
+	name[name.size() - 1] = 'j';
+	QFile::remove(name);
 }
 
 bool CheckStreamStatus(QDataStream &stream) {
@@ -424,6 +509,14 @@ void FileWriteDescriptor::writeEncrypted(
 	writeData(PrepareEncrypted(data, key));
 }
 
+void FileWriteDescriptor::clearJournal() {
+	_clearJournal = true;
+}
+
+void FileWriteDescriptor::whenWritten(Fn<void()> callback) {
+	_whenWritten = std::move(callback);
+}
+
 void FileWriteDescriptor::finish() {
 	if (!_stream.device()) {
 		return;
@@ -441,7 +534,9 @@ void FileWriteDescriptor::finish() {
 		.basePath = _basePath,
 		.base = _base,
 		.data = _safeData,
-		.md5 = QByteArray((const char*)_md5.result(), 0x10)
+		.md5 = QByteArray((const char*)_md5.result(), 0x10),
+		.whenWritten = WhenWritten(base::take(_whenWritten)),
+		.clearJournal = _clearJournal,
 	};
 	if (_sync) {
 		Manager.writeSync(std::move(entry));
@@ -665,6 +760,74 @@ bool ReadEncryptedFile(
 	return ReadEncryptedFile(result, ToFilePart(fkey), basePath, key);
 }
 
+void AppendJournal(
+		const FileKey &fkey,
+		const QString &basePath,
+		EncryptedDescriptor &data,
+		const MTP::AuthKeyPtr &key,
+		Fn<void()> whenWritten) {
+	Manager.write(WriteEntry{
+		.basePath = basePath,
+		.base = basePath + ToFilePart(fkey),
+		.data = PrepareEncrypted(data, key),
+		.whenWritten = WhenWritten(std::move(whenWritten)),
+		.append = true,
+	});
+}
+
+ReadJournalResult ReadJournal(
+		const FileKey &fkey,
+		const QString &basePath,
+		const MTP::AuthKeyPtr &key,
+		Fn<void(QDataStream &stream)> callback) {
+	const auto name = ToFilePart(fkey) + 'j';
+	auto file = QFile(basePath + name);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return {};
+	}
+	const auto bytes = file.readAll();
+	const auto header = TdfMagicLen + int(sizeof(qint32));
+	auto result = ReadJournalResult{ .size = bytes.size(), .broken = true };
+	if (bytes.size() < header
+		|| memcmp(bytes.constData(), TdfMagic, TdfMagicLen)) {
+		DEBUG_LOG(("App Info: bad journal header in '%1'").arg(name));
+		return result;
+	}
+	auto version = qint32();
+	memcpy(&version, bytes.constData() + TdfMagicLen, sizeof(version));
+	if (version > AppVersion) {
+		DEBUG_LOG(("App Info: version too big %1 for '%2', my version %3"
+			).arg(version
+			).arg(name
+			).arg(AppVersion));
+		return result;
+	}
+	auto offset = header;
+	while (offset < bytes.size()) {
+		auto size = quint32();
+		if (bytes.size() - offset < int(sizeof(size))) {
+			break;
+		}
+		memcpy(&size, bytes.constData() + offset, sizeof(size));
+		offset += sizeof(size);
+		if (size > quint32(bytes.size() - offset)) {
+			break;
+		}
+		EncryptedDescriptor data;
+		if (!DecryptLocal(data, bytes.mid(offset, size), key)) {
+			break;
+		}
+		offset += size;
+		callback(data.stream);
+	}
+	if (offset < bytes.size()) {
+		DEBUG_LOG(("App Info: broken journal tail in '%1'").arg(name));
+	} else {
+		result.broken = false;
+	}
+	return result;
+}
+
 void Sync() {
 	Manager.sync();
 }
@@ -69,6 +69,12 @@ public:
 		EncryptedDescriptor &data,
 		const MTP::AuthKeyPtr &key);
 
+	// Remove the journal when this file is written.
+	void clearJournal();
+
+	// Called on the write thread when this file is written.
+	void whenWritten(Fn<void()> callback);
+
 private:
 	void init(const QString &name);
 	void finish();
@@ -80,7 +86,9 @@ private:
 	QString _base;
 	HashMd5 _md5;
 	int _fullSize = 0;
+	Fn<void()> _whenWritten;
 	bool _sync = false;
+	bool _clearJournal = false;
 
 };
 
@@ -106,6 +114,28 @@ bool ReadEncryptedFile(
 	const QString &basePath,
 	const MTP::AuthKeyPtr &key);
 
+// Journal of encrypted records appended next to the key file,
+// in the same order with the writes of the key file itself.
+// The whenWritten is called on the write thread when it is written.
+void AppendJournal(
+	const FileKey &fkey,
+	const QString &basePath,
+	EncryptedDescriptor &data,
+	const MTP::AuthKeyPtr &key,
+	Fn<void()> whenWritten = nullptr);
+
+struct ReadJournalResult {
+	int64 size = 0;
+	bool broken = false;
+};
+
+// Calls the callback for each record, stops at the first broken one.
+ReadJournalResult ReadJournal(
+	const FileKey &fkey,
+	const QString &basePath,
+	const MTP::AuthKeyPtr &key,
+	Fn<void(QDataStream &stream)> callback);
+
 void Sync();
 void Finish();
 
@@ -21,7 +21,7 @@ namespace {
 
 constexpr auto kKillSessionTimeout = 15 * crl::time(1000);
 constexpr auto kStartWaitedInSession = 4 * kDownloadPartSize;
-constexpr auto kMaxWaitedInSession = 16 * kDownloadPartSize;
+constexpr auto kMaxWaitedInSession = 2 * kMaxDownloadPartSize;
 constexpr auto kStartSessionsCount = 1;
 constexpr auto kMaxSessionsCount = 8;
 constexpr auto kMaxTrackedSessionRemoves = 64;
@@ -187,7 +187,9 @@ bool DownloadManagerMtproto::trySendNextPart(MTP::DcId dcId, Queue &queue) {
 				: kMaxWaitedInSession;
 		};
 		const auto j = ranges::min_element(sessions, ranges::less(), proj);
-		return (j->requested + kDownloadPartSize <= j->maxWaitedAmount)
+
+		// A large part may overflow the window, then we wait for it.
+		return (j->requested < j->maxWaitedAmount)
 			? (j - begin(sessions))
 			: -1;
 	}();
@@ -229,6 +231,7 @@ int DownloadManagerMtproto::changeRequestedAmount(
 void DownloadManagerMtproto::requestSucceeded(
 		MTP::DcId dcId,
 		int index,
+		int amount,
 		int amountAtRequestStart,
 		crl::time timeAtRequestStart) {
 	using namespace rpl::mappers;
@@ -239,14 +242,13 @@ void DownloadManagerMtproto::requestSucceeded(
 	Assert(index < dc.sessions.size());
 	auto &data = dc.sessions[index];
 	const auto overloaded = (timeAtRequestStart <= dc.lastSessionRemove)
-		|| (amountAtRequestStart > data.maxWaitedAmount);
-	const auto parts = amountAtRequestStart / kDownloadPartSize;
+		|| (amountAtRequestStart - amount >= data.maxWaitedAmount);
 	const auto duration = (crl::now() - timeAtRequestStart);
-	DEBUG_LOG(("Download (%1,%2) request done, duration: %3, parts: %4%5"
+	DEBUG_LOG(("Download (%1,%2) request done, duration: %3, bytes: %4%5"
 		).arg(dcId
 		).arg(index
 		).arg(duration
-		).arg(parts
+		).arg(amountAtRequestStart
 		).arg(overloaded ? " (overloaded)" : ""));
 	if (overloaded) {
 		return;
@@ -259,10 +261,10 @@ void DownloadManagerMtproto::requestSucceeded(
 		});
 		return;
 	}
-	if (amountAtRequestStart == data.maxWaitedAmount
+	if (amountAtRequestStart >= data.maxWaitedAmount
 		&& data.maxWaitedAmount < kMaxWaitedInSession) {
 		data.maxWaitedAmount = std::min(
-			data.maxWaitedAmount + kDownloadPartSize,
+			data.maxWaitedAmount + amount,
 			kMaxWaitedInSession);
 		DEBUG_LOG(("Download (%1,%2) increased max waited amount %3."
 			).arg(dcId
@@ -476,19 +478,44 @@ void DownloadMtprotoTask::refreshFileReferenceFrom(
 }
 
 void DownloadMtprotoTask::loadPart(int sessionIndex) {
-	makeRequest({ takeNextRequestOffset(), sessionIndex });
+	const auto offset = takeNextRequestOffset();
+	makeRequest({ offset, sessionIndex, partSize(offset) });
+}
+
+void DownloadMtprotoTask::allowLargeParts(int64 till) {
+	_largePartsTill = till;
+}
+
+int DownloadMtprotoTask::partSize(int64 offset) const {
+	if (_cdnDcId || offset >= _largePartsTill) {
+		return kDownloadPartSize;
+	}
+
+	// Parts should not cross 1 MB boundaries, so the offset is aligned to
+	// the part size, and we don't request much more than is left.
+	auto result = kMaxDownloadPartSize;
+	while (result > kDownloadPartSize
+		&& ((offset % result) || (offset + result / 2 >= _largePartsTill))) {
+		result /= 2;
+	}
+	return result;
 }
 
 void DownloadMtprotoTask::removeSession(int sessionIndex) {
 	struct Redirect {
 		mtpRequestId requestId = 0;
 		int64 offset = 0;
+		int limit = 0;
 	};
 	auto redirect = std::vector<Redirect>();
 	for (const auto &[requestId, requestData] : _sentRequests) {
 		if (requestData.sessionIndex == sessionIndex) {
 			redirect.reserve(_sentRequests.size());
-			redirect.push_back({ requestId, requestData.offset });
+			redirect.push_back({
+				requestId,
+				requestData.offset,
+				requestData.limit,
+			});
 		}
 	}
 	for (auto &[requestData, bytes] : _cdnUncheckedParts) {
@@ -498,13 +525,13 @@ void DownloadMtprotoTask::removeSession(int sessionIndex) {
 			requestData.sessionIndex = newIndex;
 		}
 	}
-	for (const auto &[requestId, offset] : redirect) {
+	for (const auto &[requestId, offset, limit] : redirect) {
 		const auto needMakeRequest = (requestId != _cdnHashesRequestId);
 		cancelRequest(requestId);
 		if (needMakeRequest) {
 			const auto newIndex = _owner->chooseSessionIndex(dcId());
 			Assert(newIndex < sessionIndex);
-			makeRequest({ offset, newIndex });
+			makeRequest({ offset, newIndex, limit });
 		}
 	}
 }
@@ -512,7 +539,7 @@ void DownloadMtprotoTask::removeSession(int sessionIndex) {
 mtpRequestId DownloadMtprotoTask::sendRequest(
 		const RequestData &requestData) {
 	const auto offset = requestData.offset;
-	const auto limit = Storage::kDownloadPartSize;
+	const auto limit = requestData.limit;
 	const auto shiftedDcId = MTP::downloadDcId(
 		_cdnDcId ? _cdnDcId : dcId(),
 		requestData.sessionIndex);
@@ -598,6 +625,19 @@ void DownloadMtprotoTask::makeRequest(const RequestData &requestData) {
 	placeSentRequest(sendRequest(requestData), requestData);
 }
 
+void DownloadMtprotoTask::makeCdnRequests(const RequestData &requestData) {
+	if (!_cdnDcId || requestData.limit <= kDownloadPartSize) {
+		makeRequest(requestData);
+		return;
+	}
+	const auto till = requestData.offset + requestData.limit;
+	for (auto offset = requestData.offset
+		; offset < till
+		; offset += kDownloadPartSize) {
+		makeRequest({ offset, requestData.sessionIndex, kDownloadPartSize });
+	}
+}
+
 void DownloadMtprotoTask::requestMoreCdnFileHashes() {
 	if (_cdnHashesRequestId || _cdnUncheckedParts.empty()) {
 		return;
@@ -807,7 +847,7 @@ void DownloadMtprotoTask::placeSentRequest(
 	const auto amount = _owner->changeRequestedAmount(
 		dcId(),
 		requestData.sessionIndex,
-		Storage::kDownloadPartSize);
+		requestData.limit);
 	const auto &[i, ok1] = _sentRequests.emplace(requestId, requestData);
 	const auto &[j, ok2] = _requestByOffset.emplace(
 		requestData.offset,
@@ -851,7 +891,7 @@ auto DownloadMtprotoTask::finishSentRequest(
 	_owner->changeRequestedAmount(
 		dcId(),
 		result.sessionIndex,
-		-Storage::kDownloadPartSize);
+		-result.limit);
 	_sentRequests.erase(it);
 	const auto ok = _requestByOffset.remove(result.offset);
 
@@ -863,6 +903,7 @@ auto DownloadMtprotoTask::finishSentRequest(
 		_owner->requestSucceeded(
 			dcId(),
 			result.sessionIndex,
+			result.limit,
 			result.requestedInSession,
 			result.sent);
 	}
@@ -1036,10 +1077,10 @@ void DownloadMtprotoTask::changeCDNParams(
 				FinishRequestReason::Redirect));
 		}
 		for (const auto &requestData : resendRequests) {
-			makeRequest(requestData);
+			makeCdnRequests(requestData);
 		}
 	}
-	makeRequest(requestData);
+	makeCdnRequests(requestData);
 }
 
 } // namespace Storage
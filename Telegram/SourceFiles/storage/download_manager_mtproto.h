@@ -19,11 +19,11 @@ class Error;
 
 namespace Storage {
 
-// Different part sizes are not supported for now :(
-// Because we start downloading with some part size
-// and then we get a CDN-redirect where we support only
-// fixed part size download for hash checking.
+// CDN file hashes are checked for fixed size parts, so after a
+// CDN-redirect all parts are requested with kDownloadPartSize.
+// Before that tasks that allow it request up to kMaxDownloadPartSize.
 constexpr auto kDownloadPartSize = 128 * 1024;
+constexpr auto kMaxDownloadPartSize = 1024 * 1024;
 
 class DownloadMtprotoTask;
 
@@ -52,6 +52,7 @@ public:
 	void requestSucceeded(
 		MTP::DcId dcId,
 		int index,
+		int amount,
 		int amountAtRequestStart,
 		crl::time timeAtRequestStart);
 	void checkSendNextAfterSuccess(MTP::DcId dcId);
@@ -85,9 +86,9 @@ private:
 	struct DcSessionBalanceData {
 		DcSessionBalanceData();
 
-		int requested = 0;
+		int requested = 0; // In bytes.
 		int successes = 0; // Since last timeout in this dc in any session.
-		int maxWaitedAmount = 0;
+		int maxWaitedAmount = 0; // In bytes.
 	};
 	struct DcBalanceData {
 		DcBalanceData();
@@ -172,6 +173,11 @@ protected:
 	void addToQueue(int priority = 0);
 	void removeFromQueue();
 
+	// Parts up to kMaxDownloadPartSize are requested below the 'till'
+	// offset while the file is not served by a CDN.
+	void allowLargeParts(int64 till);
+	[[nodiscard]] int partSize(int64 offset) const;
+
 	[[nodiscard]] ApiWrap &api() const {
 		return _owner->api();
 	}
@@ -180,6 +186,7 @@ private:
 	struct RequestData {
 		int64 offset = 0;
 		mutable int sessionIndex = 0;
+		int limit = kDownloadPartSize;
 		int requestedInSession = 0;
 		crl::time sent = 0;
 
@@ -212,6 +219,7 @@ private:
 
 	void cancelRequest(mtpRequestId requestId);
 	void makeRequest(const RequestData &requestData);
+	void makeCdnRequests(const RequestData &requestData);
 	void normalPartLoaded(
 		const MTPupload_File &result,
 		mtpRequestId requestId);
@@ -265,6 +273,7 @@ private:
 
 	const not_null<DownloadManagerMtproto*> _owner;
 	const MTP::DcId _dcId = 0;
+	int64 _largePartsTill = 0;
 
 	// _location can be changed with an updated file_reference.
 	Location _location;
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "api/api_send_progress.h"
 #include "storage/localimageloader.h"
 #include "storage/file_download.h"
+#include "storage/file_upload_reader.h"
 #include "data/data_document.h"
 #include "data/data_document_media.h"
 #include "data/data_photo.h"
@@ -63,6 +64,10 @@ constexpr auto kSlowRequestThreshold = 8 * crl::time(1000);
 // (it-s size + queued before size) >= 512kb.
 constexpr auto kAcceptAsFastIfTotalAtLeast = 512 * 1024;
 
+// Read ahead enough document parts to fill all the upload sessions.
+constexpr auto kDocumentReadAheadSize = kMaxUploadPerSession
+	* kMaxSessionsCount;
+
 [[nodiscard]] const char *ThumbnailFormat(const QString &mime) {
 	return Core::IsMimeSticker(mime) ? "WEBP" : "JPG";
 }
@@ -85,9 +90,7 @@ struct Uploader::Entry {
 	ushort partsSent = 0;
 	ushort partsWaiting = 0;
 
-	HashMd5 md5Hash;
-
-	std::unique_ptr<QFile> docFile;
+	std::unique_ptr<UploadPartsReader> docReader;
 	int64 docSize = 0;
 	int64 docSentSize = 0;
 	int docPartSize = 0;
@@ -381,34 +384,29 @@ void Uploader::stopSessions() {
 	}
 }
 
-QByteArray Uploader::readDocPart(not_null<Entry*> entry) {
-	const auto checked = [&](QByteArray result) {
-		if ((entry->file->type == SendMediaType::File
-			|| entry->file->type == SendMediaType::ThemeFile
-			|| entry->file->type == SendMediaType::Audio)
-			&& entry->docSize <= kUseBigFilesFrom) {
-			entry->md5Hash.feed(result.data(), result.size());
-		}
-		if (result.isEmpty()
-			|| (result.size() > entry->docPartSize)
-			|| ((result.size() < entry->docPartSize
-				&& entry->docPartsSent + 1 != entry->docPartsCount))) {
-			return QByteArray();
-		}
-		return result;
-	};
-	auto &content = entry->file->content;
-	if (!content.isEmpty()) {
-		const auto offset = entry->docPartsSent * entry->docPartSize;
-		return checked(content.mid(offset, entry->docPartSize));
-	} else if (!entry->docFile) {
-		const auto filepath = entry->file->filepath;
-		entry->docFile = std::make_unique<QFile>(filepath);
-		if (!entry->docFile->open(QIODevice::ReadOnly)) {
-			return QByteArray();
-		}
+std::optional<QByteArray> Uploader::readDocPart(not_null<Entry*> entry) {
+	if (!entry->docReader) {
+		entry->docReader = std::make_unique<UploadPartsReader>(
+			UploadPartsReader::Descriptor{
+				.filepath = entry->file->filepath,
+				.content = entry->file->content,
+				.partSize = entry->docPartSize,
+				.partsCount = entry->docPartsCount,
+				.window = kDocumentReadAheadSize / entry->docPartSize,
+				.md5 = (entry->docSize <= kUseBigFilesFrom),
+			},
+			[=] { crl::on_main(this, [=] { maybeSend(); }); });
 	}
-	return checked(entry->docFile->read(entry->docPartSize));
+	auto result = entry->docReader->take();
+	if (!result) {
+		return std::nullopt;
+	} else if (result->isEmpty()
+		|| (result->size() > entry->docPartSize)
+		|| ((result->size() < entry->docPartSize
+			&& entry->docPartsSent + 1 != entry->docPartsCount))) {
+		return QByteArray();
+	}
+	return result;
 }
 
 bool Uploader::canAddDcIndex() const {
@@ -529,11 +527,14 @@ auto Uploader::sendDocPart(not_null<Entry*> entry, uchar dcIndex)
 
 	Assert(entry->docPartsSent < entry->docPartsCount);
 
-	const auto partBytes = readDocPart(entry);
-	if (partBytes.isEmpty()) {
+	const auto read = readDocPart(entry);
+	if (!read) {
+		return SendResult::NotReady;
+	} else if (read->isEmpty()) {
 		failed(itemId);
 		return SendResult::Failed;
 	}
+	const auto partBytes = *read;
 	const auto part = entry->docPartsSent++;
 	++entry->docPartsWaiting;
 
@@ -615,7 +616,8 @@ void Uploader::maybeSend() {
 				return;
 			}
 			const auto result = sendPart(entry, dcIndex);
-			if (result == SendResult::DcIndexFull) {
+			if (result == SendResult::DcIndexFull
+				|| result == SendResult::NotReady) {
 				return;
 			} else if (result == SendResult::Success) {
 				break;
@@ -857,8 +859,9 @@ void Uploader::finishFront() {
 	} else if (entry.file->type == SendMediaType::File
 		|| entry.file->type == SendMediaType::ThemeFile
 		|| entry.file->type == SendMediaType::Audio) {
-		QByteArray docMd5(32, Qt::Uninitialized);
-		hashMd5Hex(entry.md5Hash.result(), docMd5.data());
+		const auto docMd5 = entry.docReader
+			? entry.docReader->md5()
+			: QByteArray();
 
 		const auto file = (entry.docSize > kUseBigFilesFrom)
 			? MTP_inputFileBig(
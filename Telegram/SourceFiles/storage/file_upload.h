@@ -107,6 +107,7 @@ private:
 		Success,
 		Failed,
 		DcIndexFull,
+		NotReady,
 	};
 
 	void maybeSend();
@@ -121,7 +122,8 @@ private:
 		-> SendResult;
 	[[nodiscard]] auto sendSlicedPart(not_null<Entry*> entry, uchar dcIndex)
 		-> SendResult;
-	[[nodiscard]] QByteArray readDocPart(not_null<Entry*> entry);
+	[[nodiscard]] std::optional<QByteArray> readDocPart(
+		not_null<Entry*> entry);
 	void removeDcIndex();
 
 	template <typename Prepared>
@@ -0,0 +1,141 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/file_upload_reader.h"
+
+namespace Storage {
+
+class UploadPartsReader::Implementation final {
+public:
+	Implementation(
+		crl::weak_on_queue<Implementation> weak,
+		Descriptor &&descriptor,
+		Fn<void(Part)> received);
+
+	void read(int count);
+
+private:
+	[[nodiscard]] QByteArray readPart();
+
+	const Descriptor _descriptor;
+	const Fn<void(Part)> _received;
+	QFile _file;
+	HashMd5 _md5;
+	int _partsRead = 0;
+	bool _failed = false;
+
+};
+
+UploadPartsReader::Implementation::Implementation(
+	crl::weak_on_queue<Implementation> weak,
+	Descriptor &&descriptor,
+	Fn<void(Part)> received)
+: _descriptor(std::move(descriptor))
+, _received(std::move(received)) {
+	if (_descriptor.content.isEmpty()) {
+		_file.setFileName(_descriptor.filepath);
+		_failed = !_file.open(QIODevice::ReadOnly);
+	}
+}
+
+QByteArray UploadPartsReader::Implementation::readPart() {
+	const auto &content = _descriptor.content;
+	if (!content.isEmpty()) {
+		const auto offset = _partsRead * int64(_descriptor.partSize);
+		return (offset < content.size())
+			? content.mid(offset, _descriptor.partSize)
+			: QByteArray();
+	}
+	return _file.read(_descriptor.partSize);
+}
+
+void UploadPartsReader::Implementation::read(int count) {
+	for (auto i = 0; i != count; ++i) {
+		if (_failed || _partsRead == _descriptor.partsCount) {
+			_received({});
+			continue;
+		}
+		auto bytes = readPart();
+		if (bytes.isEmpty()) {
+			_failed = true;
+			_received({});
+			continue;
+		}
+		if (_descriptor.md5) {
+			_md5.feed(bytes.constData(), bytes.size());
+		}
+		auto md5 = QByteArray();
+		if (++_partsRead == _descriptor.partsCount && _descriptor.md5) {
+			md5.resize(32);
+			hashMd5Hex(_md5.result(), md5.data());
+		}
+		_received({ std::move(bytes), std::move(md5) });
+	}
+}
+
+UploadPartsReader::UploadPartsReader(
+	Descriptor &&descriptor,
+	Fn<void()> ready)
+: _partsCount(descriptor.partsCount)
+, _window(std::max(descriptor.window, 1))
+, _ready(std::move(ready))
+, _wrapped(
+	std::move(descriptor),
+	[weak = base::make_weak(this)](Part part) {
+		crl::on_main(weak, [=, part = std::move(part)]() mutable {
+			weak->received(std::move(part));
+		});
+	}) {
+	requestParts();
+}
+
+UploadPartsReader::~UploadPartsReader() = default;
+
+void UploadPartsReader::requestParts() {
+	const auto inFlight = _partsRequested - _partsTaken;
+	const auto count = std::min(
+		_window - inFlight,
+		_partsCount - _partsRequested);
+	if (count <= 0) {
+		return;
+	}
+	_partsRequested += count;
+	_wrapped.with([=](Implementation &unwrapped) {
+		unwrapped.read(count);
+	});
+}
+
+void UploadPartsReader::received(Part &&part) {
+	if (part.bytes.isEmpty()) {
+		_failed = true;
+	} else if (!part.md5.isEmpty()) {
+		_md5 = std::move(part.md5);
+	}
+	_parts.push_back(std::move(part.bytes));
+	if (_parts.size() == 1) {
+		_ready();
+	}
+}
+
+std::optional<QByteArray> UploadPartsReader::take() {
+	if (_parts.empty()) {
+		return std::nullopt;
+	}
+	auto result = std::move(_parts.front());
+	_parts.pop_front();
+	++_partsTaken;
+	if (!_failed) {
+		requestParts();
+	}
+	return result;
+}
+
+QByteArray UploadPartsReader::md5() const {
+	return _md5;
+}
+
+} // namespace Storage
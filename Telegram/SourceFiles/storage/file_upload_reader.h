@@ -0,0 +1,62 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/weak_ptr.h"
+
+#include <crl/crl_object_on_queue.h>
+
+namespace Storage {
+
+// Reads the parts of a document being uploaded on a background queue
+// and feeds them to MD5 there, keeping up to 'window' next parts ready,
+// so that the main thread only takes the buffers that were already read.
+class UploadPartsReader final : public base::has_weak_ptr {
+public:
+	struct Descriptor {
+		QString filepath;
+		QByteArray content; // If not empty, filepath is ignored.
+		int partSize = 0;
+		int partsCount = 0;
+		int window = 0;
+		bool md5 = false;
+	};
+
+	UploadPartsReader(Descriptor &&descriptor, Fn<void()> ready);
+	~UploadPartsReader();
+
+	// std::nullopt - the next part is not read yet, empty - read error.
+	[[nodiscard]] std::optional<QByteArray> take();
+
+	// Hex MD5 of the whole content, available after the last part is read.
+	[[nodiscard]] QByteArray md5() const;
+
+private:
+	class Implementation;
+	struct Part {
+		QByteArray bytes;
+		QByteArray md5;
+	};
+
+	void received(Part &&part);
+	void requestParts();
+
+	const int _partsCount = 0;
+	const int _window = 0;
+	const Fn<void()> _ready;
+	crl::object_on_queue<Implementation> _wrapped;
+
+	std::deque<QByteArray> _parts;
+	QByteArray _md5;
+	int _partsRequested = 0;
+	int _partsTaken = 0;
+	bool _failed = false;
+
+};
+
+} // namespace Storage
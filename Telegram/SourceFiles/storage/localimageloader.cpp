@@ -14,9 +14,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_user.h"
 #include "core/file_utilities.h"
 #include "core/mime_type.h"
+#include "core/duration_histogram.h"
 #include "base/options.h"
 #include "base/unixtime.h"
 #include "base/random.h"
+#include "base/invoke_queued.h"
 #include "editor/scene/scene_item_sticker.h"
 #include "editor/scene/scene.h"
 #include "media/audio/media_audio.h"
@@ -48,8 +50,13 @@ constexpr auto kThumbnailQuality = 87;
 constexpr auto kThumbnailSize = 320;
 constexpr auto kPhotoUploadPartSize = 32 * 1024;
 constexpr auto kRecompressAfterBpp = 4;
+constexpr auto kTaskQueueMemoryBudget = 512 * int64(1024 * 1024);
 
 using Ui::ValidateThumbDimensions;
+using PrepareHistogram = Core::DurationHistogram<18>;
+
+PrepareHistogram PrepareWaited;
+PrepareHistogram PrepareTook;
 
 base::options::toggle SendLargePhotos({
 	.id = kOptionSendLargePhotos,
@@ -214,6 +221,23 @@ struct PreparedFileThumbnail {
 	return PhotoSideLimit(SendLargePhotosAtomic.load());
 }
 
+[[nodiscard]] int64 EstimatePrepareMemory(
+		SendMediaType type,
+		const QString &filepath,
+		const QByteArray &content) {
+	const auto size = content.isEmpty()
+		? (filepath.isEmpty() ? int64() : QFileInfo(filepath).size())
+		: int64(content.size());
+
+	// Photos are read in full and decoded, other files are only probed
+	// for a thumbnail, so at most one decoded frame is kept in memory.
+	const auto side = int64(PhotoSideLimit(SendLargePhotosAtomic.load()));
+	const auto decoded = side * side * 4;
+	return (type == SendMediaType::Photo)
+		? (size + 2 * decoded)
+		: std::min(size, decoded);
+}
+
 } // namespace
 
 const char kOptionSendLargePhotos[] = "send-large-photos";
@@ -222,7 +246,15 @@ int PhotoSideLimit() {
 	return PhotoSideLimit(SendLargePhotos.value());
 }
 
-TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
+QString FilePrepareStats() {
+	return u"waited in queue: "_q
+		+ PrepareHistogram::Serialize(PrepareWaited.snapshot())
+		+ u"\n  prepared: "_q
+		+ PrepareHistogram::Serialize(PrepareTook.snapshot());
+}
+
+TaskQueue::TaskQueue(crl::time stopTimeoutMs, int maxThreads)
+: _maxThreads(std::max(maxThreads, 1)) {
 	if (stopTimeoutMs > 0) {
 		_stopTimer = new QTimer(this);
 		connect(_stopTimer, SIGNAL(timeout()), this, SLOT(stop()));
@@ -238,7 +270,7 @@ TaskId TaskQueue::addTask(std::unique_ptr<Task> &&task) {
 		_tasksToProcess.push_back(std::move(task));
 	}
 
-	wakeThread();
+	wakeThreads();
 
 	return result;
 }
@@ -251,44 +283,53 @@ void TaskQueue::addTasks(std::vector<std::unique_ptr<Task>> &&tasks) {
 		}
 	}
 
-	wakeThread();
+	wakeThreads();
 }
 
-void TaskQueue::wakeThread() {
-	if (!_thread) {
-		_thread = new QThread();
-
-		_worker = new TaskQueueWorker(this);
-		_worker->moveToThread(_thread);
-
-		connect(this, SIGNAL(taskAdded()), _worker, SLOT(onTaskAdded()));
-		connect(_worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
-
-		_thread->start();
+void TaskQueue::wakeThreads() {
+	if (_threads.empty()) {
+		const auto count = std::clamp(
+			QThread::idealThreadCount(),
+			1,
+			_maxThreads);
+		for (auto i = 0; i != count; ++i) {
+			const auto thread = new QThread();
+			const auto worker = new TaskQueueWorker(this);
+			worker->moveToThread(thread);
+
+			connect(this, SIGNAL(taskAdded()), worker, SLOT(onTaskAdded()));
+			connect(worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
+
+			thread->start();
+			_threads.push_back(thread);
+			_workers.push_back(worker);
+		}
 	}
 	if (_stopTimer) _stopTimer->stop();
 	taskAdded();
 }
 
 void TaskQueue::cancelTask(TaskId id) {
-	const auto removeFrom = [&](std::deque<std::unique_ptr<Task>> &queue) {
+	{
+		QMutexLocker lock(&_tasksToProcessMutex);
 		const auto proj = [](const std::unique_ptr<Task> &task) {
 			return task->id();
 		};
-		auto i = ranges::find(queue, id, proj);
-		if (i != queue.end()) {
-			queue.erase(i);
-		}
-	};
-	{
-		QMutexLocker lock(&_tasksToProcessMutex);
-		removeFrom(_tasksToProcess);
-		if (_taskInProcessId == id) {
-			_taskInProcessId = TaskId();
+		auto i = ranges::find(_tasksToProcess, id, proj);
+		if (i != _tasksToProcess.end()) {
+			_tasksToProcess.erase(i);
 		}
 	}
 	QMutexLocker lock(&_tasksToFinishMutex);
-	removeFrom(_tasksToFinish);
+	const auto i = ranges::find(_tasksToFinish, id, &Finishing::id);
+	if (i == _tasksToFinish.end()) {
+		return;
+	} else if (i == _tasksToFinish.begin()) {
+		// Tasks after this one may be waiting only for it to finish.
+		InvokeQueued(this, [=] { onTaskProcessed(); });
+	}
+	// If the task is being processed, the worker will destroy it.
+	_tasksToFinish.erase(i);
 }
 
 void TaskQueue::onTaskProcessed() {
@@ -296,8 +337,10 @@ void TaskQueue::onTaskProcessed() {
 		auto task = std::unique_ptr<Task>();
 		{
 			QMutexLocker lock(&_tasksToFinishMutex);
-			if (_tasksToFinish.empty()) break;
-			task = std::move(_tasksToFinish.front());
+			if (_tasksToFinish.empty() || !_tasksToFinish.front().task) {
+				break;
+			}
+			task = std::move(_tasksToFinish.front().task);
 			_tasksToFinish.pop_front();
 		}
 		task->finish();
@@ -305,24 +348,34 @@ void TaskQueue::onTaskProcessed() {
 
 	if (_stopTimer) {
 		QMutexLocker lock(&_tasksToProcessMutex);
-		if (_tasksToProcess.empty() && !_taskInProcessId) {
+		if (_tasksToProcess.empty() && !_tasksInProcess) {
 			_stopTimer->start();
 		}
 	}
 }
 
 void TaskQueue::stop() {
-	if (_thread) {
-		_thread->requestInterruption();
-		_thread->quit();
+	if (!_threads.empty()) {
+		for (const auto thread : _threads) {
+			thread->requestInterruption();
+			thread->quit();
+		}
 		DEBUG_LOG(("Waiting for taskThread to finish"));
-		_thread->wait();
-		delete base::take(_worker);
-		delete base::take(_thread);
+		for (const auto thread : _threads) {
+			thread->wait();
+		}
+		for (const auto worker : base::take(_workers)) {
+			delete worker;
+		}
+		for (const auto thread : base::take(_threads)) {
+			delete thread;
+		}
 	}
 	_tasksToProcess.clear();
 	_tasksToFinish.clear();
-	_taskInProcessId = TaskId();
+	_tasksInProcess = 0;
+	_memoryInProcess = 0;
+	_waitingForMemory = false;
 }
 
 TaskQueue::~TaskQueue() {
@@ -337,33 +390,63 @@ void TaskQueueWorker::onTaskAdded() {
 	bool someTasksLeft = false;
 	do {
 		auto task = std::unique_ptr<Task>();
+		auto memoryCost = int64();
 		{
 			QMutexLocker lock(&_queue->_tasksToProcessMutex);
 			if (!_queue->_tasksToProcess.empty()) {
-				task = std::move(_queue->_tasksToProcess.front());
-				_queue->_tasksToProcess.pop_front();
-				_queue->_taskInProcessId = task->id();
-			}
-		}
-
-		if (task) {
-			task->process();
-			bool emitTaskProcessed = false;
-			{
-				QMutexLocker lockToProcess(&_queue->_tasksToProcessMutex);
-				if (_queue->_taskInProcessId == task->id()) {
-					_queue->_taskInProcessId = TaskId();
-					someTasksLeft = !_queue->_tasksToProcess.empty();
+				const auto cost = _queue->_tasksToProcess.front()->memoryCost();
+				if (!_queue->_tasksInProcess
+					|| (_queue->_memoryInProcess + cost
+						<= kTaskQueueMemoryBudget)) {
+					task = std::move(_queue->_tasksToProcess.front());
+					_queue->_tasksToProcess.pop_front();
+					++_queue->_tasksInProcess;
+					_queue->_memoryInProcess += cost;
+					memoryCost = cost;
 
 					QMutexLocker lockToFinish(&_queue->_tasksToFinishMutex);
-					emitTaskProcessed = _queue->_tasksToFinish.empty();
-					_queue->_tasksToFinish.push_back(std::move(task));
+					_queue->_tasksToFinish.push_back({ .id = task->id() });
+				} else {
+					_queue->_waitingForMemory = true;
 				}
 			}
-			if (emitTaskProcessed) {
-				taskProcessed();
+		}
+		if (!task) {
+			break;
+		}
+
+		task->process();
+		bool emitTaskProcessed = false;
+		bool wakeWorkers = false;
+		{
+			QMutexLocker lockToProcess(&_queue->_tasksToProcessMutex);
+			--_queue->_tasksInProcess;
+			_queue->_memoryInProcess -= memoryCost;
+			wakeWorkers = base::take(_queue->_waitingForMemory);
+			someTasksLeft = !_queue->_tasksToProcess.empty();
+
+			QMutexLocker lockToFinish(&_queue->_tasksToFinishMutex);
+			auto &list = _queue->_tasksToFinish;
+			const auto i = ranges::find(
+				list,
+				task->id(),
+				&TaskQueue::Finishing::id);
+			if (i != list.end()) {
+				// Only the first one unblocks finishing, others wait for it.
+				emitTaskProcessed = (i == list.begin());
+				i->task = std::move(task);
 			}
 		}
+		if (emitTaskProcessed) {
+			taskProcessed();
+		}
+		if (wakeWorkers) {
+			// Tasks waiting for the memory budget may fit now. This worker
+			// just continues, the others are woken up in their threads.
+			someTasksLeft = true;
+			const auto queue = _queue;
+			InvokeQueued(queue, [=] { queue->taskAdded(); });
+		}
 		QCoreApplication::processEvents();
 	} while (someTasksLeft && !thread()->isInterruptionRequested());
 
@@ -484,13 +567,15 @@ FileLoadTask::FileLoadTask(
 , _information(std::move(information))
 , _type(type)
 , _caption(caption)
-, _spoiler(spoiler) {
+, _spoiler(spoiler)
+, _created(crl::now()) {
 	Expects(to.options.scheduled
 		|| to.options.shortcutId
 		|| !to.replaceMediaOf
 		|| IsServerMsgId(to.replaceMediaOf));
 
 	SendLargePhotosAtomic = SendLargePhotos.value();
+	_memoryCost = EstimatePrepareMemory(_type, _filepath, _content);
 }
 
 FileLoadTask::FileLoadTask(
@@ -508,7 +593,9 @@ FileLoadTask::FileLoadTask(
 , _duration(duration)
 , _waveform(waveform)
 , _type(SendMediaType::Audio)
-, _caption(caption) {
+, _caption(caption)
+, _memoryCost(voice.size())
+, _created(crl::now()) {
 }
 
 FileLoadTask::~FileLoadTask() = default;
@@ -678,7 +765,23 @@ bool FileLoadTask::FillImageInformation(
 	return true;
 }
 
+int64 FileLoadTask::memoryCost() const {
+	return _memoryCost;
+}
+
 void FileLoadTask::process(Args &&args) {
+	const auto started = crl::now();
+	const auto guard = gsl::finally([&] {
+		const auto took = crl::now() - started;
+		PrepareWaited.add(started - _created);
+		PrepareTook.add(took);
+		DEBUG_LOG(("Prepare Info: file '%1' prepared in %2ms, "
+			"waited in queue for %3ms."
+			).arg(_filepath.isEmpty() ? u"(memory)"_q : _filepath
+			).arg(took
+			).arg(started - _created));
+	});
+
 	_result = MakePreparedFile({
 		.taskId = id(),
 		.id = _id,
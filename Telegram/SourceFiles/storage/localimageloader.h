@@ -28,6 +28,9 @@ extern const char kOptionSendLargePhotos[];
 
 [[nodiscard]] int PhotoSideLimit();
 
+// How long the files waited in the queue and were prepared for sending.
+[[nodiscard]] QString FilePrepareStats();
+
 enum class SendMediaType {
 	Photo,
 	Audio,
@@ -45,6 +48,11 @@ public:
 	virtual void finish() = 0; // is executed in the same as TaskQueue thread
 	virtual ~Task() = default;
 
+	// Approximate memory required by process(), is read in any thread.
+	[[nodiscard]] virtual int64 memoryCost() const {
+		return 0;
+	}
+
 	TaskId id() const {
 		return static_cast<TaskId>(const_cast<Task*>(this));
 	}
@@ -52,11 +60,17 @@ public:
 };
 
 class TaskQueueWorker;
+
+// Tasks are processed in up to maxThreads threads, as long as the sum of
+// their memory costs fits in the budget, but they are always taken for
+// processing and finished in the order they were added.
 class TaskQueue : public QObject {
 	Q_OBJECT
 
 public:
-	explicit TaskQueue(crl::time stopTimeoutMs = 0); // <= 0 - never stop worker
+	explicit TaskQueue(
+		crl::time stopTimeoutMs = 0, // <= 0 - never stop workers
+		int maxThreads = 1);
 
 	TaskId addTask(std::unique_ptr<Task> &&task);
 	void addTasks(std::vector<std::unique_ptr<Task>> &&tasks);
@@ -74,15 +88,23 @@ public Q_SLOTS:
 private:
 	friend class TaskQueueWorker;
 
-	void wakeThread();
+	struct Finishing {
+		TaskId id = kEmptyTaskId;
+		std::unique_ptr<Task> task; // nullptr while being processed.
+	};
+
+	void wakeThreads();
 
 	std::deque<std::unique_ptr<Task>> _tasksToProcess;
-	std::deque<std::unique_ptr<Task>> _tasksToFinish;
-	TaskId _taskInProcessId = TaskId();
+	std::deque<Finishing> _tasksToFinish;
+	int _tasksInProcess = 0;
+	int64 _memoryInProcess = 0;
+	bool _waitingForMemory = false;
 	QMutex _tasksToProcessMutex, _tasksToFinishMutex;
-	QThread *_thread = nullptr;
-	TaskQueueWorker *_worker = nullptr;
+	std::vector<QThread*> _threads;
+	std::vector<TaskQueueWorker*> _workers;
 	QTimer *_stopTimer = nullptr;
+	int _maxThreads = 1;
 
 };
 
@@ -248,6 +270,7 @@ public:
 		process({});
 	}
 	void finish() override;
+	int64 memoryCost() const override;
 
 	FilePrepareResult *peekResult() const;
 
@@ -284,6 +307,8 @@ private:
 	SendMediaType _type;
 	TextWithTags _caption;
 	bool _spoiler = false;
+	int64 _memoryCost = 0;
+	crl::time _created = 0;
 
 	std::shared_ptr<FilePrepareResult> _result;
 
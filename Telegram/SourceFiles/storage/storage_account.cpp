@@ -46,7 +46,11 @@ using namespace details;
 using Database = Cache::Database;
 
 constexpr auto kDelayedWriteTimeout = crl::time(1000);
+constexpr auto kMessagesStoreSizeLimit = int64(256) * 1024 * 1024;
+constexpr auto kMessagesStoreTimeLimit = 30 * 86400;
 constexpr auto kWriteSearchSuggestionsDelay = 5 * crl::time(1000);
+constexpr auto kLocationsJournalMinCompact = int64(256) * 1024;
+constexpr auto kDraftsJournalMinCompact = int64(64) * 1024;
 
 constexpr auto kStickersVersionTag = quint32(-1);
 constexpr auto kStickersSerializeVersion = 4;
@@ -94,8 +98,73 @@ enum { // Local Storage Keys
 	lskCustomEmojiKeys = 0x17, // no data
 	lskSearchSuggestions = 0x18, // no data
 	lskWebviewTokens = 0x19, // data: QByteArray bots, QByteArray other
+	lskDraftsStore = 0x1a, // no data
 };
 
+enum class LocationsRecord : quint32 {
+	Add = 0x01,
+	Remove = 0x02, // All locations of the key if the name is empty.
+	Alias = 0x03,
+	Downloads = 0x04,
+};
+
+template <typename Write>
+[[nodiscard]] QByteArray SerializeLocationsRecord(
+		LocationsRecord type,
+		Write &&write) {
+	auto result = QByteArray();
+	auto stream = QDataStream(&result, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream << quint32(type);
+	write(stream);
+	stream.device()->close();
+	return result;
+}
+
+[[nodiscard]] QByteArray SerializeLocationAdd(
+		MediaKey key,
+		const Core::FileLocation &location) {
+	const auto write = [&](QDataStream &stream) {
+		stream
+			<< quint64(key.first)
+			<< quint64(key.second)
+			<< location.name()
+			<< location.bookmark()
+			<< location.modified
+			<< quint32(location.size);
+	};
+	return SerializeLocationsRecord(LocationsRecord::Add, write);
+}
+
+[[nodiscard]] QByteArray SerializeLocationRemove(
+		MediaKey key,
+		const QString &name) {
+	const auto write = [&](QDataStream &stream) {
+		stream << quint64(key.first) << quint64(key.second) << name;
+	};
+	return SerializeLocationsRecord(LocationsRecord::Remove, write);
+}
+
+[[nodiscard]] QByteArray SerializeLocationAlias(
+		MediaKey key,
+		MediaKey target) {
+	const auto write = [&](QDataStream &stream) {
+		stream
+			<< quint64(key.first)
+			<< quint64(key.second)
+			<< quint64(target.first)
+			<< quint64(target.second);
+	};
+	return SerializeLocationsRecord(LocationsRecord::Alias, write);
+}
+
+[[nodiscard]] QByteArray SerializeDownloads(const QByteArray &serialized) {
+	const auto write = [&](QDataStream &stream) {
+		stream << serialized;
+	};
+	return SerializeLocationsRecord(LocationsRecord::Downloads, write);
+}
+
 auto EmptyMessageDraftSources()
 -> const base::flat_map<Data::DraftKey, MessageDraftSource> & {
 	static const auto result = base::flat_map<
@@ -130,6 +199,16 @@ auto EmptyMessageDraftSources()
 	return cWorkingDir() + u"tdata/tdld/"_q;
 }
 
+// Stored payloads are parsed by the same code that reads the files.
+void PrepareStoredRead(FileReadDescriptor &result, const QByteArray &data) {
+	result.version = AppVersion;
+	result.data = data;
+	result.buffer.setBuffer(&result.data);
+	result.buffer.open(QIODevice::ReadOnly);
+	result.stream.setDevice(&result.buffer);
+	result.stream.setVersion(QDataStream::Qt_5_1);
+}
+
 } // namespace
 
 Account::Account(not_null<Main::Account*> owner, const QString &dataName)
@@ -145,12 +224,16 @@ Account::Account(not_null<Main::Account*> owner, const QString &dataName)
 , _cacheBigFileTotalTimeLimit(Database::Settings().totalTimeLimit)
 , _writeMapTimer([=] { writeMap(); })
 , _writeLocationsTimer([=] { writeLocations(); })
+, _writeDraftsTimer([=] { writeDraftsStore(); })
 , _writeSearchSuggestionsTimer([=] { writeSearchSuggestions(); }) {
 }
 
 Account::~Account() {
 	Expects(!_writeSearchSuggestionsTimer.isActive());
 
+	if (_localKey && _writeDraftsTimer.isActive()) {
+		writeDraftsStore();
+	}
 	if (_localKey && _mapChanged) {
 		writeMap();
 	}
@@ -199,6 +282,7 @@ void Account::clearLegacyFiles() {
 
 base::flat_set<QString> Account::collectGoodNames() const {
 	const auto keys = {
+		_draftsStoreKey,
 		_locationsKey,
 		_settingsKey,
 		_installedStickersKey,
@@ -237,6 +321,8 @@ base::flat_set<QString> Account::collectGoodNames() const {
 		result.emplace(name);
 		name[name.size() - 1] = 's';
 		result.emplace(name);
+		name[name.size() - 1] = 'j';
+		result.emplace(name);
 	};
 	for (const auto &[key, value] : _draftsMap) {
 		push(value);
@@ -297,6 +383,7 @@ Account::ReadMapResult Account::readMapWith(
 	base::flat_map<PeerId, FileKey> draftsMap;
 	base::flat_map<PeerId, FileKey> draftCursorsMap;
 	base::flat_map<PeerId, bool> draftsNotReadMap;
+	quint64 draftsStoreKey = 0;
 	quint64 locationsKey = 0, reportSpamStatusesKey = 0, trustedBotsKey = 0;
 	quint64 recentStickersKeyOld = 0;
 	quint64 installedStickersKey = 0, featuredStickersKey = 0, recentStickersKey = 0, favedStickersKey = 0, archivedStickersKey = 0;
@@ -337,6 +424,9 @@ Account::ReadMapResult Account::readMapWith(
 				draftCursorsMap.emplace(peerId, key);
 			}
 		} break;
+		case lskDraftsStore: {
+			map.stream >> draftsStoreKey;
+		} break;
 		case lskLegacyImages:
 		case lskLegacyStickerImages:
 		case lskLegacyAudios: {
@@ -434,6 +524,7 @@ Account::ReadMapResult Account::readMapWith(
 	_draftsMap = draftsMap;
 	_draftCursorsMap = draftCursorsMap;
 	_draftsNotReadMap = draftsNotReadMap;
+	_draftsStoreKey = draftsStoreKey;
 
 	_locationsKey = locationsKey;
 	_trustedBotsKey = trustedBotsKey;
@@ -466,9 +557,6 @@ Account::ReadMapResult Account::readMapWith(
 		_mapChanged = false;
 	}
 
-	if (_locationsKey) {
-		readLocations();
-	}
 	if (_legacyBackgroundKeyDay || _legacyBackgroundKeyNight) {
 		Local::moveLegacyBackground(
 			_basePath,
@@ -546,6 +634,7 @@ void Account::writeMap() {
 	if (!self.isEmpty()) mapSize += sizeof(quint32) + Serialize::bytearraySize(self);
 	if (!_draftsMap.empty()) mapSize += sizeof(quint32) * 2 + _draftsMap.size() * sizeof(quint64) * 2;
 	if (!_draftCursorsMap.empty()) mapSize += sizeof(quint32) * 2 + _draftCursorsMap.size() * sizeof(quint64) * 2;
+	if (_draftsStoreKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_locationsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_trustedBotsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_recentStickersKeyOld) mapSize += sizeof(quint32) + sizeof(quint64);
@@ -587,6 +676,9 @@ void Account::writeMap() {
 			mapData.stream << quint64(value) << SerializePeerId(key);
 		}
 	}
+	if (_draftsStoreKey) {
+		mapData.stream << quint32(lskDraftsStore) << quint64(_draftsStoreKey);
+	}
 	if (_locationsKey) {
 		mapData.stream << quint32(lskLocations) << quint64(_locationsKey);
 	}
@@ -647,11 +739,19 @@ void Account::writeMap() {
 
 void Account::reset() {
 	_writeSearchSuggestionsTimer.cancel();
+	_writeDraftsTimer.cancel();
 
 	auto names = collectGoodNames();
 	_draftsMap.clear();
 	_draftCursorsMap.clear();
 	_draftsNotReadMap.clear();
+	_draftsStore.clear();
+	_draftsStoreChanged.clear();
+	_draftsLegacyKeys.clear();
+	_draftsSnapshotSize = _draftsJournalSize = 0;
+	_draftsGeneration = 0;
+	_draftsStoreKey = 0;
+	_draftsStoreRead = _draftsCompact = false;
 	_locationsKey = _trustedBotsKey = 0;
 	_recentStickersKeyOld = 0;
 	_installedStickersKey = 0;
@@ -675,6 +775,10 @@ void Account::reset() {
 	_fileLocationAliases.clear();
 	_downloadsSerialize = nullptr;
 	_downloadsSerialized = QByteArray();
+	_locationsRecords.clear();
+	_locationsSnapshotSize = _locationsJournalSize = 0;
+	_locationsGeneration = 0;
+	_locationsRead = _locationsCompact = false;
 	_cacheTotalSizeLimit = Database::Settings().totalSizeLimit;
 	_cacheTotalTimeLimit = Database::Settings().totalTimeLimit;
 	_cacheBigFileTotalSizeLimit = Database::Settings().totalSizeLimit;
@@ -727,76 +831,141 @@ void Account::writeLocations() {
 		return;
 	}
 	_locationsChanged = false;
+	ensureLocationsRead();
 
 	if (_downloadsSerialize) {
 		if (auto serialized = _downloadsSerialize()) {
-			_downloadsSerialized = std::move(*serialized);
+			if (*serialized != _downloadsSerialized) {
+				_downloadsSerialized = std::move(*serialized);
+				pushLocationsRecord(SerializeDownloads(_downloadsSerialized));
+			}
 		}
 	}
 	if (_fileLocations.isEmpty() && _downloadsSerialized.isEmpty()) {
+		_locationsRecords.clear();
+		_locationsSnapshotSize = _locationsJournalSize = 0;
+		_locationsCompact = false;
 		if (_locationsKey) {
 			ClearKey(_locationsKey, _basePath);
 			_locationsKey = 0;
 			writeMapDelayed();
 		}
-	} else {
-		if (!_locationsKey) {
-			_locationsKey = GenerateKey(_basePath);
-			writeMapQueued();
-		}
-		quint32 size = 0;
-		for (auto i = _fileLocations.cbegin(), e = _fileLocations.cend(); i != e; ++i) {
-			// location + type + namelen + name
-			size += sizeof(quint64) * 2 + sizeof(quint32) + Serialize::stringSize(i.value().name());
-			if (AppVersion > 9013) {
-				// bookmark
-				size += Serialize::bytearraySize(i.value().bookmark());
-			}
-			// date + size
-			size += Serialize::dateTimeSize() + sizeof(quint32);
-		}
+		return;
+	}
+	auto recordsSize = int64();
+	for (const auto &record : _locationsRecords) {
+		recordsSize += record.size();
+	}
+
+	// Rewrite everything once the journal outgrows the snapshot,
+	// so each change is written a constant amount of times on average.
+	const auto compactAfter = std::max(
+		kLocationsJournalMinCompact,
+		_locationsSnapshotSize);
+	if (!_locationsKey
+		|| _locationsCompact
+		|| _locationsJournalSize + recordsSize > compactAfter) {
+		writeLocationsSnapshot();
+	} else if (!_locationsRecords.empty()) {
+		writeLocationsJournal();
+	}
+}
 
-		//end mark
-		size += sizeof(quint64) * 2 + sizeof(quint32) + Serialize::stringSize(QString());
+void Account::writeLocationsSnapshot() {
+	_locationsRecords.clear();
+	_locationsJournalSize = 0;
+	_locationsCompact = false;
+	if (!_locationsKey) {
+		_locationsKey = GenerateKey(_basePath);
+		writeMapQueued();
+	}
+	quint32 size = 0;
+	for (auto i = _fileLocations.cbegin(), e = _fileLocations.cend(); i != e; ++i) {
+		// location + type + namelen + name
+		size += sizeof(quint64) * 2 + sizeof(quint32) + Serialize::stringSize(i.value().name());
 		if (AppVersion > 9013) {
-			size += Serialize::bytearraySize(QByteArray());
+			// bookmark
+			size += Serialize::bytearraySize(i.value().bookmark());
 		}
+		// date + size
 		size += Serialize::dateTimeSize() + sizeof(quint32);
+	}
 
-		size += sizeof(quint32); // aliases count
-		for (auto i = _fileLocationAliases.cbegin(), e = _fileLocationAliases.cend(); i != e; ++i) {
-			// alias + location
-			size += sizeof(quint64) * 2 + sizeof(quint64) * 2;
-		}
+	//end mark
+	size += sizeof(quint64) * 2 + sizeof(quint32) + Serialize::stringSize(QString());
+	if (AppVersion > 9013) {
+		size += Serialize::bytearraySize(QByteArray());
+	}
+	size += Serialize::dateTimeSize() + sizeof(quint32);
 
-		size += sizeof(quint32); // legacy webLocationsCount
-		size += Serialize::bytearraySize(_downloadsSerialized);
+	size += sizeof(quint32); // aliases count
+	for (auto i = _fileLocationAliases.cbegin(), e = _fileLocationAliases.cend(); i != e; ++i) {
+		// alias + location
+		size += sizeof(quint64) * 2 + sizeof(quint64) * 2;
+	}
 
-		EncryptedDescriptor data(size);
-		auto legacyTypeField = 0;
-		for (auto i = _fileLocations.cbegin(); i != _fileLocations.cend(); ++i) {
-			data.stream << quint64(i.key().first) << quint64(i.key().second) << quint32(legacyTypeField) << i.value().name();
-			if (AppVersion > 9013) {
-				data.stream << i.value().bookmark();
-			}
-			data.stream << i.value().modified << quint32(i.value().size);
-		}
+	size += sizeof(quint32); // legacy webLocationsCount
+	size += Serialize::bytearraySize(_downloadsSerialized);
+	size += sizeof(quint64); // generation
 
-		data.stream << quint64(0) << quint64(0) << quint32(0) << QString();
+	EncryptedDescriptor data(size);
+	auto legacyTypeField = 0;
+	for (auto i = _fileLocations.cbegin(); i != _fileLocations.cend(); ++i) {
+		data.stream << quint64(i.key().first) << quint64(i.key().second) << quint32(legacyTypeField) << i.value().name();
 		if (AppVersion > 9013) {
-			data.stream << QByteArray();
+			data.stream << i.value().bookmark();
 		}
-		data.stream << QDateTime::currentDateTime() << quint32(0);
+		data.stream << i.value().modified << quint32(i.value().size);
+	}
 
-		data.stream << quint32(_fileLocationAliases.size());
-		for (auto i = _fileLocationAliases.cbegin(), e = _fileLocationAliases.cend(); i != e; ++i) {
-			data.stream << quint64(i.key().first) << quint64(i.key().second) << quint64(i.value().first) << quint64(i.value().second);
-		}
+	data.stream << quint64(0) << quint64(0) << quint32(0) << QString();
+	if (AppVersion > 9013) {
+		data.stream << QByteArray();
+	}
+	data.stream << QDateTime::currentDateTime() << quint32(0);
 
-		data.stream << quint32(0) << _downloadsSerialized;
+	data.stream << quint32(_fileLocationAliases.size());
+	for (auto i = _fileLocationAliases.cbegin(), e = _fileLocationAliases.cend(); i != e; ++i) {
+		data.stream << quint64(i.key().first) << quint64(i.key().second) << quint64(i.value().first) << quint64(i.value().second);
+	}
 
-		FileWriteDescriptor file(_locationsKey, _basePath);
-		file.writeEncrypted(data, _localKey);
+	// Journal records of the previous generations are skipped.
+	data.stream
+		<< quint32(0)
+		<< _downloadsSerialized
+		<< quint64(++_locationsGeneration);
+
+	FileWriteDescriptor file(_locationsKey, _basePath);
+	file.writeEncrypted(data, _localKey);
+	file.clearJournal();
+
+	_locationsSnapshotSize = data.data.size();
+}
+
+void Account::writeLocationsJournal() {
+	Expects(_locationsKey != 0);
+
+	auto size = quint32(sizeof(quint64) + sizeof(quint32));
+	for (const auto &record : _locationsRecords) {
+		size += record.size();
+	}
+	EncryptedDescriptor data(size);
+	data.stream
+		<< quint64(_locationsGeneration)
+		<< quint32(_locationsRecords.size());
+	for (const auto &record : base::take(_locationsRecords)) {
+		data.stream.writeRawData(record.constData(), record.size());
+	}
+	AppendJournal(_locationsKey, _basePath, data, _localKey);
+
+	// Record size, message key and the padded encrypted data.
+	_locationsJournalSize += sizeof(quint32) + 0x10 + data.data.size();
+}
+
+void Account::pushLocationsRecord(QByteArray &&record) {
+	// Without the key everything will be written in the snapshot.
+	if (_locationsKey) {
+		_locationsRecords.push_back(std::move(record));
 	}
 }
 
@@ -812,6 +981,16 @@ void Account::writeLocationsDelayed() {
 	_writeLocationsTimer.callOnce(kDelayedWriteTimeout);
 }
 
+void Account::ensureLocationsRead() {
+	if (_locationsRead) {
+		return;
+	}
+	_locationsRead = true;
+	if (_locationsKey) {
+		readLocations();
+	}
+}
+
 void Account::readLocations() {
 	FileReadDescriptor locations;
 	if (!ReadEncryptedFile(locations, _locationsKey, _basePath, _localKey)) {
@@ -872,8 +1051,113 @@ void Account::readLocations() {
 			if (!locations.stream.atEnd()) {
 				locations.stream >> _downloadsSerialized;
 			}
+			if (!locations.stream.atEnd()) {
+				locations.stream >> _locationsGeneration;
+			}
+		}
+	}
+	_locationsSnapshotSize = locations.data.size();
+
+	auto stale = false;
+	auto broken = false;
+	const auto journal = ReadJournal(
+		_locationsKey,
+		_basePath,
+		_localKey,
+		[&](QDataStream &stream) {
+			auto generation = quint64();
+			auto count = quint32();
+			stream >> generation >> count;
+			if (generation != _locationsGeneration) {
+				// Left from a crash before the snapshot removed it.
+				stale = true;
+				return;
+			}
+			for (auto i = quint32(); i != count; ++i) {
+				if (!readLocationsRecord(stream)) {
+					broken = true;
+					break;
+				}
+			}
+		});
+	_locationsJournalSize = journal.size;
+
+	// New records can't be appended after a broken one.
+	const auto compactAfter = std::max(
+		kLocationsJournalMinCompact,
+		_locationsSnapshotSize);
+	if (broken
+		|| stale
+		|| journal.broken
+		|| _locationsJournalSize > compactAfter) {
+		_locationsCompact = true;
+		writeLocationsDelayed();
+	}
+}
+
+bool Account::readLocationsRecord(QDataStream &stream) {
+	const auto readKey = [&] {
+		auto first = quint64();
+		auto second = quint64();
+		stream >> first >> second;
+		return MediaKey(first, second);
+	};
+	auto type = quint32();
+	stream >> type;
+	switch (LocationsRecord(type)) {
+	case LocationsRecord::Add: {
+		const auto key = readKey();
+		auto location = Core::FileLocation();
+		auto bookmark = QByteArray();
+		auto size = quint32();
+		stream >> location.fname >> bookmark >> location.modified >> size;
+		location.setBookmark(bookmark);
+		location.size = int64(size);
+		if (!CheckStreamStatus(stream)) {
+			return false;
+		}
+		auto i = _fileLocations.find(key);
+		for (; (i != _fileLocations.end()) && (i.key() == key); ++i) {
+			if (i.value() == location) {
+				return true;
+			}
 		}
+		_fileLocations.insert(key, location);
+		if (!location.inMediaCache()) {
+			_fileLocationPairs.insert(location.fname, { key, location });
+		}
+	} break;
+	case LocationsRecord::Remove: {
+		const auto key = readKey();
+		auto name = QString();
+		stream >> name;
+		auto i = _fileLocations.find(key);
+		while ((i != _fileLocations.end()) && (i.key() == key)) {
+			if (!name.isEmpty() && i.value().fname != name) {
+				++i;
+				continue;
+			}
+			const auto pair = _fileLocationPairs.find(i.value().fname);
+			if (pair != _fileLocationPairs.end()
+				&& pair.value().first == key) {
+				_fileLocationPairs.erase(pair);
+			}
+			i = _fileLocations.erase(i);
+		}
+	} break;
+	case LocationsRecord::Alias: {
+		const auto key = readKey();
+		const auto target = readKey();
+		_fileLocationAliases.insert(key, target);
+	} break;
+	case LocationsRecord::Downloads: {
+		stream >> _downloadsSerialized;
+	} break;
+	default:
+		LOG(("App Error: unknown locations record type: %1").arg(type));
+		return false;
 	}
+	return CheckStreamStatus(stream);
 }
 
 void Account::updateDownloads(
@@ -882,7 +1166,8 @@ void Account::updateDownloads(
 	writeLocationsDelayed();
 }
 
-QByteArray Account::downloadsSerialized() const {
+QByteArray Account::downloadsSerialized() {
+	ensureLocationsRead();
 	return _downloadsSerialized;
 }
 
@@ -1167,24 +1452,13 @@ void Account::writeDrafts(not_null<History*> history) {
 		supportMode,
 		sources,
 		[&](auto&&...) { ++count; });
+	ensureDraftsStoreRead();
 	if (!count) {
-		auto i = _draftsMap.find(peerId);
-		if (i != _draftsMap.cend()) {
-			ClearKey(i->second, _basePath);
-			_draftsMap.erase(i);
-			writeMapDelayed();
-		}
-
+		storeDraftsData(peerId, QByteArray(), false);
 		_draftsNotReadMap.remove(peerId);
 		return;
 	}
 
-	auto i = _draftsMap.find(peerId);
-	if (i == _draftsMap.cend()) {
-		i = _draftsMap.emplace(peerId, GenerateKey(_basePath)).first;
-		writeMapQueued();
-	}
-
 	auto size = int(sizeof(quint64) * 2 + sizeof(quint32));
 	const auto sizeCallback = [&](
 			auto&&, // key
@@ -1209,8 +1483,13 @@ void Account::writeDrafts(not_null<History*> history) {
 		sources,
 		sizeCallback);
 
-	EncryptedDescriptor data(size);
-	data.stream
+	auto data = QByteArray();
+	data.reserve(size);
+	QBuffer buffer(&data);
+	buffer.open(QIODevice::WriteOnly);
+	QDataStream stream(&buffer);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream
 		<< quint64(kRichDraftsTag)
 		<< SerializePeerId(peerId)
 		<< quint32(count);
@@ -1221,7 +1500,7 @@ void Account::writeDrafts(not_null<History*> history) {
 			const TextWithTags &text,
 			const Data::WebPageDraft &webpage,
 			auto&&) { // cursor
-		data.stream
+		stream
 			<< key.serialize()
 			<< text.text
 			<< TextUtilities::SerializeTags(text.tags)
@@ -1239,10 +1518,9 @@ void Account::writeDrafts(not_null<History*> history) {
 		supportMode,
 		sources,
 		writeCallback);
+	buffer.close();
 
-	FileWriteDescriptor file(i->second, _basePath);
-	file.writeEncrypted(data, _localKey);
-
+	storeDraftsData(peerId, std::move(data), false);
 	_draftsNotReadMap.remove(peerId);
 }
 
@@ -1260,22 +1538,23 @@ void Account::writeDraftCursors(not_null<History*> history) {
 		supportMode,
 		sources,
 		[&](auto&&...) { ++count; });
+	ensureDraftsStoreRead();
 	if (!count) {
 		clearDraftCursors(peerId);
 		return;
 	}
-	auto i = _draftCursorsMap.find(peerId);
-	if (i == _draftCursorsMap.cend()) {
-		i = _draftCursorsMap.emplace(peerId, GenerateKey(_basePath)).first;
-		writeMapQueued();
-	}
 
 	auto size = int(sizeof(quint64) * 2
 		+ sizeof(quint32)
 		+ (sizeof(qint64) + sizeof(qint32) * 3) * count);
 
-	EncryptedDescriptor data(size);
-	data.stream
+	auto data = QByteArray();
+	data.reserve(size);
+	QBuffer buffer(&data);
+	buffer.open(QIODevice::WriteOnly);
+	QDataStream stream(&buffer);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream
 		<< quint64(kMultiDraftCursorsTag)
 		<< SerializePeerId(peerId)
 		<< quint32(count);
@@ -1286,7 +1565,7 @@ void Account::writeDraftCursors(not_null<History*> history) {
 			auto&&, // text
 			auto&&, // webpage
 			const MessageCursor &cursor) { // cursor
-		data.stream
+		stream
 			<< key.serialize()
 			<< qint32(cursor.position)
 			<< qint32(cursor.anchor)
@@ -1297,28 +1576,310 @@ void Account::writeDraftCursors(not_null<History*> history) {
 		supportMode,
 		sources,
 		writeCallback);
+	buffer.close();
 
-	FileWriteDescriptor file(i->second, _basePath);
-	file.writeEncrypted(data, _localKey);
+	storeDraftsData(peerId, std::move(data), true);
 }
 
-void Account::clearDraftCursors(PeerId peerId) {
-	const auto i = _draftCursorsMap.find(peerId);
-	if (i != _draftCursorsMap.cend()) {
-		ClearKey(i->second, _basePath);
-		_draftCursorsMap.erase(i);
+void Account::ensureDraftsStoreRead() {
+	if (_draftsStoreRead) {
+		return;
+	}
+	_draftsStoreRead = true;
+	if (_draftsStoreKey) {
+		readDraftsStore();
+	}
+}
+
+void Account::readDraftsStore() {
+	FileReadDescriptor drafts;
+	if (!ReadEncryptedFile(drafts, _draftsStoreKey, _basePath, _localKey)) {
+		ClearKey(_draftsStoreKey, _basePath);
+		_draftsStoreKey = 0;
 		writeMapDelayed();
+		return;
+	}
+	drafts.stream >> _draftsGeneration;
+	auto broken = !readDraftsStoreEntries(drafts.stream);
+	_draftsSnapshotSize = drafts.data.size();
+
+	auto stale = false;
+	const auto journal = ReadJournal(
+		_draftsStoreKey,
+		_basePath,
+		_localKey,
+		[&](QDataStream &stream) {
+			auto generation = quint64();
+			stream >> generation;
+			if (generation != _draftsGeneration) {
+				// Left from a crash before the snapshot removed it.
+				stale = true;
+			} else if (!readDraftsStoreEntries(stream)) {
+				broken = true;
+			}
+		});
+	_draftsJournalSize = journal.size;
+
+	for (const auto &[peerId, entry] : _draftsStore) {
+		if (!entry.drafts.isEmpty()) {
+			_draftsNotReadMap.emplace(peerId, true);
+		}
+	}
+
+	// New records can't be appended after a broken one.
+	const auto compactAfter = std::max(
+		kDraftsJournalMinCompact,
+		_draftsSnapshotSize);
+	if (broken
+		|| stale
+		|| journal.broken
+		|| _draftsJournalSize > compactAfter) {
+		_draftsCompact = true;
+		_writeDraftsTimer.callOnce(kDelayedWriteTimeout);
 	}
 }
 
-void Account::readDraftCursors(PeerId peerId, Data::HistoryDrafts &map) {
-	const auto j = _draftCursorsMap.find(peerId);
-	if (j == _draftCursorsMap.cend()) {
+bool Account::readDraftsStoreEntries(QDataStream &stream) {
+	const auto apply = [&](
+			quint64 peerIdSerialized,
+			DraftsStoreEntry &&entry) {
+		const auto peerId = DeserializePeerId(peerIdSerialized);
+		if (entry.drafts.isEmpty() && entry.cursors.isEmpty()) {
+			_draftsStore.remove(peerId);
+		} else {
+			_draftsStore[peerId] = std::move(entry);
+		}
+	};
+	const auto result = ReadDraftsStoreEntries(stream, apply);
+	return CheckStreamStatus(stream) && result;
+}
+
+bool Account::readDraftsData(
+		FileReadDescriptor &result,
+		PeerId peerId,
+		bool cursors) {
+	const auto i = _draftsStore.find(peerId);
+	if (i != end(_draftsStore)) {
+		const auto &data = cursors ? i->second.cursors : i->second.drafts;
+		if (!data.isEmpty()) {
+			PrepareStoredRead(result, data);
+			return true;
+		}
+	}
+	const auto legacyKey = legacyDraftsKey(peerId, cursors);
+	if (!legacyKey
+		|| !ReadEncryptedFile(result, legacyKey, _basePath, _localKey)) {
+		return false;
+	}
+
+	// Untagged payloads depend on the file version, keep them in the file.
+	auto payload = result.data.mid(result.buffer.pos());
+	auto tag = quint64();
+	QDataStream stream(payload);
+	stream >> tag;
+	if (tag >= kMultiDraftTagOld) {
+		storeDraftsData(peerId, std::move(payload), cursors);
+	}
+	return true;
+}
+
+void Account::storeDraftsData(
+		PeerId peerId,
+		QByteArray &&data,
+		bool cursors) {
+	auto changed = false;
+	if (const auto legacyKey = legacyDraftsKey(peerId, cursors)) {
+		// Kept in the map until the store write with this data is done.
+		_draftsLegacyKeys.emplace(legacyKey);
+		changed = true;
+	}
+	auto i = _draftsStore.find(peerId);
+	if (i == end(_draftsStore) && !data.isEmpty()) {
+		i = _draftsStore.emplace(peerId, DraftsStoreEntry()).first;
+	}
+	if (i != end(_draftsStore)) {
+		auto &stored = cursors ? i->second.cursors : i->second.drafts;
+		if (stored != data) {
+			stored = std::move(data);
+			changed = true;
+		}
+		if (i->second.drafts.isEmpty() && i->second.cursors.isEmpty()) {
+			_draftsStore.erase(i);
+		}
+	}
+	if (!changed) {
 		return;
 	}
+	_draftsStoreChanged.emplace(peerId);
+
+	// Coalesce the changes, but don't postpone them while typing.
+	if (!_writeDraftsTimer.isActive()) {
+		_writeDraftsTimer.callOnce(kDelayedWriteTimeout);
+	}
+}
+
+void Account::writeDraftsStore() {
+	_writeDraftsTimer.cancel();
+	if (_draftsStoreChanged.empty() && !_draftsCompact) {
+		return;
+	}
+	if (_draftsStore.empty()) {
+		// Nothing is left to keep, the legacy files can go right away.
+		if (!_draftsLegacyKeys.empty()) {
+			const auto keys = _draftsLegacyKeys;
+			for (const auto &key : keys) {
+				ClearKey(key, _basePath);
+			}
+			removeDraftsLegacyKeys(keys);
+		}
+		_draftsStoreChanged.clear();
+		_draftsSnapshotSize = _draftsJournalSize = 0;
+		_draftsCompact = false;
+		if (_draftsStoreKey) {
+			ClearKey(_draftsStoreKey, _basePath);
+			_draftsStoreKey = 0;
+			writeMapDelayed();
+		}
+		return;
+	}
+
+	// Rewrite everything once the journal outgrows the snapshot.
+	const auto compactAfter = std::max(
+		kDraftsJournalMinCompact,
+		_draftsSnapshotSize);
+	if (!_draftsStoreKey
+		|| _draftsCompact
+		|| _draftsJournalSize > compactAfter) {
+		writeDraftsSnapshot(clearDraftsLegacyKeysCallback());
+	} else {
+		writeDraftsJournal(clearDraftsLegacyKeysCallback());
+	}
+}
+
+FileKey Account::legacyDraftsKey(PeerId peerId, bool cursors) const {
+	const auto &legacy = cursors ? _draftCursorsMap : _draftsMap;
+	const auto i = legacy.find(peerId);
+	return (i != end(legacy) && !_draftsLegacyKeys.contains(i->second))
+		? i->second
+		: FileKey();
+}
+
+// The legacy files are removed on the write thread right after the store
+// has their data written, the map stops listing them after that.
+Fn<void()> Account::clearDraftsLegacyKeysCallback() {
+	if (_draftsLegacyKeys.empty()) {
+		return nullptr;
+	}
+	const auto weak = base::make_weak(_owner);
+	return [=, keys = _draftsLegacyKeys, basePath = _basePath] {
+		for (const auto &key : keys) {
+			ClearKey(key, basePath);
+		}
+		crl::on_main(weak, [=] {
+			removeDraftsLegacyKeys(keys);
+		});
+	};
+}
+
+void Account::removeDraftsLegacyKeys(const base::flat_set<FileKey> &keys) {
+	auto removed = false;
+	const auto remove = [&](base::flat_map<PeerId, FileKey> &map) {
+		for (auto i = begin(map); i != end(map);) {
+			if (keys.contains(i->second)) {
+				i = map.erase(i);
+				removed = true;
+			} else {
+				++i;
+			}
+		}
+	};
+	remove(_draftsMap);
+	remove(_draftCursorsMap);
+	for (const auto &key : keys) {
+		_draftsLegacyKeys.remove(key);
+	}
+	if (removed) {
+		writeMapDelayed();
+	}
+}
+
+void Account::writeDraftsSnapshot(Fn<void()> whenWritten) {
+	_draftsStoreChanged.clear();
+	_draftsJournalSize = 0;
+	_draftsCompact = false;
+	if (!_draftsStoreKey) {
+		_draftsStoreKey = GenerateKey(_basePath);
+		writeMapQueued();
+	}
+	auto size = quint32(sizeof(quint64) + sizeof(quint32));
+	for (const auto &[peerId, entry] : _draftsStore) {
+		size += DraftsStoreEntrySize(entry);
+	}
+	EncryptedDescriptor data(size);
+
+	// Journal records of the previous generations are skipped.
+	data.stream
+		<< quint64(++_draftsGeneration)
+		<< quint32(_draftsStore.size());
+	for (const auto &[peerId, entry] : _draftsStore) {
+		WriteDraftsStoreEntry(data.stream, SerializePeerId(peerId), entry);
+	}
+
+	FileWriteDescriptor file(_draftsStoreKey, _basePath);
+	file.writeEncrypted(data, _localKey);
+	file.clearJournal();
+	file.whenWritten(std::move(whenWritten));
+
+	_draftsSnapshotSize = data.data.size();
+}
+
+void Account::writeDraftsJournal(Fn<void()> whenWritten) {
+	Expects(_draftsStoreKey != 0);
+
+	// Removed peers are written with empty drafts and cursors.
+	const auto removed = DraftsStoreEntry();
+	const auto changed = base::take(_draftsStoreChanged);
+	const auto entry = [&](PeerId peerId) -> const DraftsStoreEntry& {
+		const auto i = _draftsStore.find(peerId);
+		return (i != end(_draftsStore)) ? i->second : removed;
+	};
+	auto size = quint32(sizeof(quint64) + sizeof(quint32));
+	for (const auto peerId : changed) {
+		size += DraftsStoreEntrySize(entry(peerId));
+	}
+	EncryptedDescriptor data(size);
+	data.stream
+		<< quint64(_draftsGeneration)
+		<< quint32(changed.size());
+	for (const auto peerId : changed) {
+		WriteDraftsStoreEntry(
+			data.stream,
+			SerializePeerId(peerId),
+			entry(peerId));
+	}
+	AppendJournal(
+		_draftsStoreKey,
+		_basePath,
+		data,
+		_localKey,
+		std::move(whenWritten));
+
+	// Record size, message key and the padded encrypted data.
+	_draftsJournalSize += sizeof(quint32) + 0x10 + data.data.size();
+}
+
+void Account::clearDrafts(PeerId peerId) {
+	storeDraftsData(peerId, QByteArray(), false);
+	clearDraftCursors(peerId);
+}
 
+void Account::clearDraftCursors(PeerId peerId) {
+	storeDraftsData(peerId, QByteArray(), true);
+}
+
+void Account::readDraftCursors(PeerId peerId, Data::HistoryDrafts &map) {
 	FileReadDescriptor draft;
-	if (!ReadEncryptedFile(draft, j->second, _basePath, _localKey)) {
+	if (!readDraftsData(draft, peerId, true)) {
 		clearDraftCursors(peerId);
 		return;
 	}
@@ -1404,21 +1965,15 @@ void Account::readDraftsWithCursors(not_null<History*> history) {
 	});
 
 	PeerId peerId = history->peer->id;
+	ensureDraftsStoreRead();
 	if (!_draftsNotReadMap.remove(peerId)) {
 		clearDraftCursors(peerId);
 		return;
 	}
 
-	const auto j = _draftsMap.find(peerId);
-	if (j == _draftsMap.cend()) {
-		clearDraftCursors(peerId);
-		return;
-	}
 	FileReadDescriptor draft;
-	if (!ReadEncryptedFile(draft, j->second, _basePath, _localKey)) {
-		ClearKey(j->second, _basePath);
-		_draftsMap.erase(j);
-		clearDraftCursors(peerId);
+	if (!readDraftsData(draft, peerId, false)) {
+		clearDrafts(peerId);
 		return;
 	}
 
@@ -1435,9 +1990,7 @@ void Account::readDraftsWithCursors(not_null<History*> history) {
 	draft.stream >> draftPeerSerialized >> count;
 	const auto draftPeer = DeserializePeerId(draftPeerSerialized);
 	if (!count || count > 1000 || draftPeer != peerId) {
-		ClearKey(j->second, _basePath);
-		_draftsMap.erase(j);
-		clearDraftCursors(peerId);
+		clearDrafts(peerId);
 		return;
 	}
 	auto map = Data::HistoryDrafts();
@@ -1516,9 +2069,7 @@ void Account::readDraftsWithCursors(not_null<History*> history) {
 		}
 	}
 	if (draft.stream.status() != QDataStream::Ok) {
-		ClearKey(j->second, _basePath);
-		_draftsMap.erase(j);
-		clearDraftCursors(peerId);
+		clearDrafts(peerId);
 		return;
 	}
 	readDraftCursors(peerId, map);
@@ -1552,12 +2103,7 @@ void Account::readDraftsWithCursorsLegacy(
 	const auto peerId = history->peer->id;
 	const auto draftPeer = DeserializePeerId(draftPeerSerialized);
 	if (draftPeer != peerId) {
-		const auto j = _draftsMap.find(peerId);
-		if (j != _draftsMap.cend()) {
-			ClearKey(j->second, _basePath);
-			_draftsMap.erase(j);
-		}
-		clearDraftCursors(peerId);
+		clearDrafts(peerId);
 		return;
 	}
 
@@ -1597,17 +2143,24 @@ void Account::readDraftsWithCursorsLegacy(
 }
 
 bool Account::hasDraftCursors(PeerId peer) {
-	return _draftCursorsMap.contains(peer);
+	ensureDraftsStoreRead();
+	const auto i = _draftsStore.find(peer);
+	return (i != end(_draftsStore) && !i->second.cursors.isEmpty())
+		|| (legacyDraftsKey(peer, true) != 0);
 }
 
 bool Account::hasDraft(PeerId peer) {
-	return _draftsMap.contains(peer);
+	ensureDraftsStoreRead();
+	const auto i = _draftsStore.find(peer);
+	return (i != end(_draftsStore) && !i->second.drafts.isEmpty())
+		|| (legacyDraftsKey(peer, false) != 0);
 }
 
 void Account::writeFileLocation(MediaKey location, const Core::FileLocation &local) {
 	if (local.fname.isEmpty()) {
 		return;
 	}
+	ensureLocationsRead();
 	if (!local.inMediaCache()) {
 		const auto aliasIt = _fileLocationAliases.constFind(location);
 		if (aliasIt != _fileLocationAliases.cend()) {
@@ -1619,6 +2172,8 @@ void Account::writeFileLocation(MediaKey location, const Core::FileLocation &loc
 			if (i.value().second == local) {
 				if (i.value().first != location) {
 					_fileLocationAliases.insert(location, i.value().first);
+					pushLocationsRecord(
+						SerializeLocationAlias(location, i.value().first));
 					writeLocationsQueued();
 				}
 				return;
@@ -1626,6 +2181,8 @@ void Account::writeFileLocation(MediaKey location, const Core::FileLocation &loc
 			if (i.value().first != location) {
 				for (auto j = _fileLocations.find(i.value().first), e = _fileLocations.end(); (j != e) && (j.key() == i.value().first); ++j) {
 					if (j.value() == i.value().second) {
+						pushLocationsRecord(
+							SerializeLocationRemove(j.key(), j.value().fname));
 						_fileLocations.erase(j);
 						break;
 					}
@@ -1639,25 +2196,36 @@ void Account::writeFileLocation(MediaKey location, const Core::FileLocation &loc
 			if (i.value().inMediaCache() || i.value().check()) {
 				return;
 			}
+			pushLocationsRecord(
+				SerializeLocationRemove(location, i.value().fname));
 			i = _fileLocations.erase(i);
 		}
 	}
 	_fileLocations.insert(location, local);
+	pushLocationsRecord(SerializeLocationAdd(location, local));
 	writeLocationsQueued();
 }
 
 void Account::removeFileLocation(MediaKey location) {
+	ensureLocationsRead();
 	auto i = _fileLocations.find(location);
 	if (i == _fileLocations.end()) {
 		return;
 	}
 	while (i != _fileLocations.end() && (i.key() == location)) {
+		const auto pair = _fileLocationPairs.find(i.value().fname);
+		if (pair != _fileLocationPairs.end()
+			&& pair.value().first == location) {
+			_fileLocationPairs.erase(pair);
+		}
 		i = _fileLocations.erase(i);
 	}
+	pushLocationsRecord(SerializeLocationRemove(location, QString()));
 	writeLocationsQueued();
 }
 
 Core::FileLocation Account::readFileLocation(MediaKey location) {
+	ensureLocationsRead();
 	const auto aliasIt = _fileLocationAliases.constFind(location);
 	if (aliasIt != _fileLocationAliases.cend()) {
 		location = aliasIt.value();
@@ -1665,6 +2233,8 @@ Core::FileLocation Account::readFileLocation(MediaKey location) {
 
 	for (auto i = _fileLocations.find(location); (i != _fileLocations.end()) && (i.key() == location);) {
 		if (!i.value().inMediaCache() && !i.value().check()) {
+			pushLocationsRecord(
+				SerializeLocationRemove(location, i.value().fname));
 			_fileLocationPairs.remove(i.value().fname);
 			i = _fileLocations.erase(i);
 			writeLocationsDelayed();
@@ -1736,6 +2306,20 @@ Cache::Database::Settings Account::cacheBigFileSettings() const {
 	return result;
 }
 
+QString Account::messagesStorePath() const {
+	Expects(!_databasePath.isEmpty());
+
+	return _databasePath + "messages";
+}
+
+Cache::Database::Settings Account::messagesStoreSettings() const {
+	auto result = Cache::Database::Settings();
+	result.clearOnWrongKey = true;
+	result.totalSizeLimit = kMessagesStoreSizeLimit;
+	result.totalTimeLimit = kMessagesStoreTimeLimit;
+	return result;
+}
+
 void Account::writeStickerSet(
 		QDataStream &stream,
 		const Data::StickersSet &set) {
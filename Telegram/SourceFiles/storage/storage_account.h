@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/cache/storage_cache_database.h"
 #include "data/stickers/data_stickers_set.h"
 #include "data/data_drafts.h"
+#include "storage/details/storage_drafts_store.h"
 #include "webview/webview_common.h"
 
 class History;
@@ -105,7 +106,7 @@ public:
 	void removeFileLocation(MediaKey location);
 
 	void updateDownloads(Fn<std::optional<QByteArray>()> downloadsSerialize);
-	[[nodiscard]] QByteArray downloadsSerialized() const;
+	[[nodiscard]] QByteArray downloadsSerialized();
 
 	[[nodiscard]] EncryptionKey cacheKey() const;
 	[[nodiscard]] QString cachePath() const;
@@ -118,6 +119,9 @@ public:
 	[[nodiscard]] QString cacheBigFilePath() const;
 	[[nodiscard]] Cache::Database::Settings cacheBigFileSettings() const;
 
+	[[nodiscard]] QString messagesStorePath() const;
+	[[nodiscard]] Cache::Database::Settings messagesStoreSettings() const;
+
 	void writeInstalledStickers();
 	void writeFeaturedStickers();
 	void writeRecentStickers();
@@ -212,8 +216,13 @@ private:
 	void writeMapQueued();
 	void writeMap();
 
+	void ensureLocationsRead();
 	void readLocations();
+	[[nodiscard]] bool readLocationsRecord(QDataStream &stream);
+	void pushLocationsRecord(QByteArray &&record);
 	void writeLocations();
+	void writeLocationsSnapshot();
+	void writeLocationsJournal();
 	void writeLocationsQueued();
 	void writeLocationsDelayed();
 
@@ -225,6 +234,23 @@ private:
 	std::unique_ptr<Main::SessionSettings> applyReadContext(
 		details::ReadSettingsContext &&context);
 
+	using DraftsStoreEntry = details::DraftsStoreEntry;
+
+	void ensureDraftsStoreRead();
+	void readDraftsStore();
+	[[nodiscard]] bool readDraftsStoreEntries(QDataStream &stream);
+	[[nodiscard]] bool readDraftsData(
+		details::FileReadDescriptor &result,
+		PeerId peerId,
+		bool cursors);
+	void storeDraftsData(PeerId peerId, QByteArray &&data, bool cursors);
+	void writeDraftsStore();
+	void writeDraftsSnapshot(Fn<void()> whenWritten);
+	void writeDraftsJournal(Fn<void()> whenWritten);
+	[[nodiscard]] FileKey legacyDraftsKey(PeerId peerId, bool cursors) const;
+	[[nodiscard]] Fn<void()> clearDraftsLegacyKeysCallback();
+	void removeDraftsLegacyKeys(const base::flat_set<FileKey> &keys);
+	void clearDrafts(PeerId peerId);
 	void readDraftCursors(PeerId peerId, Data::HistoryDrafts &map);
 	void readDraftCursorsLegacy(
 		PeerId peerId,
@@ -274,6 +300,14 @@ private:
 		not_null<History*>,
 		base::flat_map<Data::DraftKey, MessageDraftSource>> _draftSources;
 
+	// Drafts of all peers in one file, the changed ones go to the journal.
+	base::flat_map<PeerId, DraftsStoreEntry> _draftsStore;
+	base::flat_set<PeerId> _draftsStoreChanged;
+	base::flat_set<FileKey> _draftsLegacyKeys;
+	int64 _draftsSnapshotSize = 0;
+	int64 _draftsJournalSize = 0;
+	quint64 _draftsGeneration = 0;
+
 	QMultiMap<MediaKey, Core::FileLocation> _fileLocations;
 	QMap<QString, QPair<MediaKey, Core::FileLocation>> _fileLocationPairs;
 	QMap<MediaKey, MediaKey> _fileLocationAliases;
@@ -281,6 +315,13 @@ private:
 	QByteArray _downloadsSerialized;
 	Fn<std::optional<QByteArray>()> _downloadsSerialize;
 
+	// Changes since the last write, appended to the journal.
+	std::vector<QByteArray> _locationsRecords;
+	int64 _locationsSnapshotSize = 0;
+	int64 _locationsJournalSize = 0;
+	quint64 _locationsGeneration = 0;
+
+	FileKey _draftsStoreKey = 0;
 	FileKey _locationsKey = 0;
 	FileKey _trustedBotsKey = 0;
 	FileKey _installedStickersKey = 0;
@@ -310,6 +351,10 @@ private:
 
 	base::flat_map<PeerId, base::flags<BotTrustFlag>> _trustedBots;
 	bool _trustedBotsRead = false;
+	bool _draftsStoreRead = false;
+	bool _draftsCompact = false;
+	bool _locationsRead = false;
+	bool _locationsCompact = false;
 	bool _readingUserSettings = false;
 	bool _recentHashtagsAndBotsWereRead = false;
 	bool _searchSuggestionsRead = false;
@@ -321,6 +366,7 @@ private:
 
 	base::Timer _writeMapTimer;
 	base::Timer _writeLocationsTimer;
+	base::Timer _writeDraftsTimer;
 	base::Timer _writeSearchSuggestionsTimer;
 	bool _mapChanged = false;
 	bool _locationsChanged = false;
@@ -0,0 +1,767 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/storage_messages_store.h"
+
+#include "storage/storage_account.h"
+#include "storage/storage_facade.h"
+#include "storage/storage_shared_media.h"
+#include "storage/serialize_common.h"
+#include "storage/cache/storage_cache_database.h"
+#include "api/api_updates.h"
+#include "core/application.h"
+#include "data/data_channel.h"
+#include "data/data_histories.h"
+#include "data/data_session.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "main/main_session.h"
+#include "apiwrap.h"
+
+#include <QtCore/QBuffer>
+
+namespace Storage {
+namespace {
+
+constexpr auto kStoreVersion = qint32(1);
+constexpr auto kMaxSliceSize = 100;
+constexpr auto kRefreshSliceSize = 2 * kMaxSliceSize;
+constexpr auto kMaxSharedMediaSize = 1000;
+constexpr auto kSharedMediaTag = (uint64(1) << 63);
+constexpr auto kSharedMediaTopicsTag = (uint64(1) << 62);
+
+// Stored shared media is dropped if too many updates were missed since.
+constexpr auto kSharedMediaMaxPtsDelta = 1000;
+
+[[nodiscard]] Cache::Key DialogsKey() {
+	return Cache::Key{ 0, 0 };
+}
+
+[[nodiscard]] Cache::Key IndexKey(PeerId peerId) {
+	return Cache::Key{ peerId.value, 0 };
+}
+
+[[nodiscard]] Cache::Key MessageKey(PeerId peerId, MsgId msgId) {
+	return Cache::Key{ peerId.value, uint64(msgId.bare) };
+}
+
+[[nodiscard]] Cache::Key SharedMediaCacheKey(
+		PeerId peerId,
+		MsgId topicRootId,
+		SharedMediaType type) {
+	return Cache::Key{
+		peerId.value,
+		(kSharedMediaTag
+			| (uint64(type) << 48)
+			| uint64(topicRootId.bare)),
+	};
+}
+
+// Topics of a forum that have stored shared media lists, so that all of
+// them can be removed together, without knowing the topics in advance.
+[[nodiscard]] Cache::Key SharedMediaTopicsKey(PeerId peerId) {
+	return Cache::Key{ peerId.value, kSharedMediaTopicsTag };
+}
+
+[[nodiscard]] QByteArray SerializeTopics(
+		const base::flat_set<MsgId> &topicRootIds) {
+	auto result = QByteArray();
+	result.reserve(sizeof(quint32) + topicRootIds.size() * sizeof(qint64));
+	QBuffer buffer(&result);
+	buffer.open(QIODevice::WriteOnly);
+	QDataStream stream(&buffer);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream << quint32(topicRootIds.size());
+	for (const auto id : topicRootIds) {
+		stream << qint64(id.bare);
+	}
+	buffer.close();
+	return result;
+}
+
+[[nodiscard]] base::flat_set<MsgId> DeserializeTopics(QByteArray value) {
+	QDataStream stream(&value, QIODevice::ReadOnly);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto count = quint32();
+	stream >> count;
+	auto result = base::flat_set<MsgId>();
+	for (auto i = quint32(); i != count; ++i) {
+		auto id = qint64();
+		stream >> id;
+		if (stream.status() != QDataStream::Ok) {
+			return {};
+		}
+		result.emplace(MsgId(id));
+	}
+	return result;
+}
+
+template <typename TL>
+[[nodiscard]] QByteArray SerializeTL(const TL &value) {
+	auto buffer = mtpBuffer();
+	buffer.reserve(tl::count_length(value) >> 2);
+	value.template write<mtpBuffer>(buffer);
+	return QByteArray(
+		reinterpret_cast<const char*>(buffer.constData()),
+		buffer.size() * sizeof(mtpPrime));
+}
+
+template <typename TL>
+[[nodiscard]] std::optional<TL> DeserializeTL(const QByteArray &bytes) {
+	if (bytes.isEmpty() || (bytes.size() % sizeof(mtpPrime))) {
+		return std::nullopt;
+	}
+	auto from = reinterpret_cast<const mtpPrime*>(bytes.constData());
+	const auto end = from + (bytes.size() / sizeof(mtpPrime));
+	auto result = TL();
+	if (!result.read(from, end) || from != end) {
+		return std::nullopt;
+	}
+	return result;
+}
+
+[[nodiscard]] PeerId UserPeerId(const MTPUser &user) {
+	return user.match([](const auto &data) {
+		return peerFromUser(data.vid());
+	});
+}
+
+[[nodiscard]] PeerId ChatPeerId(const MTPChat &chat) {
+	return chat.match([](const MTPDchannel &data) {
+		return peerFromChannel(data.vid().v);
+	}, [](const MTPDchannelForbidden &data) {
+		return peerFromChannel(data.vid().v);
+	}, [](const auto &data) {
+		return peerFromChat(data.vid().v);
+	});
+}
+
+template <typename TL, typename IdGetter>
+[[nodiscard]] MTPVector<TL> FilterUnknownPeers(
+		not_null<Data::Session*> owner,
+		const MTPVector<TL> &list,
+		IdGetter &&id) {
+	auto result = QVector<TL>();
+	result.reserve(list.v.size());
+	for (const auto &peer : list.v) {
+		if (!owner->peerLoaded(id(peer))) {
+			result.push_back(peer);
+		}
+	}
+	return MTP_vector<TL>(std::move(result));
+}
+
+} // namespace
+
+struct MessagesStore::Slice {
+	MTPVector<MTPUser> users;
+	MTPVector<MTPChat> chats;
+	std::vector<MsgId> ids;
+	QVector<MTPMessage> messages;
+};
+
+MessagesStore::MessagesStore(not_null<Data::Session*> owner)
+: _owner(owner)
+, _database(Core::App().databases().get(
+	owner->session().local().messagesStorePath(),
+	owner->session().local().messagesStoreSettings())) {
+	_database->open(_owner->session().local().cacheKey());
+
+	_owner->session().storage().sharedMediaAllRemoved(
+	) | rpl::start_with_next([=](const SharedMediaRemoveAll &query) {
+		removeSharedMedia(query);
+	}, _lifetime);
+}
+
+MessagesStore::~MessagesStore() = default;
+
+void MessagesStore::saveDialogs(const MTPmessages_Dialogs &dialogs) {
+	if (dialogs.type() == mtpc_messages_dialogsNotModified) {
+		return;
+	}
+	_database->put(DialogsKey(), SerializeTL(dialogs));
+}
+
+void MessagesStore::loadDialogs(Fn<void(const MTPmessages_Dialogs &)> done) {
+	const auto weak = base::make_weak(this);
+	_database->get(DialogsKey(), [=](QByteArray &&value) {
+		auto dialogs = DeserializeTL<MTPmessages_Dialogs>(value);
+		if (!dialogs) {
+			return;
+		}
+		crl::on_main(weak, [=, dialogs = std::move(*dialogs)] {
+			done(dialogs);
+		});
+	});
+}
+
+void MessagesStore::saveSlice(
+		not_null<History*> history,
+		const MTPmessages_Messages &slice) {
+	const auto peerId = history->peer->id;
+	auto ids = std::vector<MsgId>();
+	auto serialized = QByteArray();
+	slice.match([](const MTPDmessages_messagesNotModified &) {
+	}, [&](const auto &data) {
+		const auto &messages = data.vmessages().v;
+		const auto count = std::min(int(messages.size()), kMaxSliceSize);
+		ids.reserve(count);
+		for (auto i = 0; i != count; ++i) {
+			const auto &message = messages[i];
+			const auto id = IdFromMessage(message);
+			if (PeerFromMessage(message) != peerId || !IsServerMsgId(id)) {
+				continue;
+			}
+			ids.push_back(id);
+			_database->put(MessageKey(peerId, id), SerializeTL(message));
+		}
+
+		const auto users = SerializeTL(data.vusers());
+		const auto chats = SerializeTL(data.vchats());
+		serialized.reserve(sizeof(qint32)
+			+ Serialize::bytearraySize(users)
+			+ Serialize::bytearraySize(chats)
+			+ sizeof(quint32)
+			+ ids.size() * sizeof(qint64));
+		QBuffer buffer(&serialized);
+		buffer.open(QIODevice::WriteOnly);
+		QDataStream stream(&buffer);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream
+			<< kStoreVersion
+			<< users
+			<< chats
+			<< quint32(ids.size());
+		for (const auto id : ids) {
+			stream << qint64(id.bare);
+		}
+	});
+	if (ids.empty()) {
+		_database->remove(IndexKey(peerId));
+	} else {
+		_database->put(IndexKey(peerId), std::move(serialized));
+	}
+}
+
+void MessagesStore::hydrate(
+		const std::vector<not_null<History*>> &histories) {
+	for (const auto &history : histories) {
+		if (!_hydrated.contains(history->peer->id)) {
+			_hydrated.emplace(history->peer->id);
+			hydrate(history);
+		}
+	}
+}
+
+void MessagesStore::hydrate(not_null<History*> history) {
+	const auto peerId = history->peer->id;
+	const auto weak = base::make_weak(history);
+	_database->get(IndexKey(peerId), [=](QByteArray &&value) {
+		auto slice = Slice();
+		QDataStream stream(&value, QIODevice::ReadOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		auto version = qint32();
+		auto users = QByteArray();
+		auto chats = QByteArray();
+		auto count = quint32();
+		stream >> version >> users >> chats >> count;
+		if (stream.status() != QDataStream::Ok
+			|| version != kStoreVersion
+			|| !count
+			|| count > quint32(kMaxSliceSize)) {
+			return;
+		}
+		slice.ids.reserve(count);
+		for (auto i = quint32(); i != count; ++i) {
+			auto id = qint64();
+			stream >> id;
+			slice.ids.push_back(MsgId(id));
+		}
+		auto parsedUsers = DeserializeTL<MTPVector<MTPUser>>(users);
+		auto parsedChats = DeserializeTL<MTPVector<MTPChat>>(chats);
+		if (stream.status() != QDataStream::Ok
+			|| !parsedUsers
+			|| !parsedChats) {
+			return;
+		}
+		slice.users = std::move(*parsedUsers);
+		slice.chats = std::move(*parsedChats);
+		crl::on_main(weak, [=, slice = std::move(slice)]() mutable {
+			history->owner().messagesStore().applySlice(
+				history,
+				std::move(slice));
+		});
+	});
+}
+
+void MessagesStore::applySlice(not_null<History*> history, Slice &&slice) {
+	const auto peerId = history->peer->id;
+	const auto shared = std::make_shared<Slice>(std::move(slice));
+	const auto left = std::make_shared<int>(int(shared->ids.size()));
+	const auto weak = base::make_weak(history);
+	shared->messages.reserve(shared->ids.size());
+
+	// All callbacks are invoked on the database thread one by one in the
+	// order of the requests, so the order of messages is preserved.
+	for (const auto id : shared->ids) {
+		_database->get(MessageKey(peerId, id), [=](QByteArray &&value) {
+			if (auto message = DeserializeTL<MTPMessage>(value)) {
+				shared->messages.push_back(std::move(*message));
+			}
+			if (--*left) {
+				return;
+			}
+			crl::on_main(weak, [=] {
+				if (!history->isEmpty() || shared->messages.empty()) {
+					return;
+				}
+				history->owner().messagesStore().processStoredPeers(
+					shared->users,
+					shared->chats);
+				history->addOlderSlice(shared->messages);
+
+				const auto newest = ranges::max(shared->ids);
+				const auto last = history->lastMessage();
+				if (!last || last->id > newest) {
+					// Messages between the slice and the last are unknown.
+					history->setNotLoadedAtBottom();
+				}
+				history->owner().messagesStore()._refreshPending[peerId]
+					= shared->ids;
+			});
+		});
+	}
+}
+
+void MessagesStore::historyOpened(not_null<History*> history) {
+	auto ids = _refreshPending.take(history->peer->id);
+	if (ids && !history->isEmpty()) {
+		refreshSlice(history, *ids);
+	}
+}
+
+void MessagesStore::refreshSlice(
+		not_null<History*> history,
+		const std::vector<MsgId> &ids) {
+	const auto oldest = ranges::min(ids);
+
+	// Ask for the stored range together with the newer messages, so that
+	// the messages edited or deleted while we were away are updated too.
+	const auto peer = history->peer;
+	const auto type = Data::Histories::RequestType::History;
+	auto &histories = history->owner().histories();
+	histories.sendRequest(history, type, [=](Fn<void()> finish) {
+		return history->session().api().request(MTPmessages_GetHistory(
+			peer->input,
+			MTP_int(oldest),
+			MTP_int(0), // offset_date
+			MTP_int(-kRefreshSliceSize), // add_offset
+			MTP_int(kRefreshSliceSize),
+			MTP_int(0), // max_id
+			MTP_int(0), // min_id
+			MTP_long(0) // hash
+		)).done([=](const MTPmessages_Messages &result) {
+			const auto owner = &history->owner();
+			owner->processExistingMessages(peer->asChannel(), result);
+			result.match([](const MTPDmessages_messagesNotModified &) {
+			}, [&](const auto &data) {
+				owner->messagesStore().applyRefreshedSlice(
+					history,
+					ids,
+					data.vmessages().v);
+			});
+			finish();
+		}).fail([=] {
+			finish();
+		}).send();
+	});
+}
+
+void MessagesStore::applyRefreshedSlice(
+		not_null<History*> history,
+		const std::vector<MsgId> &ids,
+		const QVector<MTPMessage> &messages) {
+	const auto peerId = history->peer->id;
+	const auto owner = &history->owner();
+	const auto newest = ranges::max(ids);
+	const auto reachedBottom = (messages.size() < kRefreshSliceSize);
+	auto received = base::flat_set<MsgId>();
+	auto newer = QVector<MTPMessage>();
+	auto coveredTill = MsgId();
+	for (const auto &message : messages) {
+		const auto id = IdFromMessage(message);
+		received.emplace(id);
+		coveredTill = std::max(coveredTill, id);
+		if (id > newest) {
+			newer.push_back(message);
+		} else {
+			owner->updateEditedMessage(message);
+		}
+	}
+	auto deleted = QVector<MTPint>();
+	for (const auto id : ids) {
+		if ((reachedBottom || id <= coveredTill) && !received.contains(id)) {
+			deleted.push_back(MTP_int(id.bare));
+		}
+	}
+	if (!deleted.isEmpty()) {
+		owner->processMessagesDeleted(peerId, deleted);
+	}
+
+	// The history could be reloaded by the time the response arrives.
+	if (history->loadedAtBottom() || history->maxMsgId() != newest) {
+		return;
+	} else if (!newer.isEmpty() || reachedBottom) {
+		history->addNewerSlice(newer);
+	}
+}
+
+void MessagesStore::saveSharedMedia(
+		PeerId peerId,
+		MsgId topicRootId,
+		SharedMediaType type,
+		const MTPmessages_Messages &result,
+		const std::vector<MsgId> &ids,
+		MsgRange noSkipRange) {
+	if (result.type() == mtpc_messages_messagesNotModified) {
+		return;
+	}
+	const auto key = SharedMediaListKey{ peerId, topicRootId, type };
+	auto &list = _sharedMedia[key];
+	const auto adjacent = (list.range.till != 0)
+		&& (noSkipRange.from <= list.range.till)
+		&& (list.range.from <= noSkipRange.till);
+	if (adjacent) {
+		list.range = {
+			std::min(list.range.from, noSkipRange.from),
+			std::max(list.range.till, noSkipRange.till),
+		};
+	} else if (noSkipRange.till == ServerMaxMsgId) {
+		list = SharedMediaList();
+		list.range = noSkipRange;
+	} else {
+		return;
+	}
+	list.pts = currentPts(peerId);
+
+	result.match([](const MTPDmessages_messagesNotModified &) {
+	}, [&](const auto &data) {
+		for (const auto &user : data.vusers().v) {
+			if (list.peers.emplace(UserPeerId(user)).second) {
+				list.users.push_back(user);
+			}
+		}
+		for (const auto &chat : data.vchats().v) {
+			if (list.peers.emplace(ChatPeerId(chat)).second) {
+				list.chats.push_back(chat);
+			}
+		}
+		for (const auto &message : data.vmessages().v) {
+			const auto id = IdFromMessage(message);
+			if (PeerFromMessage(message) != peerId
+				|| !ranges::contains(ids, id)) {
+				continue;
+			}
+			list.ids.emplace(id);
+			_database->put(MessageKey(peerId, id), SerializeTL(message));
+		}
+	});
+	if (list.ids.size() > kMaxSharedMediaSize) {
+		const auto drop = int(list.ids.size()) - kMaxSharedMediaSize;
+		list.ids.erase(begin(list.ids), begin(list.ids) + drop);
+		list.range.from = list.ids.front();
+	}
+	writeSharedMedia(key, list);
+}
+
+void MessagesStore::writeSharedMedia(
+		const SharedMediaListKey &key,
+		const SharedMediaList &list) {
+	const auto users = SerializeTL(MTP_vector<MTPUser>(list.users));
+	const auto chats = SerializeTL(MTP_vector<MTPChat>(list.chats));
+	auto serialized = QByteArray();
+	serialized.reserve(sizeof(qint32)
+		+ Serialize::bytearraySize(users)
+		+ Serialize::bytearraySize(chats)
+		+ 2 * sizeof(qint64)
+		+ sizeof(qint32)
+		+ sizeof(quint32)
+		+ list.ids.size() * sizeof(qint64));
+	QBuffer buffer(&serialized);
+	buffer.open(QIODevice::WriteOnly);
+	QDataStream stream(&buffer);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream
+		<< kStoreVersion
+		<< users
+		<< chats
+		<< qint64(list.range.from.bare)
+		<< qint64(list.range.till.bare)
+		<< qint32(list.pts)
+		<< quint32(list.ids.size());
+	for (const auto id : list.ids) {
+		stream << qint64(id.bare);
+	}
+	buffer.close();
+	_database->put(
+		SharedMediaCacheKey(key.peerId, key.topicRootId, key.type),
+		std::move(serialized));
+	if (key.topicRootId) {
+		rememberSharedMediaTopic(key.peerId, key.topicRootId);
+	}
+}
+
+void MessagesStore::rememberSharedMediaTopic(
+		PeerId peerId,
+		MsgId topicRootId) {
+	if (!_sharedMediaTopics[peerId].emplace(topicRootId).second) {
+		return;
+	}
+	// Merge with the record on the main thread, so that the writes are
+	// queued in order and the topics added meanwhile are not lost.
+	const auto weak = base::make_weak(this);
+	_database->get(SharedMediaTopicsKey(peerId), [=](QByteArray &&value) {
+		auto stored = DeserializeTopics(std::move(value));
+		crl::on_main(weak, [=, stored = std::move(stored)] {
+			auto &topics = _sharedMediaTopics[peerId];
+			topics.merge(begin(stored), end(stored));
+			_database->put(
+				SharedMediaTopicsKey(peerId),
+				SerializeTopics(topics));
+		});
+	});
+}
+
+void MessagesStore::hydrateSharedMedia(
+		PeerId peerId,
+		MsgId topicRootId,
+		SharedMediaType type,
+		Fn<void()> done) {
+	const auto key = SharedMediaListKey{ peerId, topicRootId, type };
+	if (_sharedMediaHydrated.contains(key)) {
+		done();
+		return;
+	}
+	auto &waiting = _sharedMediaHydrating[key];
+	waiting.push_back(std::move(done));
+	if (waiting.size() > 1) {
+		return;
+	}
+	const auto weak = base::make_weak(this);
+	const auto cacheKey = SharedMediaCacheKey(peerId, topicRootId, type);
+	_database->get(cacheKey, [=](QByteArray &&value) {
+		const auto failed = [&] {
+			crl::on_main(weak, [=] {
+				sharedMediaHydrated(key);
+			});
+		};
+		auto list = SharedMediaList();
+
+		QDataStream stream(&value, QIODevice::ReadOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		auto version = qint32();
+		auto users = QByteArray();
+		auto chats = QByteArray();
+		auto from = qint64();
+		auto till = qint64();
+		auto pts = qint32();
+		auto count = quint32();
+		stream >> version >> users >> chats >> from >> till >> pts >> count;
+		if (stream.status() != QDataStream::Ok
+			|| version != kStoreVersion
+			|| !count
+			|| count > quint32(kMaxSharedMediaSize)) {
+			failed();
+			return;
+		}
+		list.range = { MsgId(from), MsgId(till) };
+		list.pts = pts;
+		for (auto i = quint32(); i != count; ++i) {
+			auto id = qint64();
+			stream >> id;
+			list.ids.emplace(MsgId(id));
+		}
+		auto parsedUsers = DeserializeTL<MTPVector<MTPUser>>(users);
+		auto parsedChats = DeserializeTL<MTPVector<MTPChat>>(chats);
+		if (stream.status() != QDataStream::Ok
+			|| !parsedUsers
+			|| !parsedChats) {
+			failed();
+			return;
+		}
+		list.users = std::move(parsedUsers->v);
+		list.chats = std::move(parsedChats->v);
+		crl::on_main(weak, [=, list = std::move(list)]() mutable {
+			applySharedMedia(key, std::move(list));
+		});
+	});
+}
+
+void MessagesStore::sharedMediaHydrated(const SharedMediaListKey &key) {
+	_sharedMediaHydrated.emplace(key);
+	const auto i = _sharedMediaHydrating.find(key);
+	if (i == end(_sharedMediaHydrating)) {
+		return;
+	}
+	const auto callbacks = std::move(i->second);
+	_sharedMediaHydrating.erase(i);
+	for (const auto &callback : callbacks) {
+		callback();
+	}
+}
+
+void MessagesStore::applySharedMedia(
+		SharedMediaListKey key,
+		SharedMediaList &&list) {
+	const auto now = currentPts(key.peerId);
+	if (now && list.pts && (now - list.pts > kSharedMediaMaxPtsDelta)) {
+		_database->remove(
+			SharedMediaCacheKey(key.peerId, key.topicRootId, key.type));
+		sharedMediaHydrated(key);
+		return;
+	}
+	struct Loading {
+		SharedMediaList list;
+		QVector<MTPMessage> messages;
+		int left = 0;
+	};
+	const auto shared = std::make_shared<Loading>();
+	shared->list = std::move(list);
+	shared->left = int(shared->list.ids.size());
+	shared->messages.reserve(shared->left);
+	const auto weak = base::make_weak(this);
+
+	// See applySlice() for the order of the database callbacks.
+	for (const auto id : shared->list.ids) {
+		_database->get(MessageKey(key.peerId, id), [=](QByteArray &&value) {
+			if (auto message = DeserializeTL<MTPMessage>(value)) {
+				shared->messages.push_back(std::move(*message));
+			}
+			if (--shared->left) {
+				return;
+			}
+			crl::on_main(weak, [=] {
+				auto &list = shared->list;
+				processStoredPeers(
+					MTP_vector<MTPUser>(list.users),
+					MTP_vector<MTPChat>(list.chats));
+				_owner->processMessages(
+					shared->messages,
+					NewMessageType::Existing);
+
+				auto ids = std::vector<MsgId>();
+				ids.reserve(list.ids.size());
+				for (const auto id : list.ids) {
+					if (_owner->message(key.peerId, id)) {
+						ids.push_back(id);
+					}
+				}
+				if (ids.empty()) {
+					sharedMediaHydrated(key);
+					return;
+				}
+				const auto range = MsgRange{ list.range.from, ids.back() };
+				auto &stored = _sharedMedia[key];
+				if (stored.range.till == 0) {
+					stored = std::move(list);
+				}
+				_owner->session().storage().add(SharedMediaAddSlice(
+					key.peerId,
+					key.topicRootId,
+					key.type,
+					std::move(ids),
+					range));
+				sharedMediaHydrated(key);
+			});
+		});
+	}
+}
+
+void MessagesStore::removeSharedMedia(const SharedMediaRemoveAll &query) {
+	const auto removing = [&](const SharedMediaListKey &key) {
+		return (key.peerId == query.peerId)
+			&& (!query.topicRootId || key.topicRootId == query.topicRootId)
+			&& query.types.test(key.type);
+	};
+	for (auto i = begin(_sharedMedia); i != end(_sharedMedia);) {
+		if (removing(i->first)) {
+			i = _sharedMedia.erase(i);
+		} else {
+			++i;
+		}
+	}
+	const auto removeTopic = [=](MsgId topicRootId) {
+		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
+			const auto type = static_cast<SharedMediaType>(index);
+			if (query.types.test(type)) {
+				_database->remove(
+					SharedMediaCacheKey(query.peerId, topicRootId, type));
+			}
+		}
+	};
+	removeTopic(query.topicRootId);
+	if (query.topicRootId) {
+		return;
+	}
+	const auto peerId = query.peerId;
+	if (const auto known = _sharedMediaTopics.take(peerId)) {
+		for (const auto topicRootId : *known) {
+			removeTopic(topicRootId);
+		}
+	}
+	const auto weak = base::make_weak(this);
+	_database->get(SharedMediaTopicsKey(peerId), [=](QByteArray &&value) {
+		auto stored = DeserializeTopics(std::move(value));
+		if (stored.empty()) {
+			return;
+		}
+		crl::on_main(weak, [=, stored = std::move(stored)] {
+			for (const auto topicRootId : stored) {
+				removeTopic(topicRootId);
+			}
+			// Topics may keep the lists of the types that stay.
+			_sharedMediaTopics[peerId].merge(begin(stored), end(stored));
+		});
+	});
+}
+
+int32 MessagesStore::currentPts(PeerId peerId) const {
+	if (const auto channel = _owner->channelLoaded(peerToChannel(peerId))) {
+		return channel->pts();
+	}
+	return peerIsChannel(peerId) ? 0 : _owner->session().updates().pts();
+}
+
+void MessagesStore::remove(FullMsgId itemId) {
+	if (IsServerMsgId(itemId.msg)) {
+		_database->remove(MessageKey(itemId.peer, itemId.msg));
+	}
+}
+
+void MessagesStore::processStoredPeers(
+		const MTPVector<MTPUser> &users,
+		const MTPVector<MTPChat> &chats) {
+	_owner->processUsers(FilterUnknownPeers(_owner, users, UserPeerId));
+	_owner->processChats(FilterUnknownPeers(_owner, chats, ChatPeerId));
+}
+
+void MessagesStore::clear() {
+	_hydrated.clear();
+	_refreshPending.clear();
+	_sharedMedia.clear();
+	_sharedMediaHydrated.clear();
+	_sharedMediaTopics.clear();
+	for (const auto &[key, callbacks] : base::take(_sharedMediaHydrating)) {
+		for (const auto &callback : callbacks) {
+			callback();
+		}
+	}
+	_database->close();
+	_database->clear();
+}
+
+} // namespace Storage
@@ -0,0 +1,128 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "storage/storage_databases.h"
+#include "base/weak_ptr.h"
+
+class History;
+
+namespace Data {
+class Session;
+} // namespace Data
+
+namespace Storage {
+
+enum class SharedMediaType : signed char;
+struct SharedMediaRemoveAll;
+
+// Encrypted local copy of the first chats list page and of the latest
+// history slices, so that the top chats can be shown on a cold start
+// before the server responds. Every message is kept as a separate
+// record keyed by (PeerId, MsgId), the per-peer record keeps the ids
+// of the stored slice together with the users and chats it mentions.
+class MessagesStore final : public base::has_weak_ptr {
+public:
+	explicit MessagesStore(not_null<Data::Session*> owner);
+	~MessagesStore();
+
+	void saveDialogs(const MTPmessages_Dialogs &dialogs);
+	void loadDialogs(Fn<void(const MTPmessages_Dialogs &)> done);
+
+	void saveSlice(
+		not_null<History*> history,
+		const MTPmessages_Messages &slice);
+	void hydrate(const std::vector<not_null<History*>> &histories);
+	void remove(FullMsgId itemId);
+
+	// The stored slice is refreshed from the server only when its history
+	// is opened, not for all the hydrated chats at once on start.
+	void historyOpened(not_null<History*> history);
+
+	// Only the shared media slice that reaches the newest message is kept.
+	// It is restored with its top edge at the newest stored id, so after
+	// a restart only the newer messages are requested from the server.
+	void saveSharedMedia(
+		PeerId peerId,
+		MsgId topicRootId,
+		SharedMediaType type,
+		const MTPmessages_Messages &result,
+		const std::vector<MsgId> &ids,
+		MsgRange noSkipRange);
+	// Calls done() when the stored list, if any, was added to the storage,
+	// so the caller requests from the server only what is not cached.
+	void hydrateSharedMedia(
+		PeerId peerId,
+		MsgId topicRootId,
+		SharedMediaType type,
+		Fn<void()> done);
+
+	// Stored peers may be older than the ones already received in this
+	// session, so only the peers that are not loaded yet are applied.
+	void processStoredPeers(
+		const MTPVector<MTPUser> &users,
+		const MTPVector<MTPChat> &chats);
+
+	void clear();
+
+private:
+	struct Slice;
+	struct SharedMediaListKey {
+		PeerId peerId = 0;
+		MsgId topicRootId = 0;
+		SharedMediaType type = {};
+
+		friend inline constexpr auto operator<=>(
+			const SharedMediaListKey &,
+			const SharedMediaListKey &) = default;
+	};
+	struct SharedMediaList {
+		QVector<MTPUser> users;
+		QVector<MTPChat> chats;
+		base::flat_set<PeerId> peers;
+		base::flat_set<MsgId> ids;
+		MsgRange range;
+		int32 pts = 0;
+	};
+
+	void hydrate(not_null<History*> history);
+	void applySlice(not_null<History*> history, Slice &&slice);
+	void refreshSlice(
+		not_null<History*> history,
+		const std::vector<MsgId> &ids);
+	void applyRefreshedSlice(
+		not_null<History*> history,
+		const std::vector<MsgId> &ids,
+		const QVector<MTPMessage> &messages);
+
+	[[nodiscard]] int32 currentPts(PeerId peerId) const;
+	void writeSharedMedia(
+		const SharedMediaListKey &key,
+		const SharedMediaList &list);
+	void rememberSharedMediaTopic(PeerId peerId, MsgId topicRootId);
+	void applySharedMedia(SharedMediaListKey key, SharedMediaList &&list);
+	void sharedMediaHydrated(const SharedMediaListKey &key);
+	void removeSharedMedia(const SharedMediaRemoveAll &query);
+
+	const not_null<Data::Session*> _owner;
+	DatabasePointer _database;
+
+	base::flat_set<PeerId> _hydrated;
+	base::flat_map<PeerId, std::vector<MsgId>> _refreshPending;
+	base::flat_map<SharedMediaListKey, SharedMediaList> _sharedMedia;
+	base::flat_set<SharedMediaListKey> _sharedMediaHydrated;
+	base::flat_map<
+		SharedMediaListKey,
+		std::vector<Fn<void()>>> _sharedMediaHydrating;
+	base::flat_map<PeerId, base::flat_set<MsgId>> _sharedMediaTopics;
+
+	rpl::lifetime _lifetime;
+
+};
+
+} // namespace Storage
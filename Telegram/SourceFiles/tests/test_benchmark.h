@@ -0,0 +1,54 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace Test {
+
+// Runs the callback several times and returns the best time in ms,
+// the best run is the least affected by the other system activity.
+template <typename Callback>
+[[nodiscard]] double Measure(Callback &&callback, int runs = 5) {
+	auto result = std::vector<double>();
+	result.reserve(runs);
+	for (auto i = 0; i != runs; ++i) {
+		const auto started = std::chrono::steady_clock::now();
+		callback();
+		const auto finished = std::chrono::steady_clock::now();
+		result.push_back(std::chrono::duration<double, std::milli>(
+			finished - started).count());
+	}
+	return *std::min_element(begin(result), end(result));
+}
+
+inline void Report(const char *name, double ms) {
+	std::printf("%-48s %10.3f ms\n", name, ms);
+}
+
+inline void Compare(const char *name, double baseline, double optimized) {
+	std::printf(
+		"%-48s %10.3f ms -> %10.3f ms (x%.2f)\n",
+		name,
+		baseline,
+		optimized,
+		(optimized > 0.) ? (baseline / optimized) : 0.);
+}
+
+inline void Check(bool condition, const char *what) {
+	if (!condition) {
+		std::printf("FAILED: %s\n", what);
+		std::exit(1);
+	}
+}
+
+} // namespace Test
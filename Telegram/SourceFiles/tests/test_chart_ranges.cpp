@@ -0,0 +1,170 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_benchmark.h"
+
+#include "statistics/chart_downsampling.h"
+#include "statistics/segment_tree.h"
+
+#include <random>
+
+namespace {
+
+using Statistic::ChartValue;
+
+constexpr auto kPoints = 100'000;
+constexpr auto kLines = 4;
+constexpr auto kQueries = 200'000;
+constexpr auto kDownsampleCount = 1'000;
+
+struct Range {
+	int from = 0;
+	int to = 0;
+};
+
+// Reference results by a plain scan over the range.
+[[nodiscard]] ChartValue NaiveMax(
+		const std::vector<ChartValue> &values,
+		int from,
+		int to) {
+	from = std::max(from, 0);
+	to = std::min(to, int(values.size()) - 1);
+	auto result = ChartValue(0);
+	for (auto i = from; i <= to; ++i) {
+		result = std::max(result, values[i]);
+	}
+	return result;
+}
+
+[[nodiscard]] ChartValue NaiveMin(
+		const std::vector<ChartValue> &values,
+		int from,
+		int to) {
+	from = std::max(from, 0);
+	to = std::min(to, int(values.size()) - 1);
+	auto result = std::numeric_limits<ChartValue>::max();
+	for (auto i = from; i <= to; ++i) {
+		result = std::min(result, values[i]);
+	}
+	return result;
+}
+
+[[nodiscard]] std::vector<ChartValue> GenerateLine(std::mt19937 &random) {
+	auto result = std::vector<ChartValue>(kPoints);
+	auto value = ChartValue(1'000'000);
+	for (auto &point : result) {
+		value += ChartValue(random() % 2001) - 1000;
+		point = std::max(value, ChartValue(0));
+	}
+	return result;
+}
+
+// Ranges like the visible part of a chart: mostly wide, sometimes
+// reaching out of the values to check the bounds are clamped.
+[[nodiscard]] std::vector<Range> GenerateRanges(std::mt19937 &random) {
+	auto result = std::vector<Range>();
+	result.reserve(kQueries);
+	for (auto i = 0; i != kQueries; ++i) {
+		const auto length = 1 + int(random() % (kPoints / 10));
+		const auto from = int(random() % (kPoints + 20)) - 10;
+		result.push_back({ from, from + length - 1 });
+	}
+	return result;
+}
+
+void CheckDownsampled(const std::vector<int> &indices, int from, int till) {
+	Test::Check(!indices.empty(), "downsampled indices are not empty");
+	Test::Check(
+		int(indices.size()) <= kDownsampleCount,
+		"downsampled indices fit the count");
+	Test::Check(
+		indices.front() == from && indices.back() == till,
+		"first and last indices are kept");
+	for (auto i = 1; i < int(indices.size()); ++i) {
+		Test::Check(
+			indices[i - 1] < indices[i],
+			"downsampled indices are increasing");
+	}
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	auto random = std::mt19937(0);
+	auto lines = std::vector<std::vector<ChartValue>>();
+	for (auto i = 0; i != kLines; ++i) {
+		lines.push_back(GenerateLine(random));
+	}
+	const auto queries = GenerateRanges(random);
+	const auto &values = lines.front();
+
+	auto tree = Statistic::SegmentTree();
+	const auto build = Test::Measure([&] {
+		tree = Statistic::SegmentTree(values);
+	});
+	Test::Report("sparse table build, 100k values", build);
+
+	auto naiveResults = std::vector<ChartValue>(2 * kQueries);
+	const auto naive = Test::Measure([&] {
+		for (auto i = 0; i != kQueries; ++i) {
+			const auto [from, to] = queries[i];
+			naiveResults[2 * i] = NaiveMax(values, from, to);
+			naiveResults[2 * i + 1] = NaiveMin(values, from, to);
+		}
+	}, 1);
+	auto treeResults = std::vector<ChartValue>(2 * kQueries);
+	const auto sparse = Test::Measure([&] {
+		for (auto i = 0; i != kQueries; ++i) {
+			const auto [from, to] = queries[i];
+			treeResults[2 * i] = tree.rMaxQ(from, to);
+			treeResults[2 * i + 1] = tree.rMinQ(from, to);
+		}
+	});
+	Test::Check(naiveResults == treeResults, "same range min and max");
+	Test::Compare("200k range min and max queries", naive, sparse);
+
+	auto x = std::vector<float64>(kPoints);
+	for (auto i = 0; i != kPoints; ++i) {
+		x[i] = float64(i) / (kPoints - 1);
+	}
+	auto pointers = std::vector<not_null<const std::vector<ChartValue>*>>();
+	for (const auto &line : lines) {
+		pointers.push_back(&line);
+	}
+	auto indices = std::vector<int>();
+	const auto downsample = Test::Measure([&] {
+		indices = Statistic::DownsampleIndices(
+			x,
+			pointers,
+			0,
+			kPoints - 1,
+			kDownsampleCount);
+	});
+	CheckDownsampled(indices, 0, kPoints - 1);
+	Test::Report("downsample 4 lines x 100k points to 1k", downsample);
+
+	const auto part = Test::Measure([&] {
+		for (auto i = 0; i != 1'000; ++i) {
+			const auto [from, to] = queries[i];
+			const auto first = std::max(from, 0);
+			const auto last = std::min(to, kPoints - 1);
+			if (first <= last) {
+				CheckDownsampled(
+					Statistic::DownsampleIndices(
+						x,
+						pointers,
+						from,
+						to,
+						kDownsampleCount),
+					first,
+					last);
+			}
+		}
+	});
+	Test::Report("downsample 1k visible ranges to 1k", part);
+	return 0;
+}
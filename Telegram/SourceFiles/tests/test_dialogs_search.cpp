@@ -0,0 +1,324 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_benchmark.h"
+
+#include "dialogs/dialogs_prefix_index.h"
+
+#include <random>
+
+// Dialogs::FilterByNameWords() is what IndexedList::filtered() calls.
+// Here it gets lists with the same layout as Dialogs::List: rows in the
+// list order and a map to find the row by its key.
+
+namespace {
+
+constexpr auto kChats = 50'000;
+constexpr auto kQueries = 2'000;
+
+// Keys are random, like the entry pointers of the real keys.
+using Chat = uint32;
+
+// Stands for Dialogs::Entry, only the name words are used.
+class Entry final {
+public:
+	explicit Entry(base::flat_set<QString> nameWords)
+	: _nameWords(std::move(nameWords)) {
+	}
+
+	[[nodiscard]] const base::flat_set<QString> &chatListNameWords() const {
+		return _nameWords;
+	}
+
+private:
+	base::flat_set<QString> _nameWords;
+
+};
+
+class Row final {
+public:
+	Row(Chat key, not_null<const Entry*> entry, int index)
+	: _key(key)
+	, _entry(entry)
+	, _index(index) {
+	}
+
+	[[nodiscard]] Chat key() const {
+		return _key;
+	}
+	[[nodiscard]] not_null<const Entry*> entry() const {
+		return _entry;
+	}
+	[[nodiscard]] int index() const {
+		return _index;
+	}
+
+private:
+	Chat _key = 0;
+	not_null<const Entry*> _entry;
+	int _index = 0;
+
+};
+
+class List final {
+public:
+	void addToEnd(Chat key, not_null<const Entry*> entry) {
+		auto row = std::make_unique<Row>(key, entry, int(_rows.size()));
+		_rows.push_back(row.get());
+		_rowByKey.emplace(key, std::move(row));
+	}
+
+	[[nodiscard]] int size() const {
+		return _rows.size();
+	}
+	[[nodiscard]] bool empty() const {
+		return _rows.empty();
+	}
+	[[nodiscard]] Row *getRow(Chat key) const {
+		const auto i = _rowByKey.find(key);
+		return (i != _rowByKey.end()) ? i->second.get() : nullptr;
+	}
+	[[nodiscard]] auto begin() const {
+		return _rows.begin();
+	}
+	[[nodiscard]] auto end() const {
+		return _rows.end();
+	}
+
+private:
+	std::vector<not_null<Row*>> _rows;
+	std::map<Chat, std::unique_ptr<Row>> _rowByKey;
+
+};
+
+struct Chats {
+	std::vector<Chat> order;
+	std::map<Chat, Entry> entries;
+	base::flat_map<QChar, List> byLetter;
+	Dialogs::PrefixIndex<Chat> byPrefix;
+};
+
+[[nodiscard]] QString GenerateWord(std::mt19937 &random) {
+	static const auto consonants = u"bcdfghklmnprstvyz"_q;
+	static const auto vowels = u"aeiou"_q;
+	auto result = QString();
+	const auto length = 2 + int(random() % 3);
+	for (auto i = 0; i != length; ++i) {
+		result += consonants[random() % consonants.size()];
+		result += vowels[random() % vowels.size()];
+	}
+	return result;
+}
+
+[[nodiscard]] Chats GenerateChats(std::mt19937 &random) {
+	auto result = Chats();
+	while (result.entries.size() != kChats) {
+		const auto chat = Chat(random());
+		auto words = base::flat_set<QString>();
+		const auto count = 1 + int(random() % 3);
+		for (auto i = 0; i != count; ++i) {
+			words.emplace(GenerateWord(random));
+		}
+		if (result.entries.emplace(chat, Entry(std::move(words))).second) {
+			result.order.push_back(chat);
+		}
+	}
+	for (const auto chat : result.order) {
+		const auto &entry = result.entries.at(chat);
+		auto letters = base::flat_set<QChar>();
+		for (const auto &word : entry.chatListNameWords()) {
+			letters.emplace(word[0]);
+		}
+		for (const auto letter : letters) {
+			result.byLetter[letter].addToEnd(chat, &entry);
+		}
+	}
+	return result;
+}
+
+[[nodiscard]] std::vector<QStringList> GenerateQueries(
+		const Chats &chats,
+		std::mt19937 &random) {
+	auto result = std::vector<QStringList>();
+	result.reserve(kQueries);
+	for (auto i = 0; i != kQueries; ++i) {
+		const auto chat = chats.order[random() % kChats];
+		auto query = QStringList();
+		for (const auto &word : chats.entries.at(chat).chatListNameWords()) {
+			if (query.isEmpty() || !(random() % 3)) {
+				query.push_back(word.left(1 + int(random() % 4)));
+			}
+		}
+		result.push_back(query);
+	}
+	return result;
+}
+
+[[nodiscard]] Dialogs::PrefixIndex<Chat> IndexInBulk(
+		const Chats &chats,
+		const std::vector<QString> &prefixes) {
+	auto result = Dialogs::PrefixIndex<Chat>();
+	for (const auto chat : chats.order) {
+		result.add(chat, chats.entries.at(chat).chatListNameWords());
+	}
+
+	// Sets are sorted on the first search of each prefix.
+	for (const auto &prefix : prefixes) {
+		[[maybe_unused]] const auto keys = result.find(prefix);
+	}
+	return result;
+}
+
+[[nodiscard]] std::vector<QString> CollectPrefixes(const Chats &chats) {
+	using Index = Dialogs::PrefixIndex<Chat>;
+
+	auto result = base::flat_set<QString>();
+	for (const auto &[chat, entry] : chats.entries) {
+		for (const auto &word : entry.chatListNameWords()) {
+			result.emplace(word.left(Index::kLength));
+		}
+	}
+	return { begin(result), end(result) };
+}
+
+// IndexedList before the prefix index, over the letter lists of Chats.
+class IndexedList final {
+public:
+	explicit IndexedList(const Chats &chats) : _chats(chats) {
+	}
+
+	[[nodiscard]] const List *filtered(QChar ch) const {
+		const auto i = _chats.byLetter.find(ch);
+		return (i != _chats.byLetter.end()) ? &i->second : nullptr;
+	}
+	[[nodiscard]] std::vector<not_null<Row*>> filtered(
+		const QStringList &words) const;
+
+	[[nodiscard]] bool empty() const {
+		return _chats.order.empty();
+	}
+
+private:
+	const Chats &_chats;
+
+};
+
+// Copied verbatim from dialogs_indexed_list.cpp before the prefix index,
+// only Dialogs::List is the List of this file.
+std::vector<not_null<Row*>> IndexedList::filtered(
+		const QStringList &words) const {
+	const auto minimal = [&]() -> const List* {
+		if (empty()) {
+			return nullptr;
+		}
+		auto result = (const List*)nullptr;
+		for (const auto &word : words) {
+			if (word.isEmpty()) {
+				continue;
+			}
+			const auto found = filtered(word[0]);
+			if (!found || found->empty()) {
+				return nullptr;
+			} else if (!result || result->size() > found->size()) {
+				result = found;
+			}
+		}
+		return result;
+	}();
+	auto result = std::vector<not_null<Row*>>();
+	if (!minimal || minimal->empty()) {
+		return result;
+	}
+	result.reserve(minimal->size());
+	for (const auto &row : *minimal) {
+		const auto &nameWords = row->entry()->chatListNameWords();
+		const auto found = [&](const QString &word) {
+			for (const auto &name : nameWords) {
+				if (name.startsWith(word)) {
+					return true;
+				}
+			}
+			return false;
+		};
+		const auto allFound = [&] {
+			for (const auto &word : words) {
+				if (!found(word)) {
+					return false;
+				}
+			}
+			return true;
+		}();
+		if (allFound) {
+			result.push_back(row);
+		}
+	}
+	return result;
+}
+
+[[nodiscard]] std::vector<Chat> SearchByLetter(
+		const IndexedList &list,
+		const QStringList &words) {
+	const auto rows = list.filtered(words);
+	auto result = std::vector<Chat>();
+	result.reserve(rows.size());
+	for (const auto row : rows) {
+		result.push_back(row->key());
+	}
+	return result;
+}
+
+// The way IndexedList::filtered() searches now.
+[[nodiscard]] std::vector<Chat> SearchByPrefix(
+		const Chats &chats,
+		const QStringList &words) {
+	const auto nameWords = [&](Chat chat) -> const base::flat_set<QString>& {
+		return chats.entries.at(chat).chatListNameWords();
+	};
+	const auto rows = Dialogs::FilterByNameWords(
+		words,
+		chats.byLetter,
+		chats.byPrefix,
+		nameWords);
+	auto result = std::vector<Chat>();
+	result.reserve(rows.size());
+	for (const auto row : rows) {
+		result.push_back(row->key());
+	}
+	return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	auto random = std::mt19937(0);
+	auto chats = GenerateChats(random);
+	const auto queries = GenerateQueries(chats, random);
+	const auto prefixes = CollectPrefixes(chats);
+
+	// There was no prefix index before, so it is only reported.
+	const auto index = Test::Measure([&] {
+		chats.byPrefix = IndexInBulk(chats, prefixes);
+	}, 3);
+	Test::Report("index 50k chats by prefixes", index);
+
+	const auto list = IndexedList(chats);
+	auto byLetterResults = std::vector<std::vector<Chat>>(kQueries);
+	const auto byLetter = Test::Measure([&] {
+		for (auto i = 0; i != kQueries; ++i) {
+			byLetterResults[i] = SearchByLetter(list, queries[i]);
+		}
+	});
+	auto byPrefixResults = std::vector<std::vector<Chat>>(kQueries);
+	const auto byPrefix = Test::Measure([&] {
+		for (auto i = 0; i != kQueries; ++i) {
+			byPrefixResults[i] = SearchByPrefix(chats, queries[i]);
+		}
+	});
+	Test::Check(byLetterResults == byPrefixResults, "same chats found");
+	Test::Compare("50k chats, 2k queries", byLetter, byPrefix);
+	return 0;
+}
@@ -0,0 +1,136 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_benchmark.h"
+
+#include "storage/details/storage_drafts_store.h"
+
+#include <QtCore/QBuffer>
+
+#include <map>
+#include <random>
+
+// Round trip of the drafts store records that Storage::Account writes
+// to the snapshot and to the journal of its drafts file.
+
+namespace {
+
+using namespace Storage::details;
+
+constexpr auto kEntries = 1'000;
+constexpr auto kPayloadSize = 256;
+
+using Entries = std::map<quint64, DraftsStoreEntry>;
+
+[[nodiscard]] QByteArray GenerateBytes(std::mt19937 &random, int size) {
+	auto result = QByteArray(size, Qt::Uninitialized);
+	for (auto &byte : result) {
+		byte = char(random());
+	}
+	return result;
+}
+
+[[nodiscard]] bool Same(const Entries &a, const Entries &b) {
+	return ranges::equal(a, b, [](const auto &x, const auto &y) {
+		return (x.first == y.first)
+			&& (x.second.drafts == y.second.drafts)
+			&& (x.second.cursors == y.second.cursors);
+	});
+}
+
+[[nodiscard]] QByteArray Write(const Entries &entries) {
+	auto size = int(sizeof(quint32));
+	for (const auto &[peerIdSerialized, entry] : entries) {
+		size += DraftsStoreEntrySize(entry);
+	}
+	auto result = QByteArray();
+	result.reserve(size);
+	{
+		auto buffer = QBuffer(&result);
+		buffer.open(QIODevice::WriteOnly);
+		auto stream = QDataStream(&buffer);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream << quint32(entries.size());
+		for (const auto &[peerIdSerialized, entry] : entries) {
+			WriteDraftsStoreEntry(stream, peerIdSerialized, entry);
+		}
+	}
+	Test::Check(result.size() == size, "record size is counted exactly");
+	return result;
+}
+
+[[nodiscard]] std::optional<Entries> Read(const QByteArray &data) {
+	auto stream = QDataStream(data);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto result = Entries();
+	const auto ok = ReadDraftsStoreEntries(stream, [&](
+			quint64 peerIdSerialized,
+			DraftsStoreEntry &&entry) {
+		result.emplace(peerIdSerialized, std::move(entry));
+	});
+	return ok ? std::make_optional(std::move(result)) : std::nullopt;
+}
+
+void CheckRoundTrip(std::mt19937 &random) {
+	auto entries = Entries();
+	while (entries.size() != kEntries) {
+		const auto peerIdSerialized = (quint64(random()) << 32) | random();
+		const auto cursors = (random() % 2)
+			? GenerateBytes(random, 16)
+			: QByteArray();
+		entries.emplace(peerIdSerialized, DraftsStoreEntry{
+			.drafts = GenerateBytes(random, kPayloadSize),
+			.cursors = cursors,
+		});
+	}
+	const auto read = Read(Write(entries));
+	Test::Check(read && Same(*read, entries), "snapshot entries round trip");
+}
+
+void CheckRemovedEntry() {
+	// Removed peers are written to the journal with empty data.
+	const auto entries = Entries{ { 1, DraftsStoreEntry() } };
+	const auto read = Read(Write(entries));
+	Test::Check(
+		read
+			&& (read->size() == 1)
+			&& read->begin()->second.drafts.isEmpty()
+			&& read->begin()->second.cursors.isEmpty(),
+		"removed entry round trips empty");
+}
+
+void CheckTruncatedRecord(std::mt19937 &random) {
+	auto entries = Entries();
+	for (auto i = 0; i != 3; ++i) {
+		entries.emplace(quint64(i + 1), DraftsStoreEntry{
+			.drafts = GenerateBytes(random, kPayloadSize),
+		});
+	}
+	const auto data = Write(entries);
+
+	auto stream = QDataStream(data.mid(0, data.size() - 1));
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto passed = 0;
+	const auto ok = ReadDraftsStoreEntries(stream, [&](
+			quint64 peerIdSerialized,
+			DraftsStoreEntry &&entry) {
+		++passed;
+	});
+	Test::Check(!ok, "truncated record is broken");
+	Test::Check(passed == 2, "entries before the broken one are read");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	auto random = std::mt19937(0);
+	CheckRoundTrip(random);
+	CheckRemovedEntry();
+	CheckTruncatedRecord(random);
+	std::printf("drafts store checks passed\n");
+	return 0;
+}
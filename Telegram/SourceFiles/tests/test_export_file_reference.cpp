@@ -0,0 +1,71 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_benchmark.h"
+
+#include "export/export_file_reference.h"
+
+namespace {
+
+using Export::FilePartsReference;
+using Failed = FilePartsReference::Failed;
+
+const auto kOld = QByteArray("old");
+const auto kNew = QByteArray("new");
+
+void CheckBothFailBeforeRefresh() {
+	auto reference = FilePartsReference(kOld);
+	Test::Check(
+		reference.failed(0, kOld) == Failed::Refresh,
+		"first stale part starts the refresh");
+	Test::Check(
+		reference.failed(1, kOld) == Failed::Wait,
+		"second stale part waits for the same refresh");
+	const auto resend = reference.refreshed(kNew);
+	Test::Check(
+		resend && (*resend == std::vector<int64>{ 0, 1 }),
+		"both parts are sent again after the refresh");
+	Test::Check(!reference.refreshing(), "refresh is finished");
+}
+
+void CheckSecondFailsAfterRefresh() {
+	auto reference = FilePartsReference(kOld);
+	Test::Check(
+		reference.failed(0, kOld) == Failed::Refresh,
+		"first stale part starts the refresh");
+	const auto resend = reference.refreshed(kNew);
+	Test::Check(
+		resend && (*resend == std::vector<int64>{ 0 }),
+		"first part is sent again after the refresh");
+	Test::Check(
+		reference.failed(1, kOld) == Failed::Resend,
+		"second part sent with the old reference is just sent again");
+	Test::Check(!reference.refreshing(), "no second refresh is started");
+	Test::Check(
+		reference.failed(1, kNew) == Failed::Refresh,
+		"failure with the current reference starts a refresh");
+}
+
+void CheckRefreshWithoutChange() {
+	auto reference = FilePartsReference(kOld);
+	Test::Check(
+		reference.failed(0, kOld) == Failed::Refresh,
+		"stale part starts the refresh");
+	Test::Check(
+		!reference.refreshed(kOld),
+		"the same reference after the refresh makes the file unavailable");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	CheckBothFailBeforeRefresh();
+	CheckSecondFailsAfterRefresh();
+	CheckRefreshWithoutChange();
+	std::printf("export file reference checks passed\n");
+	return 0;
+}
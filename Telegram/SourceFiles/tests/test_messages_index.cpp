@@ -0,0 +1,176 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_benchmark.h"
+
+#include "data/data_messages_index.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <unordered_map>
+
+namespace {
+
+constexpr auto kPeers = 2'000;
+constexpr auto kPerPeer = 500;
+constexpr auto kHeader = std::size_t(16);
+
+// Live heap bytes, counted by the replaced global operator new,
+// including a 16 byte header per allocation like most allocators have.
+std::size_t HeapBytes = 0;
+
+struct Key {
+	PeerId peerId;
+	MsgId msgId;
+};
+
+// The way Data::Session kept the loaded messages before.
+class NestedMapsIndex final {
+public:
+	[[nodiscard]] HistoryItem *find(PeerId peerId, MsgId msgId) const {
+		const auto i = _messages.find(peerId);
+		if (i == end(_messages)) {
+			return nullptr;
+		}
+		const auto j = i->second.find(msgId);
+		return (j != end(i->second)) ? j->second.get() : nullptr;
+	}
+	bool insert(PeerId peerId, MsgId msgId, not_null<HistoryItem*> item) {
+		return _messages[peerId].emplace(msgId, item).second;
+	}
+	HistoryItem *take(PeerId peerId, MsgId msgId) {
+		const auto i = _messages.find(peerId);
+		if (i == end(_messages)) {
+			return nullptr;
+		}
+		const auto j = i->second.find(msgId);
+		if (j == end(i->second)) {
+			return nullptr;
+		}
+		const auto result = j->second.get();
+		i->second.erase(j);
+		return result;
+	}
+
+private:
+	using Messages = std::unordered_map<MsgId, not_null<HistoryItem*>>;
+
+	std::unordered_map<PeerId, Messages> _messages;
+
+};
+
+[[nodiscard]] std::vector<Key> GenerateKeys() {
+	auto result = std::vector<Key>();
+	result.reserve(kPeers * kPerPeer);
+	for (auto peer = 0; peer != kPeers; ++peer) {
+		const auto peerId = (peer % 2)
+			? peerFromUser(UserId(BareId(1'000'000 + peer)))
+			: peerFromChannel(ChannelId(BareId(1'000'000'000 + peer)));
+		for (auto i = 0; i != kPerPeer; ++i) {
+			result.push_back({ peerId, MsgId(100'000 + i * 3) });
+		}
+	}
+	std::shuffle(begin(result), end(result), std::mt19937(0));
+	return result;
+}
+
+[[nodiscard]] not_null<HistoryItem*> FakeItem(int index) {
+	return reinterpret_cast<HistoryItem*>(
+		std::uintptr_t(index + 1) * kHeader);
+}
+
+// Fills the index, looks up every message and a missing neighbour,
+// then removes half of the messages, returns a checksum of the results.
+template <typename Index>
+[[nodiscard]] std::uintptr_t Run(
+		Index &index,
+		const std::vector<Key> &keys,
+		std::size_t *memory = nullptr) {
+	const auto heapBefore = HeapBytes;
+	auto checksum = std::uintptr_t();
+	for (auto i = 0, count = int(keys.size()); i != count; ++i) {
+		Test::Check(
+			index.insert(keys[i].peerId, keys[i].msgId, FakeItem(i)),
+			"each key is inserted once");
+	}
+	if (memory) {
+		*memory = HeapBytes - heapBefore;
+	}
+	for (auto round = 0; round != 4; ++round) {
+		for (const auto &key : keys) {
+			checksum += reinterpret_cast<std::uintptr_t>(
+				index.find(key.peerId, key.msgId));
+			Test::Check(
+				!index.find(key.peerId, key.msgId + 1),
+				"missing keys are not found");
+		}
+	}
+	for (auto i = 0, count = int(keys.size()); i < count; i += 2) {
+		Test::Check(
+			index.take(keys[i].peerId, keys[i].msgId) == FakeItem(i),
+			"taken item matches the inserted one");
+	}
+	for (auto i = 0, count = int(keys.size()); i != count; ++i) {
+		const auto found = index.find(keys[i].peerId, keys[i].msgId);
+		Test::Check(
+			(i % 2) ? (found == FakeItem(i)) : !found,
+			"only the taken items are gone");
+		checksum += reinterpret_cast<std::uintptr_t>(found);
+	}
+	return checksum;
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+	const auto memory = static_cast<char*>(std::malloc(size + kHeader));
+	if (!memory) {
+		throw std::bad_alloc();
+	}
+	*reinterpret_cast<std::size_t*>(memory) = size;
+	HeapBytes += size + kHeader;
+	return memory + kHeader;
+}
+
+void operator delete(void *pointer) noexcept {
+	if (pointer) {
+		const auto memory = static_cast<char*>(pointer) - kHeader;
+		HeapBytes -= *reinterpret_cast<std::size_t*>(memory) + kHeader;
+		std::free(memory);
+	}
+}
+
+void operator delete(void *pointer, std::size_t size) noexcept {
+	operator delete(pointer);
+}
+
+int main(int argc, char *argv[]) {
+	const auto keys = GenerateKeys();
+
+	auto nestedChecksum = std::uintptr_t();
+	auto nestedMemory = std::size_t();
+	const auto nested = Test::Measure([&] {
+		auto index = NestedMapsIndex();
+		nestedChecksum = Run(index, keys, &nestedMemory);
+	});
+	auto flatChecksum = std::uintptr_t();
+	auto flatMemory = std::size_t();
+	const auto flat = Test::Measure([&] {
+		auto index = Data::MessagesIndex();
+		flatChecksum = Run(index, keys, &flatMemory);
+	});
+	Test::Check(nestedChecksum == flatChecksum, "same items found");
+	Test::Compare("2k peers x 500 messages, insert/find/take", nested, flat);
+	std::printf(
+		"%-48s %10.1f MB -> %10.1f MB\n",
+		"heap used by 1M messages",
+		nestedMemory / (1024. * 1024.),
+		flatMemory / (1024. * 1024.));
+	return 0;
+}
@@ -0,0 +1,257 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_benchmark.h"
+
+#include "mtproto/details/mtproto_mpsc_queue.h"
+#include "mtproto/details/mtproto_session_queues.h"
+
+#include <QtCore/QReadWriteLock>
+
+#include <atomic>
+#include <thread>
+#include <utility>
+
+namespace {
+
+using namespace MTP::details;
+
+constexpr auto kProducers = 4;
+constexpr auto kPerProducer = 200'000;
+constexpr auto kBursts = 20'000;
+constexpr auto kBurstSize = 8;
+
+struct Item {
+	int producer = 0;
+	int index = 0;
+};
+
+// The way SessionData exchanged requests and responses before.
+class LockedQueue final {
+public:
+	void push(Item value) {
+		QWriteLocker locker(&_lock);
+		_items.push_back(value);
+	}
+
+	[[nodiscard]] std::vector<Item> takeAll() {
+		QWriteLocker locker(&_lock);
+		return std::exchange(_items, std::vector<Item>());
+	}
+
+private:
+	QReadWriteLock _lock;
+	std::vector<Item> _items;
+
+};
+
+// Producers push concurrently while the consumer keeps taking all,
+// returns the checksum of the received items after checking the order.
+template <typename Queue>
+[[nodiscard]] int64 Run(Queue &queue) {
+	auto producersLeft = std::atomic<int>(kProducers);
+	auto producers = std::vector<std::thread>();
+	for (auto producer = 0; producer != kProducers; ++producer) {
+		producers.emplace_back([&, producer] {
+			for (auto i = 0; i != kPerProducer; ++i) {
+				queue.push({ producer, i });
+			}
+			--producersLeft;
+		});
+	}
+	auto next = std::vector<int>(kProducers, 0);
+	auto checksum = int64();
+	auto received = 0;
+	const auto consume = [&] {
+		for (const auto &item : queue.takeAll()) {
+			Test::Check(
+				item.index == next[item.producer]++,
+				"items of a producer are received in order");
+			checksum += item.index;
+			++received;
+		}
+	};
+	while (producersLeft) {
+		consume();
+	}
+	consume();
+	for (auto &thread : producers) {
+		thread.join();
+	}
+	Test::Check(
+		received == kProducers * kPerProducer,
+		"all the items are received");
+	return checksum;
+}
+
+// The way SessionData kept requests and responses before, under locks.
+class LockedSessionData final {
+public:
+	void queueToSend(SerializedRequest request) {
+		QWriteLocker locker(&_toSendLock);
+		_toSend.emplace(request->requestId, std::move(request));
+	}
+	[[nodiscard]] auto takeToSend() {
+		QWriteLocker locker(&_toSendLock);
+		return base::take(_toSend);
+	}
+
+	void addSent(mtpMsgId msgId, SerializedRequest request) {
+		QWriteLocker locker(&_haveSentLock);
+		_haveSent.emplace(msgId, std::move(request));
+	}
+	[[nodiscard]] SerializedRequest takeSent(mtpMsgId msgId) {
+		QWriteLocker locker(&_haveSentLock);
+		return _haveSent.take(msgId).value_or(SerializedRequest());
+	}
+
+	void addReceived(Response &&response) {
+		QWriteLocker locker(&_haveReceivedLock);
+		_receivedMessages.push_back(std::move(response));
+	}
+	[[nodiscard]] std::vector<Response> takeReceived() {
+		QWriteLocker locker(&_haveReceivedLock);
+		return base::take(_receivedMessages);
+	}
+
+private:
+	QReadWriteLock _toSendLock;
+	QReadWriteLock _haveSentLock;
+	QReadWriteLock _haveReceivedLock;
+	base::flat_map<mtpRequestId, SerializedRequest> _toSend;
+	base::flat_map<mtpMsgId, SerializedRequest> _haveSent;
+	std::vector<Response> _receivedMessages;
+
+};
+
+// The way SessionData does it now, SessionPrivate owns the maps.
+class QueuedSessionData final {
+public:
+	void queueToSend(SerializedRequest request) {
+		_queues.queueToSend(std::move(request));
+	}
+	[[nodiscard]] auto takeToSend() {
+		_queues.applyQueued();
+		auto &toSend = _queues.toSendMap();
+		auto result = toSend;
+		_queues.eraseToSend(begin(toSend), end(toSend));
+		return result;
+	}
+
+	void addSent(mtpMsgId msgId, SerializedRequest request) {
+		_queues.haveSentMap().emplace(msgId, std::move(request));
+	}
+	[[nodiscard]] SerializedRequest takeSent(mtpMsgId msgId) {
+		return _queues.haveSentMap().take(msgId).value_or(
+			SerializedRequest());
+	}
+
+	void addReceived(Response &&response) {
+		_queues.addReceived(std::move(response));
+	}
+	[[nodiscard]] std::vector<Response> takeReceived() {
+		return _queues.takeReceived();
+	}
+
+private:
+	SessionQueues _queues;
+
+};
+
+// The Session thread sends bursts of requests and waits for all their
+// responses, the SessionPrivate thread sends what is queued and answers
+// it right away. Returns the checksum of the answered request ids.
+template <typename Data>
+[[nodiscard]] int64 RoundTrip(Data &data) {
+	auto finished = std::atomic<bool>(false);
+	auto connection = std::thread([&] {
+		auto msgId = mtpMsgId();
+		while (!finished) {
+			auto toSend = data.takeToSend();
+			if (toSend.empty()) {
+				std::this_thread::yield();
+				continue;
+			}
+			const auto firstMsgId = msgId + 1;
+			for (auto &[requestId, request] : toSend) {
+				request.setMsgId(++msgId);
+				data.addSent(msgId, std::move(request));
+			}
+			for (auto sent = firstMsgId; sent <= msgId; ++sent) {
+				const auto request = data.takeSent(sent);
+				Test::Check(bool(request), "sent request is found");
+				data.addReceived({
+					.reply = mtpBuffer(1, mtpPrime(mtpc_boolTrue)),
+					.outerMsgId = sent,
+					.requestId = request->requestId,
+				});
+			}
+		}
+	});
+	auto checksum = int64();
+	auto requestId = mtpRequestId();
+	for (auto burst = 0; burst != kBursts; ++burst) {
+		for (auto i = 0; i != kBurstSize; ++i) {
+			auto request = SerializedRequest::Prepare(1);
+			request->push_back(mtpPrime(mtpc_help_getConfig));
+			request->requestId = ++requestId;
+			data.queueToSend(std::move(request));
+		}
+		auto received = 0;
+		while (received != kBurstSize) {
+			const auto responses = data.takeReceived();
+			if (responses.empty()) {
+				std::this_thread::yield();
+			}
+			for (const auto &response : responses) {
+				checksum += response.requestId;
+				++received;
+			}
+		}
+	}
+	finished = true;
+	connection.join();
+	return checksum;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	auto lockedChecksum = int64();
+	const auto locked = Test::Measure([&] {
+		auto queue = LockedQueue();
+		lockedChecksum = Run(queue);
+	});
+	auto lockFreeChecksum = int64();
+	const auto lockFree = Test::Measure([&] {
+		auto queue = MTP::details::MpscQueue<Item>();
+		lockFreeChecksum = Run(queue);
+	});
+	Test::Check(lockedChecksum == lockFreeChecksum, "same items received");
+	Test::Compare("4 producers x 200k items, one consumer", locked, lockFree);
+
+	auto lockedRoundTripChecksum = int64();
+	const auto lockedRoundTrip = Test::Measure([&] {
+		auto data = LockedSessionData();
+		lockedRoundTripChecksum = RoundTrip(data);
+	});
+	auto queuedRoundTripChecksum = int64();
+	const auto queuedRoundTrip = Test::Measure([&] {
+		auto data = QueuedSessionData();
+		queuedRoundTripChecksum = RoundTrip(data);
+	});
+	const auto requests = int64(kBursts) * kBurstSize;
+	Test::Check(
+		(lockedRoundTripChecksum == requests * (requests + 1) / 2
+			&& queuedRoundTripChecksum == lockedRoundTripChecksum),
+		"all the requests are answered");
+	Test::Compare(
+		"20k bursts of 8 requests, send to response",
+		lockedRoundTrip,
+		queuedRoundTrip);
+	return 0;
+}
@@ -0,0 +1,134 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "tests/test_benchmark.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QProcess>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QThread>
+
+// Launches the app with the "startup-trace" option in a temporary working
+// folder and reads the time to the first window show from the trace.
+//
+// Usage: test_startup_time [path to Telegram] [runs] [baseline ms]
+// With a baseline it fails if the median is more than 10% slower.
+
+namespace {
+
+constexpr auto kDefaultRuns = 5;
+constexpr auto kAllowedSlowdown = 1.1;
+constexpr auto kTraceTimeout = 60 * 1000;
+constexpr auto kTracePollDelay = 50;
+
+[[nodiscard]] QString DefaultExecutable(const char *argv0) {
+	const auto path = QString::fromLocal8Bit(argv0);
+	const auto folder = QFileInfo(path).absolutePath();
+#ifdef Q_OS_WIN
+	return folder + "/Telegram.exe";
+#elif defined Q_OS_MAC // Q_OS_WIN
+	return folder + "/Telegram.app/Contents/MacOS/Telegram";
+#else // Q_OS_WIN || Q_OS_MAC
+	return folder + "/Telegram";
+#endif // Q_OS_WIN || Q_OS_MAC
+}
+
+void EnableStartupTrace(const QString &workingDir) {
+	QDir().mkpath(workingDir + "/tdata");
+	auto options = QJsonObject();
+	options.insert("startup-trace", true);
+	auto file = QFile(workingDir + "/tdata/experimental_options.json");
+	Test::Check(
+		file.open(QIODevice::WriteOnly),
+		"experimental options are written");
+	file.write(QJsonDocument(options).toJson());
+}
+
+// Returns the first show time in ms, read from the "shown" instant event,
+// the "first show" phase is the start of the first show, not its end.
+[[nodiscard]] double ReadFirstShow(const QString &path) {
+	auto file = QFile(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return -1.;
+	}
+	const auto document = QJsonDocument::fromJson(file.readAll());
+	const auto events = document.object().value("traceEvents").toArray();
+	for (const auto &event : events) {
+		const auto object = event.toObject();
+		if (object.value("ph").toString() == "i"
+			&& object.value("name").toString() == "shown") {
+			return object.value("ts").toDouble() / 1000.;
+		}
+	}
+	return -1.;
+}
+
+[[nodiscard]] double Launch(
+		const QString &executable,
+		const QString &workingDir) {
+	const auto trace = workingDir + "/startup_trace.json";
+	QFile::remove(trace);
+
+	auto process = QProcess();
+	process.start(executable, { "-workdir", workingDir });
+	Test::Check(process.waitForStarted(), "the app is started");
+
+	auto result = -1.;
+	auto timer = QElapsedTimer();
+	timer.start();
+	while (result < 0. && timer.elapsed() < kTraceTimeout) {
+		QThread::msleep(kTracePollDelay);
+		result = ReadFirstShow(trace);
+	}
+	process.kill();
+	process.waitForFinished();
+	Test::Check(result >= 0., "the startup trace is written");
+	return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	const auto executable = (argc > 1)
+		? QString::fromLocal8Bit(argv[1])
+		: DefaultExecutable(argv[0]);
+	const auto runs = (argc > 2) ? std::max(atoi(argv[2]), 1) : kDefaultRuns;
+	const auto baseline = (argc > 3) ? atof(argv[3]) : 0.;
+	Test::Check(QFileInfo(executable).isExecutable(), "the app is found");
+
+	auto folder = QTemporaryDir();
+	Test::Check(folder.isValid(), "temporary working folder is created");
+	const auto workingDir = folder.path();
+	EnableStartupTrace(workingDir);
+
+	// The first launch creates the local storage, it isn't measured.
+	Test::Report("first launch, time to first show", Launch(
+		executable,
+		workingDir));
+
+	auto times = std::vector<double>();
+	for (auto i = 0; i != runs; ++i) {
+		times.push_back(Launch(executable, workingDir));
+	}
+	std::sort(begin(times), end(times));
+	const auto median = times[times.size() / 2];
+	Test::Report("time to first show, best", times.front());
+	Test::Report("time to first show, median", median);
+	if (baseline > 0.) {
+		Test::Compare("time to first show, baseline", baseline, median);
+		Test::Check(
+			median <= baseline * kAllowedSlowdown,
+			"time to first show is within 10% of the baseline");
+	}
+	return 0;
+}
@@ -25,12 +25,17 @@ PRIVATE
     mtproto/details/mtproto_domain_resolver.h
     mtproto/details/mtproto_dump_to_text.cpp
     mtproto/details/mtproto_dump_to_text.h
+    mtproto/details/mtproto_metrics.cpp
+    mtproto/details/mtproto_metrics.h
+    mtproto/details/mtproto_mpsc_queue.h
     mtproto/details/mtproto_received_ids_manager.cpp
     mtproto/details/mtproto_received_ids_manager.h
     mtproto/details/mtproto_rsa_public_key.cpp
     mtproto/details/mtproto_rsa_public_key.h
     mtproto/details/mtproto_serialized_request.cpp
     mtproto/details/mtproto_serialized_request.h
+    mtproto/details/mtproto_session_queues.cpp
+    mtproto/details/mtproto_session_queues.h
     mtproto/details/mtproto_tcp_socket.cpp
     mtproto/details/mtproto_tcp_socket.h
     mtproto/details/mtproto_tls_socket.cpp
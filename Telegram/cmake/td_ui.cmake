@@ -218,6 +218,8 @@ PRIVATE
     settings/settings_common.cpp
     settings/settings_common.h
 
+    statistics/chart_downsampling.cpp
+    statistics/chart_downsampling.h
     statistics/chart_lines_filter_controller.cpp
     statistics/chart_lines_filter_controller.h
     statistics/chart_rulers_data.cpp
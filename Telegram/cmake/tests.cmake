@@ -42,3 +42,82 @@ set_target_properties(test_text PROPERTIES RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINA
 add_dependencies(Telegram test_text)
 
 target_prepare_qrc(test_text)
+
+# Console benchmarks, each checks the optimized code against a baseline,
+# and console checks of the application code without the whole app.
+# They are not built together with the app, build them by target name.
+# SOURCES are the application sources the benchmark measures,
+# LIBRARIES are linked in addition to the ones every benchmark uses.
+function(add_benchmark_target target_name)
+    cmake_parse_arguments(arg "" "" "SOURCES;LIBRARIES" ${ARGN})
+
+    add_executable(${target_name})
+    init_target(${target_name} "(tests)")
+
+    target_include_directories(${target_name} PRIVATE ${src_loc})
+
+    nice_target_sources(${target_name} ${src_loc}
+    PRIVATE
+        tests/test_benchmark.h
+        tests/${target_name}.cpp
+        ${arg_SOURCES}
+    )
+
+    target_precompile_headers(${target_name} PRIVATE $<$<COMPILE_LANGUAGE:CXX,OBJCXX>:${src_loc}/stdafx.h>)
+
+    target_link_libraries(${target_name}
+    PRIVATE
+        tdesktop::td_scheme
+        desktop-app::lib_base
+        desktop-app::lib_crl
+        desktop-app::lib_ui
+        desktop-app::external_qt
+        ${arg_LIBRARIES}
+    )
+
+    set_target_properties(${target_name} PROPERTIES RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR})
+endfunction()
+
+add_benchmark_target(test_mpsc_queue
+SOURCES
+    mtproto/details/mtproto_mpsc_queue.h
+    mtproto/details/mtproto_serialized_request.cpp
+    mtproto/details/mtproto_serialized_request.h
+    mtproto/details/mtproto_session_queues.cpp
+    mtproto/details/mtproto_session_queues.h
+LIBRARIES
+    desktop-app::external_zlib
+)
+
+add_benchmark_target(test_messages_index
+SOURCES
+    data/data_messages_index.cpp
+    data/data_messages_index.h
+)
+
+add_benchmark_target(test_dialogs_search
+SOURCES
+    dialogs/dialogs_prefix_index.h
+)
+
+add_benchmark_target(test_chart_ranges
+SOURCES
+    statistics/chart_downsampling.cpp
+    statistics/chart_downsampling.h
+    statistics/segment_tree.cpp
+    statistics/segment_tree.h
+)
+
+add_benchmark_target(test_startup_time)
+
+add_benchmark_target(test_drafts_store
+SOURCES
+    storage/details/storage_drafts_store.cpp
+    storage/details/storage_drafts_store.h
+)
+
+add_benchmark_target(test_export_file_reference
+SOURCES
+    export/export_file_reference.cpp
+    export/export_file_reference.h
+)